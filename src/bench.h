@@ -0,0 +1,275 @@
+#pragma once
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "curve.h"
+#include "registry.h"
+#include "shards.h"
+#include "sweep.h"
+#include "workload.h"
+
+const long long BENCH_REFERENCE_LIMIT = 10000;          // Longest trace the scanning reference engines are timed on
+
+/**
+ * @brief Peak resident set size of this process so far, in KB
+ */
+
+inline long peakRssKb()
+{
+    struct rusage usage;                                // Resource usage of this process
+    getrusage(RUSAGE_SELF, &usage);                     // Fill it in
+    return usage.ru_maxrss;                             // Linux reports the high-water mark in KB
+}                                                       // End of function peakRssKb
+
+/**
+ * @brief Parse a list of trace lengths such as "1e3,1e6,250000"
+ *
+ * @return false if an entry is malformed or not positive
+ */
+
+inline bool parseSizeList(const char *text,
+                          std::vector<long long> &sizes)
+{
+    sizes.clear();                                      // Start with no sizes
+
+    while (*text) {                                     // While items remain
+        char *end;                                      // End of the number just read
+        double size = std::strtod(text, &end);          // Accept plain and exponent forms
+        if (end == text || size < 1 || size > 2e9)      // If it is missing or out of range
+            return false;                               // The list is malformed
+        sizes.push_back((long long) size);              // Add it
+
+        if (*end == ',')                                // If another item follows
+            end++;                                      // Step past the comma
+        else if (*end != '\0')                          // Else anything but the end is an error
+            return false;                               // The list is malformed
+        text = end;                                     // Move to the next item
+    }                                                   // End while loop
+
+    return !sizes.empty();                              // At least one size is needed
+}                                                       // End of function parseSizeList
+
+/**
+ * @brief Compare sampled LRU curves against the exact curve on generated workloads
+ *
+ * For every (workload, length) the exact curve over 1..pages frames
+ * comes from lruStackDistances; each sampling configuration then
+ * reports its mean and largest absolute miss-ratio error over that
+ * range, its time per reference and the most pages it tracked.
+ *
+ * @param workloads Patterns to generate
+ * @param sizes     Trace lengths
+ * @param pages     Distinct pages per trace, also the largest frame count
+ * @param seed      Generator seed
+ * @param json      Whether to print JSON lines instead of CSV
+ *
+ * @return Exit status for main
+ */
+
+inline int runShardsEval(const std::vector<WorkloadSpec> &workloads,
+                         const std::vector<long long> &sizes,
+                         int pages,
+                         unsigned long long seed,
+                         bool json)
+{
+    struct Config { const char *name; double rate; int budget; };  // One sampling setup
+    const Config configs[] = {                          // Fixed rates, then fixed budgets
+        {"rate:0.1", 0.1, 0}, {"rate:0.01", 0.01, 0}, {"rate:0.001", 0.001, 0},
+        {"size:1024", 0, 1024}, {"size:8192", 0, 8192},
+    };
+
+    if (!json)                                          // CSV starts with a header
+        std::cout << "workload,references,pages,sampling,final_rate,peak_pages,mean_abs_error,max_abs_error,ns_per_ref\n";
+
+    std::vector<int> refs;                              // The current trace
+    std::vector<long long> histogram;                   // Exact stack-distance histogram
+    std::vector<double> estimate;                       // Sampled miss ratios
+
+    for (long long size : sizes) {                      // For every length
+        for (const WorkloadSpec &spec : workloads) {    // For every pattern
+            generateWorkload(spec, pages, size, seed, refs);  // Build the trace
+
+            long long coldMisses;                       // First references to a page
+            lruStackDistances(refs.data(), (int) size, histogram, coldMisses);  // Exact distances
+            std::vector<double> exact(pages + 1, 1.0);  // Exact miss ratio per frame count
+            long long faults = size;                    // With zero frames every reference faults
+            for (int k = 1; k <= pages; k++) {          // For every frame count
+                if (k < (int) histogram.size())         // If some references sit at this distance
+                    faults -= histogram[k];             // They hit from here on
+                exact[k] = (double) faults / size;      // Exact miss ratio
+            }                                           // End for loop
+
+            for (const Config &config : configs) {      // For every sampling setup
+                ShardsSampler sampler;                  // The sample
+                auto start = std::chrono::steady_clock::now();  // Time the pass
+                sampler.init(config.rate, config.budget, pages);  // Curve over every frame count
+                for (long long i = 0; i < size; i++)    // For every reference
+                    sampler.access(refs[i]);            // Feed it to the sample
+                sampler.curve(estimate);                // Compute the curve
+                double ns = std::chrono::duration<double, std::nano>(  // Time per reference
+                    std::chrono::steady_clock::now() - start).count() / size;
+
+                double sum = 0, worst = 0;              // Total and largest absolute error
+                for (int k = 1; k <= pages; k++) {      // For every frame count
+                    double error = std::fabs(estimate[k] - exact[k]);  // Distance from the exact curve
+                    sum += error;                       // Add it up
+                    worst = std::max(worst, error);     // Keep the largest
+                }                                       // End for loop
+
+                if (json)                               // One JSON object
+                    std::cout << "{\"workload\":\"" << spec.name << "\",\"references\":" << size <<
+                        ",\"pages\":" << pages << ",\"sampling\":\"" << config.name <<
+                        "\",\"final_rate\":" << sampler.rate() << ",\"peak_pages\":" << sampler.peakPages() <<
+                        ",\"mean_abs_error\":" << sum / pages << ",\"max_abs_error\":" << worst <<
+                        ",\"ns_per_ref\":" << ns << "}\n";
+                else                                    // One CSV row
+                    std::cout << spec.name << "," << size << "," << pages << "," << config.name << "," <<
+                        sampler.rate() << "," << sampler.peakPages() << "," << sum / pages << "," <<
+                        worst << "," << ns << "\n";
+            }                                           // End for loop
+        }                                               // End for loop
+    }                                                   // End for loop
+
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function runShardsEval
+
+/**
+ * @brief Time every policy on generated workloads
+ *
+ * Generates each (workload, length) trace once, runs every (policy,
+ * frame count) on it without recording history, and prints one row per
+ * run with the faults, nanoseconds per reference and the process's peak
+ * RSS after the run. Traces are visited shortest first, so the RSS
+ * column climbs with the largest trace generated so far. The scanning
+ * reference engines are only timed up to BENCH_REFERENCE_LIMIT
+ * references and MAX_FRAMES frames.
+ *
+ * @param argc  Argument count from main
+ * @param argv  Arguments from main
+ * @param first Index of the first argument after --bench
+ *
+ * @return Exit status for main
+ */
+
+inline int runBench(int argc,
+                    char *argv[],
+                    int first)
+{
+    std::vector<WorkloadSpec> workloads;                // Patterns to generate
+    std::vector<long long> sizes = {1000, 10000, 100000, 1000000};  // Trace lengths
+    std::vector<int> frameList = {32};                  // Frame counts
+    std::vector<const PolicyEntry *> policies;          // Policies to time
+    int pages = 10000;                                  // Distinct pages per trace
+    unsigned long long seed = 1;                        // Generator seed
+    bool json = false;                                  // Whether to print JSON lines
+    bool shards = false;                                // Whether to evaluate sampled curves instead
+
+    for (int i = first; i < argc; i++) {                // Walk the rest of the command line
+        bool more = i + 1 < argc;                       // Whether a value follows
+        if (std::strcmp(argv[i], "--workloads") == 0 && more) {  // If workloads were listed
+            std::string list = argv[++i];               // Copy so the names can be split
+            size_t start = 0;                           // Start of the current name
+            while (start <= list.size()) {              // While names remain
+                size_t comma = list.find(',', start);   // End of the current name
+                if (comma == std::string::npos)         // If this is the last name
+                    comma = list.size();                // It runs to the end
+                WorkloadSpec spec;                      // The parsed workload
+                if (!parseWorkload(list.substr(start, comma - start), spec)) {  // If it is unknown
+                    std::cerr << "Unknown workload '" << list.substr(start, comma - start) << "'.\n";  // Print error message
+                    return 1;                           // Return 1 which indicates error
+                }                                       // End if statement
+                workloads.push_back(spec);              // Add it
+                start = comma + 1;                      // Move past the comma
+            }                                           // End while loop
+        } else if (std::strcmp(argv[i], "--sizes") == 0 && more) {  // If lengths were listed
+            if (!parseSizeList(argv[++i], sizes)) {     // Parse them
+                std::cerr << "Bad size list '" << argv[i] << "'.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+        } else if (std::strcmp(argv[i], "--frames") == 0 && more) {  // If frame counts were listed
+            if (!parseFrameList(argv[++i], frameList)) {  // Parse them
+                std::cerr << "Bad frame list '" << argv[i] << "'.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+        } else if (std::strcmp(argv[i], "--policies") == 0 && more) {  // If policies were listed
+            if (!parsePolicyList(argv[++i], policies, true))  // Parse them, reference engines included
+                return 1;                               // Return 1 which indicates error
+        } else if (std::strcmp(argv[i], "--pages") == 0 && more) {  // If a page count was given
+            pages = std::atoi(argv[++i]);               // Use it
+        } else if (std::strcmp(argv[i], "--seed") == 0 && more) {  // If a seed was given
+            seed = std::strtoull(argv[++i], nullptr, 10);  // Use it
+        } else if (std::strcmp(argv[i], "--json") == 0) {  // If JSON lines were asked for
+            json = true;                                // Print them instead of CSV
+        } else if (std::strcmp(argv[i], "--shards") == 0) {  // If sampled curves are to be checked
+            shards = true;                              // Compare them against exact curves
+        } else {                                        // Else the argument is unknown
+            std::cerr << "Usage: " << argv[0] << " --bench [--workloads uniform,zipf:0.99,loop,phase:0.1,stride:7]\n"  // Display the usage message
+                "       [--sizes 1e3,1e6] [--frames 32] [--pages N] [--policies a,b,...] [--seed N] [--json] [--shards]\n";
+            return 1;                                   // Return 1 which indicates error
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    if (pages < 1) {                                    // If there are no pages to draw from
+        std::cerr << "Page count must be at least 1.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (workloads.empty())                              // If no workloads were listed
+        for (const char *name : {"uniform", "zipf", "loop", "phase", "stride"}) {  // Use every pattern
+            WorkloadSpec spec;                          // Its default parameters
+            parseWorkload(name, spec);                  // Fill them in
+            workloads.push_back(spec);                  // Add it
+        }                                               // End for loop
+
+    if (policies.empty())                               // If no policies were listed
+        for (int i = 0; i < POLICY_COUNT; i++)          // Time every registered policy
+            policies.push_back(&POLICIES[i]);           // Add it
+
+    std::sort(sizes.begin(), sizes.end());              // Shortest first, so RSS grows with the trace
+
+    if (shards)                                         // If sampled curves are being checked
+        return runShardsEval(workloads, sizes, pages, seed, json);  // Do that instead of timing policies
+
+    if (!json)                                          // CSV starts with a header
+        std::cout << "workload,references,pages,frames,policy,faults,ns_per_ref,peak_rss_kb\n";
+
+    std::vector<int> refs;                              // The current trace
+
+    for (long long size : sizes) {                      // For every length
+        for (const WorkloadSpec &spec : workloads) {    // For every pattern
+            generateWorkload(spec, pages, size, seed, refs);  // Build the trace
+
+            for (int frames : frameList) {              // For every frame count
+                for (const PolicyEntry *policy : policies) {  // For every policy
+                    if (policy->reference &&            // The scanning engines are too slow
+                        (size > BENCH_REFERENCE_LIMIT || frames > MAX_FRAMES))  // Or too small for this run
+                        continue;                       // Skip them
+
+                    auto start = std::chrono::steady_clock::now();  // Time the run
+                    long long faults = policy->run(frames, refs.data(), (int) size, nullptr);  // Count faults only
+                    double ns = std::chrono::duration<double, std::nano>(  // Time per reference
+                        std::chrono::steady_clock::now() - start).count() / size;
+                    long rss = peakRssKb();             // High-water mark so far
+
+                    if (json)                           // One JSON object
+                        std::cout << "{\"workload\":\"" << spec.name << "\",\"references\":" << size <<
+                            ",\"pages\":" << pages << ",\"frames\":" << frames <<
+                            ",\"policy\":\"" << policy->name << "\",\"faults\":" << faults <<
+                            ",\"ns_per_ref\":" << ns << ",\"peak_rss_kb\":" << rss << "}\n";
+                    else                                // One CSV row
+                        std::cout << spec.name << "," << size << "," << pages << "," << frames << "," <<
+                            policy->name << "," << faults << "," << ns << "," << rss << "\n";
+                }                                       // End for loop
+            }                                           // End for loop
+        }                                               // End for loop
+    }                                                   // End for loop
+
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function runBench
@@ -0,0 +1,392 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Binary trace format, all integers little endian:
+ *
+ *   0   char[4]  magic "PGTR"
+ *   4   uint8    format version (1, or 2 with write flags)
+ *   5   char     algorithm hint from the text header
+ *   6   uint16   reserved, zero
+ *   8   uint32   frame count
+ *   12  uint64   number of references
+ *   20  body     one varint per reference
+ *
+ * References are 64-bit page numbers. Each is stored as the difference
+ * from the previous one modulo 2^64 (the first from zero), zigzag-mapped
+ * so small negative steps stay small, then written 7 bits per byte with
+ * the high bit marking that more bytes follow. Sequential and looping
+ * traces mostly take one byte per reference.
+ *
+ * Version 2 traces mark writes. The first byte of each varint holds the
+ * write flag in bit 0 and the low 6 bits of the zigzag value above it;
+ * any remaining bits follow as an ordinary varint. Version 1 is still
+ * written for traces that only read, so their files do not change.
+ */
+
+const char BINARY_TRACE_MAGIC[4] = {'P', 'G', 'T', 'R'};  // First four bytes of every binary trace
+const int BINARY_TRACE_VERSION = 1;                     // Format version of read-only traces
+const int BINARY_TRACE_VERSION_WRITES = 2;              // Format version of traces with write flags
+const int BINARY_HEADER_SIZE = 20;                      // Bytes before the first reference
+
+/**
+ * @brief Map a signed delta onto an unsigned value, small magnitudes first
+ */
+
+inline uint64_t zigzagEncode(int64_t value)
+{
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);  // 0,-1,1,-2,... -> 0,1,2,3,...
+}                                                       // End of function zigzagEncode
+
+/**
+ * @brief Undo zigzagEncode
+ */
+
+inline int64_t zigzagDecode(uint64_t value)
+{
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);  // 0,1,2,3,... -> 0,-1,1,-2,...
+}                                                       // End of function zigzagDecode
+
+/**
+ * @brief Store value in bytes little endian
+ */
+
+inline void putLittleEndian(unsigned char *bytes, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++)                      // For every byte
+        bytes[i] = (unsigned char) (value >> (8 * i));  // Lowest byte first
+}                                                       // End of function putLittleEndian
+
+/**
+ * @brief Read a little-endian value of size bytes
+ */
+
+inline uint64_t getLittleEndian(const unsigned char *bytes, int size)
+{
+    uint64_t value = 0;                                 // Value being assembled
+    for (int i = size - 1; i >= 0; i--)                 // Highest byte first
+        value = (value << 8) | bytes[i];                // Shift in the byte
+    return value;                                       // Return the value
+}                                                       // End of function getLittleEndian
+
+/**
+ * @brief Check whether a file starts with the binary trace magic
+ */
+
+inline bool isBinaryTrace(const char *filename)
+{
+    std::FILE *file = std::fopen(filename, "rb");       // Open file for reading
+    if (file == nullptr)                                // If it cannot be opened
+        return false;                                   // It is not a binary trace we can read
+
+    char magic[4];                                      // First four bytes
+    bool binary = std::fread(magic, 1, 4, file) == 4 && // Read them
+        std::memcmp(magic, BINARY_TRACE_MAGIC, 4) == 0; // And compare with the magic
+    std::fclose(file);                                  // Close the file
+    return binary;                                      // Report the result
+}                                                       // End of function isBinaryTrace
+
+/**
+ * @brief Writes references to a binary trace file
+ */
+
+class BinaryTraceWriter {
+public:
+    BinaryTraceWriter() : file(nullptr), writes(false), failed(false), previous(0), refCount(0), bytes(BINARY_HEADER_SIZE) {}
+
+    ~BinaryTraceWriter() {
+        close();                                        // Finish the file if the caller did not
+    }                                                   // End destructor
+
+    /**
+     * @brief Create filename and write a header with a placeholder count
+     *
+     * @param withWrites Whether every reference carries a write flag (version 2)
+     *
+     * @return false if the file cannot be created
+     */
+
+    bool open(const char *filename, char algo, int frameCount, bool withWrites = false) {
+        file = std::fopen(filename, "wb");              // Create the output file
+        if (file == nullptr)                            // If it could not be created
+            return false;                               // Report the failure
+
+        writes = withWrites;                            // Whether to encode the flags
+        failed = false;                                 // No write has failed yet
+        previous = refCount = 0;                        // Start a fresh body
+        bytes = BINARY_HEADER_SIZE;
+
+        unsigned char header[BINARY_HEADER_SIZE] = {};  // Header bytes
+        std::memcpy(header, BINARY_TRACE_MAGIC, 4);     // Magic
+        header[4] = writes ? BINARY_TRACE_VERSION_WRITES : BINARY_TRACE_VERSION;  // Version
+        header[5] = (unsigned char) algo;               // Algorithm hint
+        putLittleEndian(header + 8, (uint32_t) frameCount, 4);  // Frame count
+        failed = std::fwrite(header, 1, BINARY_HEADER_SIZE, file) != BINARY_HEADER_SIZE;  // Count is patched in close()
+        return true;                                    // The file is ready
+    }                                                   // End of function open
+
+    /**
+     * @brief Append a chunk of references
+     *
+     * @param isWrite Whether each reference writes (version 2 only), or nullptr for all reads
+     */
+
+    void write(const uint64_t refs[], int count, const char isWrite[] = nullptr) {
+        buffer.resize((size_t) count * 11);             // A varint is at most 10 bytes, 11 with the flag
+        unsigned char *out = buffer.data();             // Next byte to fill
+
+        for (int i = 0; i < count; i++) {               // For every reference
+            uint64_t value = zigzagEncode((int64_t) (refs[i] - previous));  // Delta from the last reference, wrapping
+            previous = refs[i];                         // Next delta is from this one
+            if (writes) {                               // If the flags are encoded
+                unsigned char first = (unsigned char) ((value & 0x3f) << 1 | (isWrite != nullptr && isWrite[i]));  // Flag and 6 bits
+                value >>= 6;                            // Drop them
+                if (value == 0) {                       // If nothing is left
+                    *out++ = first;                     // One byte holds it all
+                    continue;                           // Next reference
+                }                                       // End if statement
+                *out++ = (unsigned char) (first | 0x80);  // More to come
+            }                                           // End if statement
+
+            while (value >= 0x80) {                     // While more than 7 bits remain
+                *out++ = (unsigned char) (value | 0x80); // Low 7 bits, more to come
+                value >>= 7;                            // Drop them
+            }                                           // End while loop
+            *out++ = (unsigned char) value; // Final byte
+        }                                               // End for loop
+
+        size_t length = out - buffer.data();            // Bytes produced
+        failed = std::fwrite(buffer.data(), 1, length, file) != length || failed;  // Append them
+        bytes += length;                                // Track the file size
+        refCount += count;                              // Track the reference count
+    }                                                   // End of function write
+
+    /**
+     * @brief Patch the reference count into the header and close the file
+     *
+     * @return false if any write since open failed, including the final flush
+     */
+
+    bool close() {
+        if (file == nullptr)                            // If nothing is open
+            return true;                                // Nothing to finish
+
+        unsigned char count[8];                         // Reference count bytes
+        putLittleEndian(count, refCount, 8);            // Encode the count
+        failed = std::fseek(file, 12, SEEK_SET) != 0 || failed;  // Go back to the count field
+        failed = std::fwrite(count, 1, 8, file) != 8 || failed;  // Overwrite the placeholder
+        failed = std::ferror(file) != 0 || failed;      // Catch errors stdio held back
+        failed = std::fclose(file) != 0 || failed;      // Close the file, flushing the rest
+        file = nullptr;                                 // Mark it closed
+        return !failed;                                 // Report whether it all reached the file
+    }                                                   // End of function close
+
+    uint64_t references() const { return refCount; }    // References written so far
+    uint64_t size() const { return bytes; }             // Bytes written so far
+
+private:
+    std::FILE *file;                                    // Output file
+    bool writes;                                        // Whether references carry write flags
+    bool failed;                                        // Whether a write to the file failed
+    uint64_t previous;                                  // Last reference written
+    uint64_t refCount;                                  // References written
+    uint64_t bytes;                                     // Bytes written, header included
+    std::vector<unsigned char> buffer;                  // Encoded chunk
+};
+
+/**
+ * @brief Zero-copy reader for binary traces
+ *
+ * Maps the whole file and decodes varints straight from the mapping
+ * into the caller's chunk, so there is no read() copy and no text
+ * parsing between the disk cache and the engine loop.
+ */
+
+class BinaryTraceReader {
+public:
+    BinaryTraceReader() : base(nullptr), length(0), cursor(nullptr), end(nullptr),
+                          writes(false), truncated(false), previous(0), remaining(0), algo(0), frameCount(0), refCount(0) {}
+
+    ~BinaryTraceReader() {
+        if (base != nullptr)                            // If a file is mapped
+            munmap(base, length);                       // Unmap it
+    }                                                   // End destructor
+
+    /**
+     * @brief Map filename and check its header
+     *
+     * @return false if the file cannot be mapped or is not a binary trace
+     */
+
+    bool open(const char *filename) {
+        int fd = ::open(filename, O_RDONLY);            // Open file for reading
+        if (fd < 0)                                     // If it cannot be opened
+            return false;                               // Report the failure
+
+        struct stat info;                               // File size
+        if (fstat(fd, &info) != 0 || info.st_size < BINARY_HEADER_SIZE) {  // If it is too small for a header
+            ::close(fd);                                // Close the file
+            return false;                               // Report the failure
+        }                                               // End if statement
+
+        length = (size_t) info.st_size;                 // Size of the mapping
+        void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);  // Map the file
+        ::close(fd);                                    // The mapping keeps the file alive
+        if (mapped == MAP_FAILED)                       // If the mapping failed
+            return false;                               // Report the failure
+
+        base = (unsigned char *) mapped;                // Start of the file
+        madvise(base, length, MADV_SEQUENTIAL);         // The file is read front to back
+
+        if (std::memcmp(base, BINARY_TRACE_MAGIC, 4) != 0 ||  // If the magic is wrong
+            (base[4] != BINARY_TRACE_VERSION && base[4] != BINARY_TRACE_VERSION_WRITES))  // Or the version is unknown
+            return false;                               // It is not a trace we can read
+
+        writes = base[4] == BINARY_TRACE_VERSION_WRITES;  // Whether references carry write flags
+        algo = (char) base[5];                          // Algorithm hint
+        frameCount = (int) getLittleEndian(base + 8, 4);  // Frame count
+        refCount = getLittleEndian(base + 12, 8);       // Number of references
+        remaining = refCount;                           // Every reference is still to come
+        cursor = base + BINARY_HEADER_SIZE;             // First reference
+        end = base + length;                            // End of the file
+        return true;                                    // The trace is ready
+    }                                                   // End of function open
+
+    /**
+     * @brief Decode up to capacity references into refs
+     *
+     * @param isWrite Receives each reference's write flag; left alone unless hasWrites()
+     *
+     * @return Number of references stored; 0 once the trace is exhausted
+     */
+
+    int nextChunk(uint64_t refs[], int capacity, char isWrite[]) {
+        if (writes)                                     // If the references carry write flags
+            return nextChunkWithWrites(refs, capacity, isWrite);  // Decode them too
+
+        int count = 0;                                  // References decoded into this chunk
+        const unsigned char *in = cursor;               // Local copy keeps the loop in registers
+
+        if ((uint64_t) capacity > remaining)            // If the trace ends within this chunk
+            capacity = (int) remaining;                 // Stop at its last reference
+
+        while (count < capacity) {                      // While the chunk has room
+            uint64_t value;                             // Zigzag-encoded delta
+
+            if (in < end && *in < 0x80) {               // Most references fit in one byte
+                value = *in++;                          // Take it directly
+            } else if (!decodeLong(in, value)) {        // Else decode a longer varint
+                remaining = count;                      // The file is truncated; stop after this chunk
+                truncated = true;                       // Note it for the caller
+                break;                                  // Hand out what was decoded
+            }                                           // End if statement
+
+            previous += (uint64_t) zigzagDecode(value); // Undo the delta
+            refs[count++] = previous;                   // Store the reference
+        }                                               // End while loop
+
+        remaining -= count;                             // References still to come
+        cursor = in;                                    // Save the position
+        return count;                                   // Return the size of the chunk
+    }                                                   // End of function nextChunk
+
+    bool hasWrites() const { return writes; }           // Whether the trace marks writes (version 2)
+    char algorithm() const { return algo; }             // Algorithm hint from the header
+    int frames() const { return frameCount; }           // Frame count from the header
+    uint64_t references() const { return refCount; }    // Reference count from the header
+    long long bytesRead() const { return cursor - base; }  // Bytes decoded so far
+    uint64_t last() const { return previous; }          // Last reference decoded, the base of the next delta
+    bool shortBody() const { return truncated; }        // Whether the body ended before the header's count
+
+    /**
+     * @brief Continue decoding at offset, after done references ending in page last
+     *
+     * @return false if offset is outside the body or done is more than the trace holds
+     */
+
+    bool seek(long long offset, uint64_t last, uint64_t done) {
+        if (offset < BINARY_HEADER_SIZE || offset > (long long) length || done > refCount)  // If it cannot be a position in this trace
+            return false;                               // Report the failure
+        cursor = base + offset;                         // Resume at the offset
+        previous = last;                                // Deltas continue from here
+        remaining = refCount - done;                    // References still to come
+        truncated = false;                              // Nothing past here has been decoded
+        return true;                                    // The reader is positioned
+    }                                                   // End of function seek
+
+private:
+    /**
+     * @brief nextChunk for version 2, where the first byte of each varint starts with the write flag
+     */
+
+    int nextChunkWithWrites(uint64_t refs[], int capacity, char isWrite[]) {
+        int count = 0;                                  // References decoded into this chunk
+        const unsigned char *in = cursor;               // Local copy keeps the loop in registers
+
+        if ((uint64_t) capacity > remaining)            // If the trace ends within this chunk
+            capacity = (int) remaining;                 // Stop at its last reference
+
+        while (count < capacity && in < end) {          // While the chunk has room and bytes remain
+            unsigned char first = *in++;                // Flag and low 6 bits
+            uint64_t value = (first >> 1) & 0x3f;       // Zigzag-encoded delta so far
+            uint64_t rest = 0;                          // Bits above the first 6
+
+            if ((first & 0x80) && !decodeLong(in, rest))  // If more bytes follow and they are truncated
+                break;                                  // Hand out what was decoded
+
+            previous += (uint64_t) zigzagDecode(value | rest << 6);  // Undo the delta
+            isWrite[count] = first & 1;                 // Whether it writes
+            refs[count++] = previous;                   // Store the reference
+        }                                               // End while loop
+
+        if (count < capacity) {                         // If the file ended early
+            remaining = count;                          // It is truncated; stop after this chunk
+            truncated = true;                           // Note it for the caller
+        }                                               // End if statement
+        remaining -= count;                             // References still to come
+        cursor = in;                                    // Save the position
+        return count;                                   // Return the size of the chunk
+    }                                                   // End of function nextChunkWithWrites
+
+    /**
+     * @brief Decode a varint of more than one byte at in
+     *
+     * @return false if the varint runs past the end of the file
+     */
+
+    bool decodeLong(const unsigned char *&in, uint64_t &value) {
+        value = 0;                                      // Value being assembled
+
+        for (int shift = 0; shift < 64; shift += 7) {   // At most ten bytes
+            if (in == end)                              // If the file ends mid-varint
+                return false;                           // It is truncated
+            unsigned char byte = *in++;                 // Next byte
+            value |= (uint64_t) (byte & 0x7f) << shift; // Add its 7 bits
+            if (!(byte & 0x80))                         // If this was the last byte
+                return true;                            // The value is complete
+        }                                               // End for loop
+
+        return false;                                   // Too many continuation bytes
+    }                                                   // End of function decodeLong
+
+    unsigned char *base;                                // Start of the mapping
+    size_t length;                                      // Size of the mapping
+    const unsigned char *cursor;                        // Next byte to decode
+    const unsigned char *end;                           // End of the mapping
+    bool writes;                                        // Whether references carry write flags
+    bool truncated;                                     // Whether the body ended before the header's count
+    uint64_t previous;                                  // Last reference decoded
+    uint64_t remaining;                                 // References not yet decoded
+    char algo;                                          // Algorithm hint
+    int frameCount;                                     // Frame count
+    uint64_t refCount;                                  // Number of references
+};
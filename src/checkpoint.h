@@ -0,0 +1,389 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Checkpoint file, all integers in host byte order:
+ *
+ *   0   char[4]  magic "PGCK"
+ *   4   uint32   format version (2)
+ *   8   fields   policy name, frame count, page size, trace size,
+ *                trace position, then the interner and engine state
+ *
+ * Every stateful type describes its fields once, in a member template
+ * persist(Archive &ar) that calls ar(field, field, ...); the writer and
+ * the reader below are the two archives, so saving and loading cannot
+ * drift apart. Trivially copyable fields are copied as raw bytes,
+ * vectors of them in one block, and sets as their sorted elements.
+ */
+
+const char CHECKPOINT_MAGIC[4] = {'P', 'G', 'C', 'K'};  // First four bytes of every checkpoint
+const uint32_t CHECKPOINT_VERSION = 3;                  // Current format version
+
+/**
+ * @brief Archive that writes fields to a checkpoint file
+ */
+
+class CheckpointWriter {
+public:
+    static constexpr bool loading = false;              // persist may rebuild derived state only when loading
+
+    explicit CheckpointWriter(std::FILE *out) : file(out), ok(true) {}
+
+    template <class... T>
+    void operator()(T &... fields) { (put(fields), ...); }  // Write each field in order
+
+    bool good() const { return ok; }                    // Whether every write succeeded
+
+private:
+    template <class T>
+    void put(T &value) {
+        if constexpr (std::is_trivially_copyable<T>::value)  // If it is plain bytes
+            raw(&value, sizeof(value));                 // Copy them
+        else                                            // Else it describes itself
+            value.persist(*this);                       // Write its fields
+    }                                                   // End of function put
+
+    template <class T>
+    void put(std::vector<T> &values) {
+        uint64_t size = values.size();                  // Number of elements
+        raw(&size, sizeof(size));                       // Length first
+        if constexpr (std::is_trivially_copyable<T>::value)  // If the elements are plain bytes
+            raw(values.data(), size * sizeof(T));       // Write them in one block
+        else                                            // Else
+            for (T &value : values)                     // Write them one by one
+                put(value);
+    }                                                   // End of function put
+
+    template <class T>
+    void put(std::set<T> &values) {
+        uint64_t size = values.size();                  // Number of elements
+        raw(&size, sizeof(size));                       // Length first
+        for (T value : values)                          // In sorted order
+            put(value);                                 // Write each element
+    }                                                   // End of function put
+
+    template <class A, class B>
+    void put(std::pair<A, B> &value) { put(value.first); put(value.second); }  // Both halves
+
+    template <class... T>
+    void put(std::tuple<T...> &value) { std::apply([this](T &... fields) { (put(fields), ...); }, value); }  // Every member
+
+    void put(std::string &value) {
+        uint64_t size = value.size();                   // Number of characters
+        raw(&size, sizeof(size));                       // Length first
+        raw(value.data(), size);                        // Then the characters
+    }                                                   // End of function put
+
+    void raw(const void *data, size_t size) {
+        if (size > 0 && std::fwrite(data, 1, size, file) != size)  // If the write falls short
+            ok = false;                                 // Remember the failure
+    }                                                   // End of function raw
+
+    std::FILE *file;                                    // Checkpoint being written
+    bool ok;                                            // Whether every write succeeded
+};
+
+/**
+ * @brief Archive that reads fields back from a checkpoint file
+ */
+
+class CheckpointReader {
+public:
+    static constexpr bool loading = true;               // persist may rebuild derived state now
+
+    explicit CheckpointReader(std::FILE *in) : file(in), ok(true) {}
+
+    template <class... T>
+    void operator()(T &... fields) { (get(fields), ...); }  // Read each field in order
+
+    bool good() const { return ok; }                    // Whether every read succeeded
+    void fail() { ok = false; }                         // persist found state that cannot be right
+
+private:
+    template <class T>
+    void get(T &value) {
+        if constexpr (std::is_trivially_copyable<T>::value)  // If it is plain bytes
+            raw(&value, sizeof(value));                 // Copy them
+        else                                            // Else it describes itself
+            value.persist(*this);                       // Read its fields
+    }                                                   // End of function get
+
+    template <class T>
+    void get(std::vector<T> &values) {
+        uint64_t size = length();                       // Number of elements
+        values.resize(size);                            // Room for them
+        if constexpr (std::is_trivially_copyable<T>::value)  // If the elements are plain bytes
+            raw(values.data(), size * sizeof(T));       // Read them in one block
+        else                                            // Else
+            for (T &value : values)                     // Read them one by one
+                get(value);
+    }                                                   // End of function get
+
+    template <class T>
+    void get(std::set<T> &values) {
+        uint64_t size = length();                       // Number of elements
+        values.clear();                                 // Drop what was there
+        for (uint64_t i = 0; i < size && ok; i++) {     // For every element
+            T value;                                    // The next element
+            get(value);                                 // Read it
+            values.insert(values.end(), value);         // Elements arrive sorted, so append
+        }                                               // End for loop
+    }                                                   // End of function get
+
+    template <class A, class B>
+    void get(std::pair<A, B> &value) { get(value.first); get(value.second); }  // Both halves
+
+    template <class... T>
+    void get(std::tuple<T...> &value) { std::apply([this](T &... fields) { (get(fields), ...); }, value); }  // Every member
+
+    void get(std::string &value) {
+        value.resize(length());                         // Room for the characters
+        raw(&value[0], value.size());                   // Read them
+    }                                                   // End of function get
+
+    /**
+     * @brief Read a length prefix; a truncated or corrupt file reads as zero
+     */
+
+    uint64_t length() {
+        uint64_t size = 0;                              // Length read
+        raw(&size, sizeof(size));                       // Read it
+        if (size > (1ULL << 40))                        // If it cannot be real
+            ok = false;                                 // The file is corrupt
+        return ok ? size : 0;                           // Read nothing more from a bad file
+    }                                                   // End of function length
+
+    void raw(void *data, size_t size) {
+        if (size > 0 && (!ok || std::fread(data, 1, size, file) != size))  // If the read falls short
+            ok = false;                                 // Remember the failure
+    }                                                   // End of function raw
+
+    std::FILE *file;                                    // Checkpoint being read
+    bool ok;                                            // Whether every read succeeded
+};
+
+/**
+ * @brief Where the input stood when a checkpoint was taken
+ */
+
+struct TracePosition {
+    long long offset;                                   // Byte offset of the next unread reference
+    uint64_t previous;                                  // Last page decoded (binary traces are delta coded)
+    long long refs;                                     // References read before the offset
+};
+
+/**
+ * @brief Fields that identify the run a checkpoint belongs to
+ */
+
+struct CheckpointHeader {
+    std::string policy;                                 // --policy name of the engine
+    int frameCount;                                     // Frames the engine uses
+    uint64_t pageSize;                                  // Bytes per page, or 1
+    long long traceBytes;                               // Size of the trace file
+    TracePosition position;                             // Where to resume reading
+    long long lookahead;                                // opt-window's window, or 0 for other policies
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(policy, frameCount, pageSize, traceBytes, position, lookahead); }  // Every field
+};
+
+/**
+ * @brief Size of the file a checkpoint was taken from, or -1 if it has none
+ */
+
+inline long long traceFileSize(const char *filename)
+{
+    struct stat info;                                   // File metadata
+    if (std::string(filename) == "-" || stat(filename, &info) != 0)  // If it is stdin or missing
+        return -1;                                      // There is no size to compare
+    return (long long) info.st_size;                    // Size in bytes
+}                                                       // End of function traceFileSize
+
+/**
+ * @brief Write a checkpoint to path atomically
+ *
+ * The state goes to path.tmp, is flushed to disk, and is renamed over
+ * path, so a crash mid-write leaves the previous checkpoint intact.
+ *
+ * @param save Callback that writes the interner and engine state
+ *
+ * @return false if any write failed
+ */
+
+template <class Save>
+bool writeCheckpoint(const std::string &path,
+                     CheckpointHeader &header,
+                     Save save)
+{
+    std::string temporary = path + ".tmp";              // Written first, then renamed
+    std::FILE *out = std::fopen(temporary.c_str(), "wb");  // Create it
+    if (out == nullptr)                                 // If it cannot be created
+        return false;                                   // Report the failure
+
+    uint32_t version = CHECKPOINT_VERSION;              // Format version
+    CheckpointWriter writer(out);                       // Archive over the file
+    bool ok = std::fwrite(CHECKPOINT_MAGIC, 1, 4, out) == 4;  // Magic first
+    writer(version, header);                            // Then the version and the run
+    save(writer);                                       // Then the state
+
+    ok = ok && writer.good() && std::fflush(out) == 0 && fsync(fileno(out)) == 0;  // Everything must reach the disk
+    ok = std::fclose(out) == 0 && ok;                   // Close it either way
+    if (ok)                                             // If the file is complete
+        ok = std::rename(temporary.c_str(), path.c_str()) == 0;  // Replace the old checkpoint
+    else                                                // Else
+        std::remove(temporary.c_str());                 // Drop the partial file
+    return ok;                                          // Report the result
+}                                                       // End of function writeCheckpoint
+
+/**
+ * @brief Periodically snapshots a running engine without stopping it
+ *
+ * Each checkpoint forks: the child gets a copy-on-write image of the
+ * whole process, writes the checkpoint from it and exits, while the
+ * parent goes straight back to simulating. The parent only pays for
+ * the fork itself (copying page tables, a few milliseconds for a
+ * multi-gigabyte heap), and the kernel copies a page only if the
+ * parent writes to it before the child is done. One checkpoint is in
+ * flight at a time; if the previous child is still writing when the
+ * next is due, that one is skipped.
+ */
+
+class Checkpointer {
+public:
+    Checkpointer(const char *filename, double seconds)
+        : path(filename ? filename : ""), interval(seconds), child(-1), written(0), failed(0), longestPause(0),
+          last(std::chrono::steady_clock::now()) {}
+
+    ~Checkpointer() { finish(); }                       // Never leave a child behind
+
+    bool enabled() const { return !path.empty(); }      // Whether checkpoints were requested
+
+    /**
+     * @brief Whether the interval has passed since the last checkpoint
+     */
+
+    bool due() {
+        if (!enabled())                                 // If checkpoints are off
+            return false;                               // Never
+        reap(false);                                    // Collect a finished child
+        return child == -1 &&                           // Not while one is being written
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - last).count() >= interval;
+    }                                                   // End of function due
+
+    /**
+     * @brief Fork a child that writes the checkpoint; the parent returns at once
+     *
+     * @param save Callback that writes the interner and engine state
+     */
+
+    template <class Save>
+    void take(CheckpointHeader &header,
+              Save save) {
+        auto start = std::chrono::steady_clock::now();  // Time the pause
+        std::fflush(nullptr);                           // The child must not write buffered output twice
+        pid_t pid = fork();                             // Snapshot the process
+
+        if (pid == 0)                                   // If this is the child
+            _exit(writeCheckpoint(path, header, save) ? 0 : 1);  // Write the checkpoint and leave
+
+        last = std::chrono::steady_clock::now();        // Measure the next interval from here
+        double pause = std::chrono::duration<double, std::milli>(last - start).count();  // Time the parent was held up
+        longestPause = std::max(longestPause, pause);   // Keep the worst
+
+        if (pid < 0) {                                  // If the fork failed
+            std::cerr << "Cannot fork to write a checkpoint.\n";  // Print error message
+            failed++;                                   // Count it
+        } else {                                        // Else the child is writing
+            child = pid;                                // Remember it
+        }                                               // End if statement
+    }                                                   // End of function take
+
+    /**
+     * @brief Wait for the checkpoint in flight, if any
+     */
+
+    void finish() { reap(true); }
+
+    int checkpoints() const { return written; }         // Checkpoints written
+    int failures() const { return failed; }             // Checkpoints that could not be written
+    double pauseMs() const { return longestPause; }     // Longest time the engine was held up
+
+private:
+    /**
+     * @brief Collect the child if it has exited (or until it does, if wait is set)
+     */
+
+    void reap(bool wait) {
+        if (child == -1)                                // If nothing is in flight
+            return;                                     // Nothing to collect
+
+        int status;                                     // Child's exit status
+        if (waitpid(child, &status, wait ? 0 : WNOHANG) != child)  // If it is still running
+            return;                                     // Check again later
+
+        child = -1;                                     // Nothing in flight now
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {  // If it wrote the checkpoint
+            written++;                                  // Count it
+        } else {                                        // Else it failed
+            std::cerr << "Cannot write checkpoint '" << path << "'.\n";  // Print error message
+            failed++;                                   // Count it
+        }                                               // End if statement
+    }                                                   // End of function reap
+
+    std::string path;                                   // Checkpoint file, or empty when disabled
+    double interval;                                    // Seconds between checkpoints
+    pid_t child;                                        // Child writing a checkpoint, or -1
+    int written;                                        // Checkpoints written
+    int failed;                                         // Checkpoints that failed
+    double longestPause;                                // Longest fork, in milliseconds
+    std::chrono::steady_clock::time_point last;         // When the last checkpoint was taken
+};
+
+/**
+ * @brief Open a checkpoint and read the run it belongs to
+ *
+ * @param in     Receives the open file, positioned at the state
+ * @param header Receives the run's fields
+ *
+ * @return false if the file is missing or not a checkpoint
+ */
+
+inline bool openCheckpoint(const char *path,
+                           std::FILE *&in,
+                           CheckpointHeader &header)
+{
+    in = std::fopen(path, "rb");                        // Open file for reading
+    if (in == nullptr)                                  // If it cannot be opened
+        return false;                                   // Report the failure
+
+    char magic[4];                                      // Magic from the file
+    uint32_t version = 0;                               // Version from the file
+    CheckpointReader reader(in);                        // Archive over the file
+    bool ok = std::fread(magic, 1, 4, in) == 4 &&       // The magic must be there
+        std::equal(magic, magic + 4, CHECKPOINT_MAGIC); // And be ours
+    if (ok)                                             // If it is
+        reader(version, header);                        // Read the version and the run
+    ok = ok && reader.good() && version == CHECKPOINT_VERSION;  // Which must be complete and current
+
+    if (!ok) {                                          // If it is not a usable checkpoint
+        std::fclose(in);                                // Close it
+        in = nullptr;                                   // Nothing is open
+    }                                                   // End if statement
+    return ok;                                          // Report the result
+}                                                       // End of function openCheckpoint
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Latencies behind the effective access time, in nanoseconds
+ */
+
+struct CostModel {
+    double memoryNs;                                    // One memory access
+    double faultNs;                                     // Servicing a page fault (reading the page in)
+    double writeBackNs;                                 // Writing a dirty victim out first
+};
+
+/**
+ * @brief Parse "memory=200,fault=8e6,writeback=8e6"
+ *
+ * Values are nanoseconds and may use exponents. Missing keys keep their
+ * defaults, a 200 ns memory access and 8 ms for each page read or
+ * written; "default" keeps them all.
+ *
+ * @return false, after printing why, if the description is invalid
+ */
+
+inline bool parseCostModel(const char *text,
+                           CostModel &cost)
+{
+    cost = CostModel{200, 8e6, 8e6};                    // Defaults
+    std::string list = std::string(text) + ",";         // Every item ends in a comma
+    if (list == "default,")                             // If the defaults were asked for
+        return true;                                    // Keep them
+
+    for (size_t start = 0, comma; (comma = list.find(',', start)) != std::string::npos; start = comma + 1) {
+        std::string item = list.substr(start, comma - start);  // The next key=value
+        size_t equals = item.find('=');                 // Where the value starts
+        std::string key = item.substr(0, equals);       // The key
+        const char *value = equals == std::string::npos ? "" : item.c_str() + equals + 1;  // The value
+        char *end;                                      // End of the number
+        double ns = std::strtod(value, &end);           // Latency in nanoseconds
+        bool ok = end != value && *end == '\0' && ns >= 0;  // It must be a whole, non-negative number
+
+        if (key == "memory")                            // Memory access
+            cost.memoryNs = ns;
+        else if (key == "fault")                        // Fault service
+            cost.faultNs = ns;
+        else if (key == "writeback")                    // Write-back
+            cost.writeBackNs = ns;
+        else                                            // Else the key is unknown
+            ok = false;                                 // Reject it
+
+        if (!ok) {                                      // If the item is bad
+            std::cerr << "Bad cost setting '" << item << "'.\n";  // Print error message
+            return false;                               // The description is invalid
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    return true;                                        // Every item parsed
+}                                                       // End of function parseCostModel
+
+/**
+ * @brief Mean time per reference under cost
+ *
+ * Every reference makes one memory access; a fault adds the time to read
+ * the page in, and a fault whose victim was dirty also the time to write
+ * the victim out. Faults are not counted as a second memory access.
+ */
+
+inline double effectiveAccessTime(const CostModel &cost,
+                                  long long references,
+                                  long long faults,
+                                  long long writeBacks)
+{
+    if (references == 0)                                // With no references
+        return 0;                                       // There is no time to spread
+    return cost.memoryNs + (faults * cost.faultNs + writeBacks * cost.writeBackNs) / references;
+}                                                       // End of function effectiveAccessTime
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "simulator.h"
+#include "threadpool.h"
+
+const int PARALLEL_MIN_CHUNK = 1 << 16;                 // Fewest references worth a chunk of their own
+
+/**
+ * @brief Fenwick (binary indexed) tree of counts over positions 0..n-1
+ */
+
+class Fenwick {
+public:
+    /**
+     * @brief Reset to n positions that all count zero
+     */
+
+    void reset(int n) {
+        tree.assign(n + 1, 0);                          // One extra slot; the tree is 1-based
+    }                                                   // End of function reset
+
+    /**
+     * @brief Add delta to the count at position i
+     */
+
+    void add(int i, int delta) {
+        for (i++; i < (int) tree.size(); i += i & -i)   // Climb every node that covers i
+            tree[i] += delta;                           // Update the partial sum
+    }                                                   // End of function add
+
+    /**
+     * @brief Sum of the counts at positions 0..i
+     */
+
+    int prefix(int i) const {
+        int sum = 0;                                    // Running total
+        for (i++; i > 0; i -= i & -i)                   // Descend through the covering nodes
+            sum += tree[i];                             // Add the partial sum
+        return sum;                                     // Return the total
+    }                                                   // End of function prefix
+
+private:
+    std::vector<int> tree;                              // 1-based partial sums
+};
+
+/**
+ * @brief Compute the LRU stack distance of every reference in one pass
+ *
+ * The stack distance of a reference is the number of distinct pages
+ * touched since the previous reference to the same page, counting the
+ * page itself. A Fenwick tree over time marks the latest reference to
+ * every page, so the distance is a range count in O(log n). With k
+ * frames LRU hits exactly the references whose distance is at most k.
+ *
+ * @param refs       Page references
+ * @param refCount   Number of references
+ * @param histogram  histogram[d] receives the number of references at distance d
+ * @param coldMisses Receives the number of first references to a page
+ */
+
+inline void lruStackDistances(const int refs[],
+                              int refCount,
+                              std::vector<long long> &histogram,
+                              long long &coldMisses)
+{
+    Fenwick marks;                                      // 1 at the time of each page's latest reference
+    std::vector<int> lastUse;                           // Time of each page ID's latest reference, or -1
+
+    marks.reset(refCount);                              // One position per reference
+    histogram.assign(1, 0);                             // Distance 0 never occurs
+    coldMisses = 0;                                     // No references yet
+
+    for (int t = 0; t < refCount; t++) {                // Start of for loop over all references
+        int page = refs[t];                             // Get the current page reference
+        if (page >= (int) lastUse.size())               // If the page ID is new
+            lastUse.resize(page + 1, -1);               // Extend the table to cover it
+        int previous = lastUse[page];                   // Previous reference to the page
+
+        if (previous == -1) {                           // If the page has never been referenced
+            coldMisses++;                               // Every frame count faults here
+        } else {                                        // Else count the distinct pages in between
+            int distance = marks.prefix(t - 1) - marks.prefix(previous) + 1;  // Pages touched since, plus this one
+
+            if (distance >= (int) histogram.size())     // If this is the deepest distance so far
+                histogram.resize(distance + 1, 0);      // Make room for it
+            histogram[distance]++;                      // Count the reference
+            marks.add(previous, -1);                    // The old reference is no longer the latest
+        }                                               // End if statement
+
+        marks.add(t, 1);                                // This reference is now the latest
+        lastUse[page] = t;                              // Remember when it happened
+    }                                                   // End for loop
+}                                                       // End of function lruStackDistances
+
+/**
+ * @brief One chunk's share of a parallel stack-distance pass
+ *
+ * A chunk's merge positions are its distinct pages in the order they
+ * are last referenced in the chunk; only those references can still
+ * be a page's latest when a later chunk begins.
+ */
+
+struct StackChunk {
+    int begin;                                          // First reference in the chunk
+    int end;                                            // One past the last reference
+    long long coldMisses;                               // First references to a page anywhere in the trace
+    std::vector<long long> histogram;                   // Distances found for references in the chunk
+    std::vector<int> firstPage;                         // Pages in order of first reference in the chunk
+    std::vector<int> lastRank;                          // Merge position of each of those pages, within the chunk
+    std::vector<int> previous;                          // Global merge position of each page's reference before the chunk, or -1
+    std::vector<int> nextChunk;                         // By merge position: next chunk to touch the page, or the chunk count
+    std::vector<int> later;                             // By merge position: later positions here that outlive nextChunk
+    std::vector<int> survivors;                         // survivors[k]: positions here not touched again before chunk k
+};
+
+/**
+ * @brief Stack distances of the references whose reuse stays inside one chunk
+ *
+ * If the previous reference to a page is in the same chunk, every page
+ * touched in between is too, so the local distance is already exact.
+ * First references within the chunk are left for the merge, in order,
+ * along with the order in which the pages are last referenced.
+ */
+
+inline void chunkStackDistances(const int refs[],
+                                StackChunk &chunk)
+{
+    Fenwick marks;                                      // 1 at each page's latest reference, relative to begin
+    std::vector<int> lastUse;                           // Local time of each page ID's latest reference, or -1
+
+    marks.reset(chunk.end - chunk.begin);               // One position per reference in the chunk
+    chunk.histogram.assign(1, 0);                       // Distance 0 never occurs
+    chunk.firstPage.clear();                            // No pages yet
+
+    for (int t = 0; t < chunk.end - chunk.begin; t++) { // For every reference in the chunk
+        int page = refs[chunk.begin + t];               // Get the current page reference
+        if (page >= (int) lastUse.size())               // If the page ID is new
+            lastUse.resize(page + 1, -1);               // Extend the table to cover it
+        int previous = lastUse[page];                   // Previous reference within the chunk
+
+        if (previous == -1) {                           // If this is the page's first reference here
+            chunk.firstPage.push_back(page);            // Resolve it in the merge
+        } else {                                        // Else the distance is exact already
+            int distance = marks.prefix(t - 1) - marks.prefix(previous) + 1;  // Pages touched since, plus this one
+
+            if (distance >= (int) chunk.histogram.size())  // If this is the deepest distance so far
+                chunk.histogram.resize(distance + 1, 0);  // Make room for it
+            chunk.histogram[distance]++;                // Count the reference
+            marks.add(previous, -1);                    // The old reference is no longer the latest
+        }                                               // End if statement
+
+        marks.add(t, 1);                                // This reference is now the latest
+        lastUse[page] = t;                              // Remember when it happened
+    }                                                   // End for loop
+
+    int rank = 0;                                       // Last references seen so far
+    for (int t = 0; t < chunk.end - chunk.begin; t++) { // In time order
+        int page = refs[chunk.begin + t];               // Page referenced at t
+        if (lastUse[page] == t)                         // If this is its last reference
+            lastUse[page] = rank++;                     // Replace the time with its rank
+    }                                                   // End for loop
+
+    chunk.lastRank.resize(chunk.firstPage.size());      // One per distinct page
+    for (size_t i = 0; i < chunk.firstPage.size(); i++) // For every page the chunk touched
+        chunk.lastRank[i] = lastUse[chunk.firstPage[i]];  // Its rank
+}                                                       // End of function chunkStackDistances
+
+/**
+ * @brief Count, for each merge position, the later ones that outlive it
+ *
+ * survivors[k] counts the chunk's positions whose page is not touched
+ * again before chunk k. later[u] counts the positions after u whose
+ * page is not touched again before u's own page is, which is the part
+ * of the chunk that lies between u and that next reference.
+ *
+ * @param chunk      The chunk, with nextChunk filled in
+ * @param chunkCount Number of chunks
+ */
+
+inline void chunkSurvivors(StackChunk &chunk,
+                           int chunkCount)
+{
+    int count = (int) chunk.nextChunk.size();           // Merge positions in the chunk
+    std::vector<int> byNext(chunkCount + 1, 0);         // Positions by the chunk that next touches them
+    Fenwick seen;                                       // Positions already passed, by next chunk
+    seen.reset(chunkCount + 1);                         // One slot per chunk, plus never
+    chunk.later.assign(count, 0);                       // Filled from the end
+
+    for (int u = count - 1; u >= 0; u--) {              // From the latest position back
+        int next = chunk.nextChunk[u];                  // Chunk that next touches this page
+        chunk.later[u] = (count - 1 - u) - seen.prefix(next - 1);  // Later positions that are not touched before next
+        seen.add(next, 1);                              // Count this one for earlier positions
+        byNext[next]++;                                 // And for the survivor table
+    }                                                   // End for loop
+
+    chunk.survivors.assign(chunkCount + 1, 0);          // Suffix sums of byNext
+    chunk.survivors[chunkCount] = byNext[chunkCount];   // Pages never touched again
+    for (int k = chunkCount - 1; k >= 0; k--)           // From the last chunk back
+        chunk.survivors[k] = chunk.survivors[k + 1] + byNext[k];
+}                                                       // End of function chunkSurvivors
+
+/**
+ * @brief Resolve the first reference to each page in chunk k
+ *
+ * For the i-th distinct page of chunk k, last referenced at merge
+ * position s in chunk j, the distinct pages in between are: the pages
+ * after s in chunk j and the pages of chunks j+1..k-1 that are not
+ * touched again before chunk k, less the ones chunk k has already
+ * touched (earlier first references whose own previous position lies
+ * after s), plus the i pages chunk k has touched so far.
+ *
+ * @param chunks The chunks, with previous, later and survivors filled in
+ * @param offset First merge position of each chunk
+ * @param k      Chunk to resolve
+ */
+
+inline void resolveChunk(std::vector<StackChunk> &chunks,
+                         const std::vector<int> &offset,
+                         int k)
+{
+    StackChunk &chunk = chunks[k];                      // The chunk
+    std::vector<int> sorted;                            // Previous positions, for ranking
+    for (int s : chunk.previous)                        // Every page seen before the chunk
+        if (s != -1)
+            sorted.push_back(s);
+    std::sort(sorted.begin(), sorted.end());            // Rank them by position
+
+    std::vector<long long> beyond(k + 1, 0);            // beyond[j]: survivors of chunks j+1..k-1 at chunk k
+    for (int m = k - 1; m > 0; m--)                     // From the nearest chunk back
+        beyond[m - 1] = beyond[m] + chunks[m].survivors[k];
+
+    Fenwick moved;                                      // Previous positions of the pages chunk k has touched
+    moved.reset((int) sorted.size());                   // One slot per such page
+    int movedCount = 0;                                 // Pages added to moved
+    chunk.coldMisses = 0;                               // None yet
+
+    for (int i = 0; i < (int) chunk.previous.size(); i++) {  // For every first reference in the chunk
+        int s = chunk.previous[i];                      // Its page's previous merge position
+        if (s == -1) {                                  // If the page has never been referenced
+            chunk.coldMisses++;                         // Every frame count faults here
+            continue;                                   // Nothing else to count
+        }                                               // End if statement
+
+        int j = (int) (std::upper_bound(offset.begin(), offset.end(), s) - offset.begin()) - 1;  // Chunk holding s
+        long long between = chunks[j].later[s - offset[j]] + beyond[j];  // Rest of chunk j, and the chunks in between
+
+        int r = (int) (std::lower_bound(sorted.begin(), sorted.end(), s) - sorted.begin());  // Rank of s
+        between -= movedCount - moved.prefix(r);        // Pages already pulled into chunk k from after s
+        moved.add(r, 1);                                // This page is pulled in too
+        movedCount++;
+
+        long long distance = between + i + 1;           // Plus the chunk's pages so far, plus this one
+        if (distance >= (long long) chunk.histogram.size())  // If this is the deepest distance so far
+            chunk.histogram.resize(distance + 1, 0);    // Make room for it
+        chunk.histogram[distance]++;                    // Count the reference
+    }                                                   // End for loop
+}                                                       // End of function resolveChunk
+
+/**
+ * @brief lruStackDistances split into chunks that run on a thread pool
+ *
+ * Each chunk resolves its internal reuses independently. Only the
+ * first reference to each page in a chunk reaches further back; one
+ * short sequential pass over the chunks' distinct pages finds where
+ * each was previously referenced, and the distances are then counted
+ * in parallel again (see chunkSurvivors and resolveChunk). The result
+ * is identical to the sequential pass.
+ *
+ * @param refs       Page IDs
+ * @param refCount   Number of references
+ * @param threads    Worker threads, or 0 for one per hardware thread
+ * @param histogram  histogram[d] receives the number of references at distance d
+ * @param coldMisses Receives the number of first references to a page
+ */
+
+inline void parallelStackDistances(const int refs[],
+                                   int refCount,
+                                   int threads,
+                                   std::vector<long long> &histogram,
+                                   long long &coldMisses)
+{
+    WorkStealingPool pool(threads);                     // Workers for the chunks
+    int chunkCount = std::max(1, std::min(pool.size(), refCount / PARALLEL_MIN_CHUNK));  // One chunk per worker, unless the trace is short
+    std::vector<StackChunk> chunks(chunkCount);         // The chunks, in trace order
+
+    for (int k = 0; k < chunkCount; k++) {              // For every chunk
+        chunks[k].begin = (int) ((long long) refCount * k / chunkCount);  // Split the trace evenly
+        chunks[k].end = (int) ((long long) refCount * (k + 1) / chunkCount);
+        pool.submit([refs, &chunks, k] { chunkStackDistances(refs, chunks[k]); });  // Resolve its internal reuses
+    }                                                   // End for loop
+    pool.wait();                                        // Every chunk must finish before the merge
+
+    std::vector<int> offset(chunkCount + 1, 0);         // First merge position of each chunk
+    for (int k = 0; k < chunkCount; k++) {              // Chunks take one position per distinct page
+        offset[k + 1] = offset[k] + (int) chunks[k].firstPage.size();
+        chunks[k].nextChunk.assign(chunks[k].firstPage.size(), chunkCount);  // Never touched again, so far
+    }                                                   // End for loop
+
+    std::vector<int> lastUse;                           // Merge position of each page ID's latest reference, or -1
+
+    for (int k = 0; k < chunkCount; k++) {              // In trace order
+        StackChunk &chunk = chunks[k];                  // The chunk
+        chunk.previous.resize(chunk.firstPage.size());  // One per distinct page
+
+        for (size_t i = 0; i < chunk.firstPage.size(); i++) {  // For every page the chunk touched
+            int page = chunk.firstPage[i];              // The page
+            if (page >= (int) lastUse.size())           // If the page ID is new
+                lastUse.resize(page + 1, -1);           // Extend the table to cover it
+            int s = lastUse[page];                      // Its latest merge position before the chunk
+            chunk.previous[i] = s;                      // Resolve against it later
+
+            if (s != -1) {                              // If it was referenced before
+                int j = (int) (std::upper_bound(offset.begin(), offset.end(), s) - offset.begin()) - 1;  // Chunk holding s
+                chunks[j].nextChunk[s - offset[j]] = k; // That position lives until this chunk
+            }                                           // End if statement
+            lastUse[page] = offset[k] + chunk.lastRank[i];  // Now the latest is in this chunk
+        }                                               // End for loop
+    }                                                   // End for loop
+
+    for (int k = 0; k < chunkCount; k++)                // Count what outlives each position
+        pool.submit([&chunks, chunkCount, k] { chunkSurvivors(chunks[k], chunkCount); });
+    pool.wait();                                        // Every chunk's counts are needed by the later ones
+
+    for (int k = 0; k < chunkCount; k++)                // Resolve every chunk's first references
+        pool.submit([&chunks, &offset, k] { resolveChunk(chunks, offset, k); });
+    pool.wait();                                        // Every chunk must finish before summing
+
+    histogram.assign(1, 0);                             // Distance 0 never occurs
+    coldMisses = 0;                                     // No references yet
+
+    for (const StackChunk &chunk : chunks) {            // Sum the chunks
+        if (chunk.histogram.size() > histogram.size())  // If the chunk saw deeper distances
+            histogram.resize(chunk.histogram.size(), 0);  // Make room for them
+        for (size_t d = 0; d < chunk.histogram.size(); d++)  // Add its distances
+            histogram[d] += chunk.histogram[d];
+        coldMisses += chunk.coldMisses;                 // And its cold misses
+    }                                                   // End for loop
+}                                                       // End of function parallelStackDistances
+
+/**
+ * @brief LRU page faults with frames frames, from a stack-distance histogram
+ */
+
+inline long long lruFaults(const std::vector<long long> &histogram,
+                           int refCount,
+                           int frames)
+{
+    long long faults = refCount;                        // With zero frames every reference faults
+    for (int d = 1; d <= frames && d < (int) histogram.size(); d++)  // Every distance that fits
+        faults -= histogram[d];                         // Hits once this many frames exist
+    return faults;                                      // Return the number of page faults
+}                                                       // End of function lruFaults
+
+/**
+ * @brief Print the miss-ratio curve as CSV of faults against frame count
+ *
+ * LRU comes from a single stack-distance pass. FIFO is not a stack
+ * algorithm (Belady's anomaly), so it is simulated once per frame count.
+ * With more than one thread the stack-distance pass is split into
+ * chunks and the FIFO runs are spread over the pool.
+ *
+ * @param refs      Page references
+ * @param refCount  Number of references
+ * @param maxFrames Largest frame count in the sweep
+ * @param threads   Worker threads, 1 for a sequential pass, or 0 for one per hardware thread
+ */
+
+inline void printMissCurve(const int refs[],
+                           int refCount,
+                           int maxFrames,
+                           int threads)
+{
+    std::vector<long long> histogram;                   // References at each stack distance
+    long long coldMisses;                               // First references to a page
+    std::vector<long long> fifoFaults(maxFrames + 1);   // FIFO faults at each size
+
+    if (threads == 1) {                                 // If everything runs here
+        lruStackDistances(refs, refCount, histogram, coldMisses);  // One pass for every LRU size
+
+        Simulator<FifoPolicy, false> fifo;              // FIFO engine rerun for each size
+        for (int frames = 1; frames <= maxFrames; frames++) {  // For every size
+            fifo.init(frames);                          // Start with empty frames
+            fifo.run(refs, refCount);                   // Simulate FIFO at this size
+            fifoFaults[frames] = fifo.pageFaults;       // Keep the count
+        }                                               // End for loop
+    } else {                                            // Else use the pool
+        parallelStackDistances(refs, refCount, threads, histogram, coldMisses);  // Chunked pass for every LRU size
+
+        WorkStealingPool pool(threads);                 // Workers for the FIFO runs
+        for (int frames = 1; frames <= maxFrames; frames++)  // One task per size
+            pool.submit([refs, refCount, frames, &fifoFaults] {
+                Simulator<FifoPolicy, false> fifo;      // This size's engine
+                fifo.init(frames);                      // Start with empty frames
+                fifo.run(refs, refCount);               // Simulate FIFO at this size
+                fifoFaults[frames] = fifo.pageFaults;   // Keep the count
+            });
+        pool.wait();                                    // Every size must finish before printing
+    }                                                   // End if statement
+
+    long long lruFaults = refCount;                     // With zero frames every reference faults
+
+    std::cout << "frames,lru_faults,fifo_faults\n";     // CSV header
+
+    for (int frames = 1; frames <= maxFrames; frames++) {  // Start of for loop over the sweep
+        if (frames < (int) histogram.size())            // If some references sit at this distance
+            lruFaults -= histogram[frames];             // They hit once this many frames exist
+
+        std::cout << frames << "," << lruFaults << "," <<  // Display one row of the curve
+            fifoFaults[frames] << "\n";
+    }                                                   // End for loop
+}                                                       // End of function printMissCurve
+
+/**
+ * @brief Print how far windowed OPT falls behind exact OPT as the window grows
+ *
+ * Exact OPT is run once; each window size is a separate streaming run
+ * at the same frame count, so a row costs O(refCount log frameCount)
+ * time but only O(window + frameCount) policy memory.
+ *
+ * @param refs       Page references
+ * @param refCount   Number of references
+ * @param frameCount Frames both policies may use
+ * @param windows    Lookahead sizes to try
+ */
+
+inline void printLookaheadCurve(const int refs[],
+                                int refCount,
+                                int frameCount,
+                                const std::vector<long long> &windows)
+{
+    long long optFaults = simulate<OptPolicy>(frameCount, refs, refCount, nullptr);  // The bound every window approaches
+    int saved = WindowedOptPolicy::lookahead;           // Window to restore afterwards
+
+    std::cout << "window,faults,opt_faults,excess_faults,excess_pct\n";  // CSV header
+
+    for (long long window : windows) {                  // For every window size
+        WindowedOptPolicy::lookahead = (int) window;    // Use it for this run
+        long long faults = simulateLookahead(frameCount, refs, refCount, nullptr);  // Windowed OPT at this size
+        long long excess = faults - optFaults;          // Faults a shorter view costs
+
+        std::cout << window << "," << faults << "," << optFaults << "," << excess << "," <<
+            (optFaults > 0 ? 100.0 * excess / optFaults : 0) << "\n";  // Display one row
+    }                                                   // End for loop
+
+    WindowedOptPolicy::lookahead = saved;               // Put the window back
+}                                                       // End of function printLookaheadCurve
@@ -0,0 +1,526 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "intern.h"
+#include "registry.h"
+#include "ring.h"
+#include "sweep.h"
+
+const int DAEMON_RING_SIZE = 1024;                      // Batches that can wait between the threads
+const int DAEMON_LINE_SIZE = 1 << 16;                   // Bytes read from a connection per call
+const size_t DAEMON_MAX_LINE = 1 << 24;                 // Longest line accepted; longer ones are refused whole
+const int LATENCY_BUCKETS = 16 + 60 * 8;                // Exact below 16 ns, then 8 per power of two
+
+/**
+ * @brief Spin, then yield, then sleep while waiting on the ring
+ *
+ * @param idle Consecutive failed attempts; reset it after a success
+ */
+
+inline void backoff(int &idle)
+{
+    idle++;                                             // One more failed attempt
+    if (idle < 64)                                      // Briefly, keep the core
+        return;
+    if (idle < 1024)                                    // Then let others run
+        std::this_thread::yield();
+    else                                                // Then stop burning the core
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+}                                                       // End of function backoff
+
+/**
+ * @brief Log-linear latency histogram that one thread fills and any thread reads
+ *
+ * Buckets are exact below 16 ns and then split each power of two into
+ * eight, so a percentile is within 12.5% of the true value. The counts
+ * are relaxed atomics: a reader may see a recording half-finished, but
+ * never has to stop the writer.
+ */
+
+class LatencyHistogram {
+public:
+    LatencyHistogram() {
+        for (std::atomic<long long> &bucket : buckets)  // Every bucket
+            bucket.store(0, std::memory_order_relaxed); // Starts empty
+    }                                                   // End constructor
+
+    /**
+     * @brief Count one latency of ns nanoseconds
+     */
+
+    void record(uint64_t ns) {
+        std::atomic<long long> &bucket = buckets[bucketOf(ns)];  // Where it belongs
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);  // Single writer, so no RMW
+    }                                                   // End of function record
+
+    /**
+     * @brief Latency at quantile q (0..1) in microseconds, or 0 with no samples
+     */
+
+    double percentile(double q) const {
+        long long counts[LATENCY_BUCKETS];              // One consistent-enough copy
+        long long total = 0;                            // Samples in the copy
+        for (int b = 0; b < LATENCY_BUCKETS; b++)       // Every bucket
+            total += counts[b] = buckets[b].load(std::memory_order_relaxed);
+        if (total == 0)                                 // If nothing was recorded
+            return 0;                                   // There is no latency yet
+
+        long long rank = (long long) (q * total);       // Samples at or below the answer, minus one
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {     // Walk up the buckets
+            rank -= counts[b];                          // Pass this bucket
+            if (rank < 0)                               // If the quantile falls in it
+                return middle(b) / 1000;                // Report its middle
+        }                                               // End for loop
+        return middle(LATENCY_BUCKETS - 1) / 1000;      // Unreachable with a consistent copy
+    }                                                   // End of function percentile
+
+private:
+    /**
+     * @brief Bucket index of ns
+     */
+
+    static int bucketOf(uint64_t ns) {
+        if (ns < 16)                                    // Small values get their own bucket
+            return (int) ns;
+        int e = 63 - __builtin_clzll(ns);               // ns lies in [2^e, 2^(e+1))
+        return 16 + (e - 4) * 8 + (int) ((ns >> (e - 3)) & 7);  // The three bits after the leading one
+    }                                                   // End of function bucketOf
+
+    /**
+     * @brief Middle of bucket b, in nanoseconds
+     */
+
+    static double middle(int b) {
+        if (b < 16)                                     // Exact buckets
+            return b;
+        int e = (b - 16) / 8 + 4;                       // Power of two
+        double width = std::ldexp(1.0, e - 3);          // Eight buckets per power of two
+        return (8 + (b - 16) % 8) * width + width / 2;  // Start of the bucket plus half its width
+    }                                                   // End of function middle
+
+    std::atomic<long long> buckets[LATENCY_BUCKETS];    // Samples per bucket
+};
+
+/**
+ * @brief References parsed from one input line, on their way to the simulator
+ */
+
+struct DaemonBatch {
+    std::vector<uint64_t> pages;                        // Page numbers in the batch
+    std::chrono::steady_clock::time_point received;     // When the line had been parsed
+    bool last;                                          // Whether this marks the end of input
+};
+
+/**
+ * @brief Counters the simulator thread publishes and the reader thread reports
+ *
+ * Each counter has a single writer, which brackets every batch's updates
+ * with beginUpdate and endUpdate. Readers take snapshot without locking
+ * and retry while an update is under way, so a report always pairs the
+ * faults and references of the same batch and never stalls ingestion.
+ */
+
+struct DaemonStats {
+    explicit DaemonStats(int policyCount) : faults(new std::atomic<long long>[policyCount]) {
+        version = 0;                                    // No update under way
+        references = 0;                                 // Nothing simulated yet
+        batches = 0;
+        pages = 0;
+        for (int p = 0; p < policyCount; p++)           // Every policy
+            faults[p] = 0;                              // Starts with no faults
+    }                                                   // End constructor
+
+    void beginUpdate() {
+        version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);  // Odd: the counters are changing
+        std::atomic_thread_fence(std::memory_order_release);  // Before any counter does
+    }                                                   // End of function beginUpdate
+
+    void endUpdate() {
+        version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);  // Even again, after every counter
+    }                                                   // End of function endUpdate
+
+    /**
+     * @brief Copy the references, pages and per-policy faults of one moment
+     */
+
+    void snapshot(long long &refs, long long &pageCount, long long faultsOut[], int policyCount) const {
+        while (true) {                                  // Until a copy is not torn by an update
+            long long before = version.load(std::memory_order_acquire);  // Version the copy starts from
+            if (before & 1) {                           // If an update is under way
+                std::this_thread::yield();              // Let it finish
+                continue;                               // Try again
+            }                                           // End if statement
+            refs = references.load(std::memory_order_relaxed);  // Copy the counters
+            pageCount = pages.load(std::memory_order_relaxed);
+            for (int p = 0; p < policyCount; p++)
+                faultsOut[p] = faults[p].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);  // Before checking the version again
+            if (version.load(std::memory_order_relaxed) == before)  // If nothing changed meanwhile
+                return;                                 // The copy is consistent
+        }                                               // End while loop
+    }                                                   // End of function snapshot
+
+    std::atomic<long long> version;                     // Updates begun plus updates ended; odd during one
+    std::atomic<long long> references;                  // References simulated
+    std::atomic<long long> batches;                     // Batches simulated
+    std::atomic<long long> pages;                       // Distinct pages seen
+    std::unique_ptr<std::atomic<long long>[]> faults;   // Page faults per policy
+    LatencyHistogram latency;                           // Receipt-to-simulated time per batch
+};
+
+/**
+ * @brief Simulator thread: drain the ring into the engines until the end marker
+ *
+ * @param ring     Batches from the reader thread
+ * @param policies Policies to keep resident
+ * @param frames   Frames each policy may use
+ * @param stats    Where the results are published
+ */
+
+inline void simulateBatches(SpscRing<DaemonBatch> &ring,
+                            const std::vector<const PolicyEntry *> &policies,
+                            int frames,
+                            DaemonStats &stats)
+{
+    std::vector<std::unique_ptr<Engine>> engines;       // One resident engine per policy
+    for (const PolicyEntry *policy : policies)          // For every policy
+        engines.push_back(policy->make(frames));        // Start it with empty frames
+
+    PageInterner pages;                                 // Dense IDs for the engines
+    std::vector<int> ids;                               // The current batch as IDs
+    DaemonBatch batch;                                  // The current batch
+    int idle = 0;                                       // Failed pops in a row
+
+    while (true) {                                      // Until the end marker
+        if (!ring.tryPop(batch)) {                      // If nothing is waiting
+            backoff(idle);                              // Wait a little
+            continue;                                   // Try again
+        }                                               // End if statement
+        idle = 0;                                       // Work arrived
+        if (batch.last) {                               // If the input is finished
+            stats.beginUpdate();                        // Readers wait for the final counts
+            for (size_t p = 0; p < engines.size(); p++) {  // For every policy
+                engines[p]->finish();                   // Settle references it is holding back
+                stats.faults[p].store(engines[p]->pageFaults(), std::memory_order_relaxed);  // Publish its final faults
+            }                                           // End for loop
+            stats.endUpdate();
+            return;                                     // Stop
+        }                                               // End if statement
+
+        int count = (int) batch.pages.size();           // References in the batch
+        ids.resize(count);                              // Room for their IDs
+        pages.intern(batch.pages.data(), count, ids.data());  // Replace each page with its ID
+
+        for (size_t p = 0; p < engines.size(); p++)     // For every policy
+            engines[p]->run(ids.data(), count);         // Simulate the batch
+
+        stats.beginUpdate();                            // Publish the batch as one update
+        for (size_t p = 0; p < engines.size(); p++)     // For every policy
+            stats.faults[p].store(engines[p]->pageFaults(), std::memory_order_relaxed);  // Its faults
+        stats.pages.store(pages.size(), std::memory_order_relaxed);  // And the rest
+        stats.references.store(stats.references.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+        stats.endUpdate();
+        stats.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(  // Time since the line was parsed
+            std::chrono::steady_clock::now() - batch.received).count());
+        stats.batches.store(stats.batches.load(std::memory_order_relaxed) + 1, std::memory_order_release);  // Last, so sync sees the rest
+    }                                                   // End while loop
+}                                                       // End of function simulateBatches
+
+/**
+ * @brief Write all of text to fd
+ *
+ * @return false if the peer has gone away
+ */
+
+inline bool writeAll(int fd,
+                     const std::string &text)
+{
+    size_t done = 0;                                    // Bytes written so far
+    while (done < text.size()) {                        // Until everything is out
+        ssize_t n = write(fd, text.data() + done, text.size() - done);  // Write what the kernel takes
+        if (n <= 0)                                     // If the peer is gone
+            return false;                               // Report it
+        done += n;                                      // Account for it
+    }                                                   // End while loop
+    return true;                                        // Everything was written
+}                                                       // End of function writeAll
+
+/**
+ * @brief Format the published counters as one JSON line
+ */
+
+inline std::string formatStats(const DaemonStats &stats,
+                               const std::vector<const PolicyEntry *> &policies,
+                               int frames,
+                               size_t pending)
+{
+    long long references;                               // References simulated
+    long long pages;                                    // Distinct pages seen
+    std::vector<long long> faults(policies.size());     // Faults per policy, from the same batch
+    stats.snapshot(references, pages, faults.data(), (int) policies.size());  // Copy them together
+    char number[64];                                    // Formatted floating-point values
+
+    std::string text = "{\"references\":" + std::to_string(references) +  // Totals
+        ",\"batches\":" + std::to_string(stats.batches.load(std::memory_order_relaxed)) +
+        ",\"pending\":" + std::to_string(pending) +
+        ",\"pages\":" + std::to_string(pages);
+    std::snprintf(number, sizeof number, ",\"p50_us\":%.3f,\"p99_us\":%.3f",  // Batch latency
+                  stats.latency.percentile(0.50), stats.latency.percentile(0.99));
+    text += number;
+    text += ",\"policies\":[";
+
+    for (size_t p = 0; p < policies.size(); p++) {      // For every policy
+        if (p > 0)                                      // Separate the entries
+            text += ",";
+        text += "{\"policy\":\"" + std::string(policies[p]->name) + "\",\"frames\":" + std::to_string(frames) +
+            ",\"faults\":" + std::to_string(faults[p]);
+        std::snprintf(number, sizeof number, ",\"hit_ratio\":%.6f",  // Hits over references
+                      references > 0 ? 1 - (double) faults[p] / references : 0.0);
+        text += number;
+        text += ",\"resident\":" + std::to_string(std::min<long long>(pages, frames)) + "}";  // Demand paging fills every frame before evicting
+    }                                                   // End for loop
+
+    return text + "]}\n";                               // Close the object
+}                                                       // End of function formatStats
+
+/**
+ * @brief Reader thread: parse one connection's lines and answer its queries
+ *
+ * A line of numbers is a batch of references; "stats" reports the
+ * published counters at once, "sync" first waits for every queued batch
+ * to be simulated, and "shutdown" stops the daemon. A trailing carriage
+ * return is ignored. Any other line, a batch with anything but digits
+ * and whitespace in it, or a line longer than DAEMON_MAX_LINE gets an
+ * error reply and queues nothing.
+ *
+ * @param in       Descriptor to read
+ * @param out      Descriptor for replies
+ * @param ring     Batches for the simulator thread
+ * @param pushed   Batches queued so far, across connections
+ * @param pageSize Bytes per page if references are addresses, else 1
+ * @param stats    Counters published by the simulator thread
+ * @param policies Policies the counters belong to
+ * @param frames   Frames each policy may use
+ *
+ * @return true if the daemon was asked to shut down
+ */
+
+inline bool serveConnection(int in,
+                            int out,
+                            SpscRing<DaemonBatch> &ring,
+                            long long &pushed,
+                            uint64_t pageSize,
+                            const DaemonStats &stats,
+                            const std::vector<const PolicyEntry *> &policies,
+                            int frames)
+{
+    std::vector<char> buffer(DAEMON_LINE_SIZE);         // Raw input
+    std::string line;                                   // Line being assembled
+    bool tooLong = false;                               // Whether the line passed DAEMON_MAX_LINE
+    int idle = 0;                                       // Failed pushes in a row
+
+    while (true) {                                      // Until the connection closes
+        ssize_t n = read(in, buffer.data(), buffer.size());  // Whatever has arrived
+        if (n <= 0)                                     // If the peer is done
+            return false;                               // Keep the daemon running
+
+        for (ssize_t i = 0; i < n; i++) {               // For every byte
+            if (buffer[i] != '\n') {                    // If the line goes on
+                if (line.size() < DAEMON_MAX_LINE)      // If it is still within bounds
+                    line += buffer[i];                  // Collect it
+                else                                    // Else stop growing
+                    tooLong = true;                     // And refuse the line at its end
+                continue;
+            }                                           // End if statement
+
+            if (!line.empty() && line.back() == '\r')   // If the client ends lines with CRLF
+                line.pop_back();                        // Drop the carriage return
+
+            if (tooLong) {                              // If the line was cut off
+                if (!writeAll(out, "{\"error\":\"line too long\"}\n"))  // Say so
+                    return false;                       // The peer is gone
+                tooLong = false;
+            } else if (line == "stats" || line == "sync") {  // If counters were asked for
+                if (line == "sync")                     // If they must cover everything sent so far
+                    while (stats.batches.load(std::memory_order_acquire) < pushed)  // Until the simulator catches up
+                        backoff(idle);
+                if (!writeAll(out, formatStats(stats, policies, frames, ring.size())))  // Reply
+                    return false;                       // The peer is gone
+            } else if (line == "shutdown") {            // If the daemon should stop
+                return true;                            // Report it
+            } else {                                    // Else the line is a batch
+                DaemonBatch batch;                      // The batch
+                const char *error = nullptr;            // Why the batch is refused, if it is
+                uint64_t value = 0;                     // Number being parsed
+                bool inNumber = false;                  // Whether digits are being read
+
+                for (size_t c = 0; c <= line.size() && error == nullptr; c++) {  // Every character, plus one to end the last number
+                    char ch = c < line.size() ? line[c] : ' ';  // The end of the line ends a number too
+                    if (ch >= '0' && ch <= '9') {       // If it is a digit
+                        uint64_t digit = ch - '0';      // Its value
+                        if (value > (~0ULL - digit) / 10)  // If it would not fit
+                            error = "{\"error\":\"reference does not fit in 64 bits\"}\n";
+                        value = value * 10 + digit;     // Accumulate it
+                        inNumber = true;
+                    } else if (ch != ' ' && ch != '\t') {  // Else anything but whitespace is a mistake
+                        error = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ?  // A word is most likely a mistyped command
+                            "{\"error\":\"unknown command\"}\n" :
+                            "{\"error\":\"a batch holds only digits and whitespace\"}\n";
+                    } else if (inNumber) {              // Else a number just ended
+                        if (value / pageSize == PageInterner::RESERVED)  // If its page marks empty hash slots
+                            error = "{\"error\":\"page 2^64-1 is reserved\"}\n";
+                        batch.pages.push_back(value / pageSize);  // Add its page
+                        value = 0;
+                        inNumber = false;
+                    }                                   // End if statement
+                }                                       // End for loop
+
+                if (error != nullptr) {                 // If the batch is unusable
+                    if (!writeAll(out, error))          // Say why
+                        return false;                   // The peer is gone
+                } else if (!batch.pages.empty()) {      // Else queue anything it holds
+                    batch.received = std::chrono::steady_clock::now();  // Latency starts here
+                    batch.last = false;
+                    idle = 0;
+                    while (!ring.tryPush(batch))        // While the simulator is behind
+                        backoff(idle);                  // Wait for room
+                    pushed++;                           // One more batch in flight
+                }                                       // End if statement
+            }                                           // End if statement
+            line.clear();                               // Start the next line
+        }                                               // End for loop
+    }                                                   // End while loop
+}                                                       // End of function serveConnection
+
+/**
+ * @brief Keep policies resident and feed them from stdin or a Unix socket
+ *
+ * The calling thread reads and answers queries; a second thread owns
+ * the engines. They share only the SPSC ring, which carries batches
+ * one way, and DaemonStats, which carries counters back.
+ *
+ * @param argc  Argument count from main
+ * @param argv  Arguments from main
+ * @param first Index of the first argument after --daemon
+ *
+ * @return Exit status for main
+ */
+
+inline int runDaemon(int argc,
+                     char *argv[],
+                     int first)
+{
+    const char *socketPath = nullptr;                   // Socket to listen on, or stdin
+    std::vector<const PolicyEntry *> policies;          // Policies to keep resident
+    int frames = 32;                                    // Frames per policy
+    uint64_t pageSize = 1;                              // Bytes per page if references are addresses
+
+    for (int i = first; i < argc; i++) {                // Walk the rest of the command line
+        bool more = i + 1 < argc;                       // Whether a value follows
+        if (std::strcmp(argv[i], "--socket") == 0 && more) {  // If a socket was named
+            socketPath = argv[++i];                     // Listen there
+        } else if (std::strcmp(argv[i], "--policies") == 0 && more) {  // If policies were listed
+            if (!parsePolicyList(argv[++i], policies))  // Parse them
+                return 1;                               // Return 1 which indicates error
+        } else if (std::strcmp(argv[i], "--frames") == 0 && more) {  // If a frame count was given
+            frames = std::atoi(argv[++i]);              // Use it
+        } else if (std::strcmp(argv[i], "--page-size") == 0 && more) {  // If references are addresses
+            pageSize = std::strtoull(argv[++i], nullptr, 0);  // Divide them by this
+        } else {                                        // Else the argument is unknown
+            std::cerr << "Usage: " << argv[0] << " --daemon [--socket <path>] [--policies fifo,lru,clock]\n"  // Display the usage message
+                "       [--frames N] [--page-size <bytes>]\n";
+            return 1;                                   // Return 1 which indicates error
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    if (frames < 1 || pageSize == 0) {                  // If an option is out of range
+        std::cerr << "Frame count and page size must be at least 1.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (policies.empty())                               // If no policies were listed
+        parsePolicyList("fifo,lru,clock", policies);    // Keep the classic three
+
+    for (const PolicyEntry *policy : policies)          // Every policy must work online
+        if (policy->wholeTrace || policy->make == nullptr) {  // If it needs the future
+            std::cerr << policy->label << " needs the whole trace and cannot run as a daemon.\n";  // Print error message
+            return 1;                                   // Return 1 which indicates error
+        }                                               // End if statement
+
+    int listener = -1;                                  // Listening socket, if any
+    if (socketPath != nullptr) {                        // If a socket was named
+        sockaddr_un address = {};                       // Its address
+        address.sun_family = AF_UNIX;
+        if (std::strlen(socketPath) >= sizeof address.sun_path) {  // If the path does not fit
+            std::cerr << "Socket path is too long.\n";  // Print error message
+            return 1;                                   // Return 1 which indicates error
+        }                                               // End if statement
+        std::strcpy(address.sun_path, socketPath);      // Fill in the path
+
+        struct stat existing;                           // Whatever is at the path already
+        if (lstat(socketPath, &existing) == 0) {        // If something is
+            if (!S_ISSOCK(existing.st_mode)) {          // And it is not a socket
+                std::cerr << "'" << socketPath << "' exists and is not a socket.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+            unlink(socketPath);                         // Replace a stale socket
+        }                                               // End if statement
+
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);     // Create the socket
+        if (listener < 0 || bind(listener, (sockaddr *) &address, sizeof address) < 0 ||
+            listen(listener, 8) < 0) {                  // If it cannot be set up
+            std::cerr << "Cannot listen on '" << socketPath << "'.\n";  // Print error message
+            return 1;                                   // Return 1 which indicates error
+        }                                               // End if statement
+    }                                                   // End if statement
+
+    std::signal(SIGPIPE, SIG_IGN);                      // A vanished client is an error return, not a signal
+
+    SpscRing<DaemonBatch> ring(DAEMON_RING_SIZE);       // Batches from this thread to the simulator
+    DaemonStats stats((int) policies.size());           // Counters back from it
+    std::thread simulator(simulateBatches, std::ref(ring), std::cref(policies), frames, std::ref(stats));  // Start it
+    long long pushed = 0;                               // Batches queued
+
+    if (listener < 0) {                                 // Stdin mode: one connection, ended by EOF
+        serveConnection(0, 1, ring, pushed, pageSize, stats, policies, frames);
+    } else {                                            // Socket mode: clients one after another
+        bool shutdown = false;                          // Whether a client asked to stop
+        while (!shutdown) {                             // Until then
+            int client = accept(listener, nullptr, nullptr);  // Wait for the next client
+            if (client < 0)                             // If accepting failed
+                break;                                  // Stop serving
+            shutdown = serveConnection(client, client, ring, pushed, pageSize, stats, policies, frames);
+            close(client);                              // Done with this client
+        }                                               // End while loop
+        close(listener);                                // Stop listening
+        unlink(socketPath);                             // Remove the socket file
+    }                                                   // End if statement
+
+    DaemonBatch end;                                    // The end marker
+    end.last = true;
+    int idle = 0;                                       // Failed pushes in a row
+    while (!ring.tryPush(end))                          // Queue it behind everything else
+        backoff(idle);
+    simulator.join();                                   // Let the simulator finish
+
+    std::cerr << formatStats(stats, policies, frames, 0);  // Final counters
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function runDaemon
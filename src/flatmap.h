@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Open-addressing hash map from page number to int
+ *
+ * Keys and values live side by side in one flat array with linear
+ * probing, so a lookup is usually a single cache miss. The all-ones key
+ * (-1 for int) is never a page, which lets it mark an empty slot. Erase
+ * shifts later entries back instead of leaving tombstones, so lookups
+ * stay short no matter how many pages come and go.
+ *
+ * @tparam Key int for page IDs, uint64_t for raw 64-bit page numbers
+ */
+
+template <class Key>
+class BasicFlatMap {
+public:
+    BasicFlatMap() : count(0), mask(0) {}
+
+    /**
+     * @brief Drop every entry and size the table for at least expected keys
+     */
+
+    void reset(int expected) {
+        size_t capacity = 16;                           // Smallest table
+        while (capacity < (size_t) expected * 2)        // Keep the load factor at or below one half
+            capacity *= 2;                              // Tables are powers of two
+
+        slots.assign(capacity, Slot{EMPTY, 0});         // Mark every slot empty
+        mask = capacity - 1;                            // Mask that maps a hash to a slot
+        count = 0;                                      // No keys yet
+    }                                                   // End of function reset
+
+    /**
+     * @brief Return the value stored for key, or -1 if it is absent
+     *
+     * The empty test comes first so the all-ones key, which can never be
+     * stored, is reported absent instead of matching an empty slot.
+     */
+
+    int find(Key key) const {
+        for (size_t i = home(key);; i = (i + 1) & mask) {  // Probe from the home slot
+            if (slots[i].key == EMPTY)                  // If an empty slot ends the run
+                return -1;                              // The key is absent
+            if (slots[i].key == key)                    // If the key is here
+                return slots[i].value;                  // Return its value
+        }                                               // End for loop
+    }                                                   // End of function find
+
+    /**
+     * @brief Store value for key, replacing any earlier value
+     *
+     * The all-ones key marks empty slots and is ignored.
+     */
+
+    void insert(Key key, int value) {
+        if (key == EMPTY)                               // If the key cannot be told from an empty slot
+            return;                                     // Store nothing
+        if ((count + 1) * 2 > slots.size())             // If the table would pass half full
+            grow();                                     // Double it first
+
+        size_t i = home(key);                           // Start at the home slot
+        while (slots[i].key != EMPTY && slots[i].key != key)  // Walk to the key or an empty slot
+            i = (i + 1) & mask;                         // Next slot
+
+        if (slots[i].key == EMPTY)                      // If the key is new
+            count++;                                    // Count it
+
+        slots[i] = Slot{key, value};                    // Store the entry
+    }                                                   // End of function insert
+
+    /**
+     * @brief Remove key if it is present
+     */
+
+    void erase(Key key) {
+        size_t i = home(key);                           // Start at the home slot
+        while (slots[i].key != key) {                   // Walk to the key
+            if (slots[i].key == EMPTY)                  // If an empty slot ends the run
+                return;                                 // Nothing to erase
+            i = (i + 1) & mask;                         // Next slot
+        }                                               // End while loop
+
+        size_t hole = i;                                // Slot being vacated
+        for (size_t j = (i + 1) & mask; slots[j].key != EMPTY; j = (j + 1) & mask) {  // Scan the rest of the run
+            size_t want = home(slots[j].key);           // Where this entry would like to live
+            if (((j - want) & mask) >= ((j - hole) & mask)) {  // If the hole lies on its probe path
+                slots[hole] = slots[j];                 // Shift it back into the hole
+                hole = j;                               // Its old slot is the new hole
+            }                                           // End if statement
+        }                                               // End for loop
+
+        slots[hole].key = EMPTY;                        // Empty the final hole
+        count--;                                        // One key fewer
+    }                                                   // End of function erase
+
+    size_t size() const { return count; }               // Number of keys stored
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(slots, count, mask); }  // Checkpoint the table as it stands
+
+private:
+    static constexpr Key EMPTY = (Key) -1;              // Key of an empty slot
+
+    struct Slot {
+        Key key;                                        // Page number, or EMPTY
+        int value;                                      // Value stored for the page
+    };
+
+    /**
+     * @brief Home slot of key: Fibonacci hashing spreads sequential pages apart
+     */
+
+    size_t home(Key key) const {
+        return (size_t) (((uint64_t) key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    }                                                   // End of function home
+
+    /**
+     * @brief Double the table and reinsert every key
+     */
+
+    void grow() {
+        std::vector<Slot> old;                          // Entries to move over
+        old.swap(slots);                                // Take the current table
+        reset((int) old.size());                        // Allocate twice as many slots
+
+        for (const Slot &slot : old)                    // For every old slot
+            if (slot.key != EMPTY)                      // If it holds a key
+                insert(slot.key, slot.value);           // Move it to the new table
+    }                                                   // End of function grow
+
+    std::vector<Slot> slots;                            // Flat array of keys and values
+    size_t count;                                       // Number of keys stored
+    size_t mask;                                        // Table size minus one
+};
+
+typedef BasicFlatMap<int> FlatMap;                      // Keyed by dense page ID
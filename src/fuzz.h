@@ -0,0 +1,413 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "history.h"
+#include "registry.h"
+#include "sweep.h"
+#include "workload.h"
+
+/**
+ * @brief An optimized policy and the scanning reference engine it must match
+ */
+
+struct FuzzPair {
+    const char *optimized;                              // Registry name of the fast engine
+    const char *reference;                              // Registry name of the scanning engine
+};
+
+const FuzzPair FUZZ_PAIRS[] = {{"fifo", "fifo-ref"}, {"lru", "lru-ref"}, {"opt", "opt-ref"}};
+
+const int FUZZ_MAX_LENGTH = 400;                        // Longest generated trace; opt-ref rescans the future
+const int BELADY_STRING[] = {1, 2, 3, 4, 1, 2, 5, 1, 2, 3, 4, 5};  // FIFO faults 9 times with 3 frames, 10 with 4
+
+/**
+ * @brief One generated trace and frame count
+ */
+
+struct FuzzCase {
+    const char *shape;                                  // Which generator made it
+    int frames;                                         // Frame count, 1..MAX_FRAMES
+    std::vector<int> refs;                              // Dense page IDs
+};
+
+/**
+ * @brief Build the next case, cycling through the shapes
+ *
+ * - random:   uniform over a few more pages than frames, so hits and
+ *             replacements both happen.
+ * - belady:   Belady's string under a random relabelling, at 3 or 4
+ *             frames, sometimes followed by more of the same pages.
+ * - opt-ties: many pages referenced once, so OPT often has several
+ *             resident pages with no next use and must break the tie
+ *             the same way as the reference.
+ * - loop:     a cycle over one to three more pages than frames, the
+ *             worst case for FIFO and LRU.
+ * - edge:     empty traces, one frame, one page, or more frames than
+ *             pages.
+ */
+
+inline void generateFuzzCase(std::mt19937_64 &rng,
+                             long long index,
+                             FuzzCase &out)
+{
+    auto below = [&rng](int n) { return (int) (rng() % (unsigned) n); };  // Uniform in [0, n)
+    int length = 1 + below(FUZZ_MAX_LENGTH);            // References, for the shapes that choose freely
+    out.refs.clear();                                   // Start with an empty trace
+    out.frames = 1 + below(MAX_FRAMES);                 // Any size the reference engines can hold
+
+    switch (index % 5) {
+    case 0: {                                           // Random over a small page set
+        out.shape = "random";
+        out.frames = 1 + below(below(2) ? 8 : MAX_FRAMES);  // Small sizes half the time
+        int pages = 1 + below(2 * out.frames + 2);      // Around the frame count
+        for (int i = 0; i < length; i++)
+            out.refs.push_back(below(pages));
+        break;
+    }
+
+    case 1: {                                           // Belady's anomaly
+        out.shape = "belady";
+        out.frames = 3 + below(2);                      // The sizes where FIFO gets worse with more frames
+        int label[6] = {0, 1, 2, 3, 4, 5};              // Relabel the five pages
+        std::shuffle(label, label + 6, rng);
+        for (int page : BELADY_STRING)
+            out.refs.push_back(label[page]);
+        int extra = below(2) ? below(40) : 0;           // Sometimes keep going
+        for (int i = 0; i < extra; i++)
+            out.refs.push_back(label[1 + below(5)]);
+        break;
+    }
+
+    case 2: {                                           // Ties in OPT's farthest-use choice
+        out.shape = "opt-ties";
+        int pages = 1 + below(out.frames + 2);          // Pages that recur
+        int fresh = pages;                              // Next page seen only once
+        for (int i = 0; i < length; i++)                // Mix recurring and single-use pages
+            out.refs.push_back(below(3) == 0 ? below(pages) : fresh++);
+        for (int i = 0; i < out.frames + below(8); i++) // End on single-use pages, so every resident page is dead
+            out.refs.push_back(fresh++);
+        break;
+    }
+
+    case 3: {                                           // Cyclic scan just past the frames
+        out.shape = "loop";
+        int pages = out.frames + 1 + below(3);          // One to three pages too many
+        for (int i = 0; i < length; i++)
+            out.refs.push_back(i % pages);
+        break;
+    }
+
+    default: {                                          // Boundaries
+        out.shape = "edge";
+        int kind = below(4);                            // Which boundary
+        if (kind == 0)                                  // Empty trace
+            break;
+        if (kind == 1)                                  // One frame
+            out.frames = 1;
+        int pages = kind == 2 ? 1 : kind == 3 ? std::max(1, out.frames / 2) : 1 + below(4);  // One page, or fewer than frames
+        for (int i = 0; i < length; i++)
+            out.refs.push_back(below(pages));
+        break;
+    }
+    }                                                   // End switch statement
+}                                                       // End of function generateFuzzCase
+
+/**
+ * @brief Contents of every frame just after the index-th recorded fault
+ *
+ * This is the column the table prints at that reference, rebuilt the
+ * same way renderTable does.
+ */
+
+inline std::vector<int> faultColumn(const FaultHistory &history,
+                                    long long index,
+                                    int frames)
+{
+    std::vector<int> column(frames, -1);                // Every frame starts empty
+    for (long long k = 0; k <= index && k < history.size(); k++)  // Replay the faults up to this one
+        column[history[k].slot] = history[k].page;
+    return column;                                      // The frames after it
+}                                                       // End of function faultColumn
+
+/**
+ * @brief Run one case through a reference engine and its optimized engines
+ *
+ * The whole-trace run must match the reference fault for fault: the
+ * same references fault, loading the same page into the same frame, so
+ * every column of the table is the same. The streaming engine, fed in
+ * random chunk sizes, must match the fault count.
+ *
+ * @param chunkSeed Seed for the streaming engine's chunk sizes
+ * @param why       Receives a description of the first difference
+ *
+ * @return true if every engine agrees with the reference
+ */
+
+inline bool fuzzCaseAgrees(const FuzzPair &pair,
+                           const FuzzCase &test,
+                           unsigned long long chunkSeed,
+                           std::string &why)
+{
+    const PolicyEntry *reference = findPolicy(pair.reference);  // The scanning engine
+    const PolicyEntry *optimized = findPolicy(pair.optimized);  // The engine under test
+    const int *refs = test.refs.data();                 // Trace
+    int count = (int) test.refs.size();                 // Its length
+    FaultHistory expected, actual;                      // Faults from each
+
+    long long expectedFaults = reference->run(test.frames, refs, count, &expected);
+    long long actualFaults = optimized->run(test.frames, refs, count, &actual);
+
+    if (actualFaults != expectedFaults) {               // If the totals differ
+        why = std::string(optimized->name) + " faults " + std::to_string(actualFaults) +
+            ", " + reference->name + " faults " + std::to_string(expectedFaults);
+        return false;                                   // Report the difference
+    }                                                   // End if statement
+
+    for (long long k = 0; k < expected.size(); k++) {   // For every fault
+        if (expected[k].time == actual[k].time && expected[k].slot == actual[k].slot &&
+            expected[k].page == actual[k].page)         // If it is the same fault
+            continue;                                   // Check the next one
+
+        std::vector<int> want = faultColumn(expected, k, test.frames);  // Columns where they part
+        std::vector<int> got = faultColumn(actual, k, test.frames);
+        why = std::string(optimized->name) + " fault " + std::to_string(k) + " at reference " +
+            std::to_string(actual[k].time) + " (" + reference->name + ": " + std::to_string(expected[k].time) + "), frames " + optimized->name + "/" + reference->name + ":";
+        for (int f = 0; f < test.frames; f++)           // Show both columns, frame by frame
+            why += " " + std::to_string(got[f]) + "/" + std::to_string(want[f]);
+        return false;                                   // Report the difference
+    }                                                   // End for loop
+
+    std::unique_ptr<Engine> engine = optimized->make(test.frames);  // The streaming engine
+    std::mt19937_64 rng(chunkSeed);                     // Chunk sizes for this case
+    engine->prepare(refs, count);                       // OPT needs the whole trace
+    for (int start = 0; start < count; ) {              // Feed random chunks, down to single references
+        int size = std::min(count - start, 1 + (int) (rng() % 64));
+        engine->run(refs + start, size);
+        start += size;
+    }                                                   // End for loop
+    engine->finish();                                   // Settle anything held back
+
+    if (engine->pageFaults() != expectedFaults) {       // If streaming changed the count
+        why = std::string(optimized->name) + " streamed in chunks faults " + std::to_string(engine->pageFaults()) +
+            ", " + reference->name + " faults " + std::to_string(expectedFaults);
+        return false;                                   // Report the difference
+    }                                                   // End if statement
+
+    return true;                                        // Every engine agreed
+}                                                       // End of function fuzzCaseAgrees
+
+/**
+ * @brief Shrink a failing case by deleting references while it still fails
+ *
+ * Tries deleting runs of references, halving the run length down to a
+ * single reference, so the case printed is small enough to read.
+ */
+
+inline void shrinkFuzzCase(const FuzzPair &pair,
+                           FuzzCase &test,
+                           unsigned long long chunkSeed,
+                           std::string &why)
+{
+    for (size_t run = std::max<size_t>(1, test.refs.size() / 2); run >= 1; run /= 2) {  // Halve the deletion each round
+        for (size_t start = 0; start + run <= test.refs.size(); ) {  // Slide it over the trace
+            FuzzCase smaller = test;                    // The case without this run
+            smaller.refs.erase(smaller.refs.begin() + start, smaller.refs.begin() + start + run);
+            std::string smallerWhy;                     // How the smaller case fails, if it does
+            if (!fuzzCaseAgrees(pair, smaller, chunkSeed, smallerWhy)) {  // If it still fails
+                test = smaller;                         // Keep it
+                why = smallerWhy;
+            } else {                                    // Else the run is needed
+                start++;                                // Try the next one
+            }                                           // End if statement
+        }                                               // End for loop
+        if (run == 1)                                   // Single references have been tried
+            break;                                      // Stop shrinking
+    }                                                   // End for loop
+}                                                       // End of function shrinkFuzzCase
+
+/**
+ * @brief Run generated cases through every (optimized, reference) pair
+ *
+ * Also runs Belady's string itself and checks the reference FIFO shows
+ * the anomaly, so the belady shape is known to be adversarial.
+ *
+ * @param seed    Generator seed; a failure prints the case index to reproduce it
+ * @param cases   Number of cases
+ * @param verbose Whether to print each failing case
+ *
+ * @return Number of (case, pair) runs that disagreed
+ */
+
+inline long long fuzzEngines(unsigned long long seed,
+                             long long cases,
+                             bool verbose)
+{
+    long long failures = 0;                             // Runs that disagreed
+    const PolicyEntry *fifo = findPolicy("fifo-ref");   // Anomaly check
+    int belady = (int) (sizeof(BELADY_STRING) / sizeof(BELADY_STRING[0]));  // Length of Belady's string
+
+    if (fifo->run(3, BELADY_STRING, belady, nullptr) != 9 || fifo->run(4, BELADY_STRING, belady, nullptr) != 10) {
+        if (verbose)                                    // The reference itself is wrong
+            std::cerr << "fifo-ref does not show Belady's anomaly.\n";
+        failures++;
+    }                                                   // End if statement
+
+    std::mt19937_64 rng(seed);                          // Every case comes from this
+    FuzzCase test;                                      // The current case
+
+    for (long long index = 0; index < cases; index++) { // For every case
+        generateFuzzCase(rng, index, test);             // Build it
+        unsigned long long chunkSeed = seed ^ (unsigned long long) index;  // Chunking, reproducible per case
+
+        for (const FuzzPair &pair : FUZZ_PAIRS) {       // For every engine pair
+            std::string why;                            // The first difference
+            if (fuzzCaseAgrees(pair, test, chunkSeed, why))
+                continue;                               // Next pair
+
+            failures++;                                 // Count the disagreement
+            if (!verbose)                               // If only the count is wanted
+                continue;                               // Next pair
+
+            FuzzCase small = test;                      // Smallest case that still fails
+            shrinkFuzzCase(pair, small, chunkSeed, why);
+            std::cerr << "FAIL case " << index << " (" << test.shape << ", " << test.frames << " frames, " <<
+                test.refs.size() << " refs, seed " << seed << "): " << why << "\n  shrunk to";
+            for (int page : small.refs)                 // Print the shrunk trace
+                std::cerr << " " << page;
+            std::cerr << "\n";
+        }                                               // End for loop
+    }                                                   // End for loop
+
+    return failures;                                    // Report the count
+}                                                       // End of function fuzzEngines
+
+/**
+ * @brief Time each reference engine and its optimized engine on the same traces
+ *
+ * Traces are generated over four pages per frame, so faults and hits
+ * both happen and opt-ref's forward scans stay short. Each engine runs
+ * three times and the fastest counts; the fault counts must still agree.
+ *
+ * @return Exit status for runFuzz
+ */
+
+inline int runFuzzThroughput(const std::vector<long long> &sizes,
+                             const std::vector<int> &frameList,
+                             unsigned long long seed)
+{
+    std::cout << "workload,references,frames,policy,faults,reference_ns_per_ref,optimized_ns_per_ref,speedup\n";
+    std::vector<int> refs;                              // The current trace
+    bool agreed = true;                                 // Whether every count matched
+
+    for (long long size : sizes) {                      // For every length
+        for (const char *name : {"uniform", "zipf", "loop"}) {  // Random, skewed and cyclic
+            WorkloadSpec spec;                          // The pattern
+            parseWorkload(name, spec);
+
+            for (int frames : frameList) {              // For every frame count
+                generateWorkload(spec, 4 * frames, size, seed, refs);  // Build the trace
+
+                for (const FuzzPair &pair : FUZZ_PAIRS) {  // For every engine pair
+                    const PolicyEntry *engines[2] = {findPolicy(pair.reference), findPolicy(pair.optimized)};
+                    long long faults[2];                // Each engine's count
+                    double ns[2];                       // Each engine's best time per reference
+
+                    for (int e = 0; e < 2; e++) {       // Reference, then optimized
+                        ns[e] = 0;                      // No run yet
+                        for (int rep = 0; rep < 3; rep++) {  // Best of three
+                            auto start = std::chrono::steady_clock::now();  // Time the run
+                            faults[e] = engines[e]->run(frames, refs.data(), (int) size, nullptr);
+                            double run = std::chrono::duration<double, std::nano>(
+                                std::chrono::steady_clock::now() - start).count() / size;
+                            ns[e] = rep == 0 ? run : std::min(ns[e], run);
+                        }                               // End for loop
+                    }                                   // End for loop
+
+                    if (faults[0] != faults[1]) {       // If the engines disagree
+                        std::cerr << pair.optimized << " faults " << faults[1] << ", " << pair.reference <<
+                            " faults " << faults[0] << " on " << name << " (" << size << " refs, " << frames << " frames).\n";
+                        agreed = false;                 // Fail the run
+                    }                                   // End if statement
+
+                    std::cout << name << "," << size << "," << frames << "," << pair.optimized << "," <<  // Display one row
+                        faults[1] << "," << ns[0] << "," << ns[1] << "," << (ns[1] > 0 ? ns[0] / ns[1] : 0) << "\n";
+                }                                       // End for loop
+            }                                           // End for loop
+        }                                               // End for loop
+    }                                                   // End for loop
+
+    return agreed ? 0 : 1;                              // Fail the run if any count differed
+}                                                       // End of function runFuzzThroughput
+
+/**
+ * @brief Differential test of the optimized engines against the reference engines
+ *
+ * Generates random and adversarial cases and checks fifo, lru and opt
+ * against fifo-ref, lru-ref and opt-ref fault for fault. With
+ * --throughput, times both sides on the same generated traces instead.
+ *
+ * @param argc  Argument count from main
+ * @param argv  Arguments from main
+ * @param first Index of the first argument after --fuzz
+ *
+ * @return Exit status for main
+ */
+
+inline int runFuzz(int argc,
+                   char *argv[],
+                   int first)
+{
+    long long cases = 10000;                            // Generated cases
+    unsigned long long seed = 1;                        // Generator seed
+    bool throughput = false;                            // Whether to time instead of compare
+    std::vector<long long> sizes = {10000, 100000};     // Trace lengths for --throughput
+    std::vector<int> frameList = {8, 32, MAX_FRAMES};   // Frame counts for --throughput
+
+    for (int i = first; i < argc; i++) {                // Walk the rest of the command line
+        bool more = i + 1 < argc;                       // Whether a value follows
+        if (std::strcmp(argv[i], "--cases") == 0 && more) {  // If a case count was given
+            cases = std::atoll(argv[++i]);              // Use it
+        } else if (std::strcmp(argv[i], "--seed") == 0 && more) {  // If a seed was given
+            seed = std::strtoull(argv[++i], nullptr, 10);  // Use it
+        } else if (std::strcmp(argv[i], "--throughput") == 0) {  // If timing was asked for
+            throughput = true;                          // Time both sides
+        } else if (std::strcmp(argv[i], "--sizes") == 0 && more) {  // If lengths were listed
+            if (!parseSizeList(argv[++i], sizes)) {     // Parse them
+                std::cerr << "Bad size list '" << argv[i] << "'.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+        } else if (std::strcmp(argv[i], "--frames") == 0 && more) {  // If frame counts were listed
+            if (!parseFrameList(argv[++i], frameList) ||  // Parse them
+                *std::max_element(frameList.begin(), frameList.end()) > MAX_FRAMES) {  // The reference engines must hold them
+                std::cerr << "Bad frame list '" << argv[i] << "'; at most " << MAX_FRAMES << " frames.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+        } else {                                        // Else the argument is unknown
+            std::cerr << "Usage: " << argv[0] << " --fuzz [--cases N] [--seed N]\n" <<  // Display the usage message
+                "       " << argv[0] << " --fuzz --throughput [--sizes 1e4,1e5] [--frames 8,32,50] [--seed N]\n";
+            return 1;                                   // Return 1 which indicates error
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    if (cases < 1) {                                    // If there is nothing to run
+        std::cerr << "Case count must be at least 1.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (throughput)                                     // If timing was asked for
+        return runFuzzThroughput(sizes, frameList, seed);  // Do that instead of comparing
+
+    long long failures = fuzzEngines(seed, cases, true);  // Compare every case
+    std::cout << cases << " cases, " << cases * (long long) (sizeof(FUZZ_PAIRS) / sizeof(FUZZ_PAIRS[0])) <<  // Summarize the run
+        " engine runs, " << failures << " disagreements\n";
+    return failures == 0 ? 0 : 1;                       // Fail the run on any disagreement
+}                                                       // End of function runFuzz
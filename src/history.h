@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief Record of the frame changes made by page faults
+ *
+ * A dense frames x references table is mostly blank, since columns are
+ * only filled on faults, and it cannot hold a long trace. This keeps
+ * one entry per fault instead -- when it happened, which frame changed
+ * and the page loaded into it -- and replays the entries to rebuild any
+ * frame's contents at a fault.
+ */
+
+class FaultHistory {
+public:
+    /**
+     * @brief One page fault
+     */
+
+    struct Fault {
+        long long time;                                 // Index of the faulting reference
+        int slot;                                       // Frame the page was loaded into
+        int page;                                       // Page that was loaded
+    };
+
+    /**
+     * @brief Forget every recorded fault
+     *
+     * @param expected Number of faults to reserve room for
+     */
+
+    void reset(long long expected = 0) {
+        faults.clear();                                 // Drop the old faults
+        faults.reserve(expected);                       // Avoid regrowing for the expected count
+    }                                                   // End of function reset
+
+    /**
+     * @brief Record that the reference at time loaded page into frame slot
+     */
+
+    void record(long long time, int slot, int page) {
+        faults.push_back(Fault{time, slot, page});      // Append the fault
+    }                                                   // End of function record
+
+    long long size() const { return (long long) faults.size(); }  // Number of recorded faults
+    const Fault &operator[](long long i) const { return faults[i]; }  // The i-th fault, in time order
+
+private:
+    std::vector<Fault> faults;                          // Faults in time order
+};
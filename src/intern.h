@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "flatmap.h"
+
+/**
+ * @brief Assigns dense 32-bit IDs to 64-bit page numbers
+ *
+ * Pages get IDs 0, 1, 2, ... in order of first reference, so every
+ * engine can keep per-page state in a flat array indexed by ID instead
+ * of hashing the page on each reference. The interner is the only
+ * place that hashes, once per reference while the trace is read, and
+ * it maps IDs back to page numbers for output.
+ */
+
+class PageInterner {
+public:
+    PageInterner() { ids.reset(1024); }                 // Grows with the number of distinct pages
+
+    static constexpr uint64_t RESERVED = ~0ULL;         // The one page number that cannot be interned
+
+    /**
+     * @brief Return page's ID, assigning the next one if it is new
+     *
+     * @return -1 for RESERVED, which the hash table uses to mark empty slots
+     */
+
+    int intern(uint64_t page) {
+        if (page == RESERVED)                           // If the page cannot be stored
+            return -1;                                  // Refuse it rather than alias another page
+        int id = ids.find(page);                        // Existing ID, if any
+        if (id == -1) {                                 // If the page is new
+            id = (int) pages.size();                    // Next dense ID
+            ids.insert(page, id);                       // Remember it
+            pages.push_back(page);                      // And the way back
+        }                                               // End if statement
+        return id;                                      // Return the ID
+    }                                                   // End of function intern
+
+    /**
+     * @brief Intern count pages into out
+     *
+     * @return false if a page was RESERVED; its ID is -1
+     */
+
+    bool intern(const uint64_t in[], int count, int out[]) {
+        bool ok = true;                                 // Whether every page got an ID
+        for (int i = 0; i < count; i++) {               // For every page
+            out[i] = intern(in[i]);                     // Replace it with its ID
+            ok = ok && out[i] != -1;
+        }                                               // End for loop
+        return ok;                                      // Report a refused page
+    }                                                   // End of function intern
+
+    uint64_t page(int id) const { return pages[id]; }   // Page number behind an ID
+    int size() const { return (int) pages.size(); }     // Number of distinct pages seen
+    const std::vector<uint64_t> &pageNumbers() const { return pages; }  // Every page, indexed by ID
+
+    /**
+     * @brief Checkpoint the pages in ID order; loading re-interns them
+     */
+
+    template <class Archive>
+    void persist(Archive &ar) {
+        ar(pages);                                      // Every page, indexed by ID
+        if (Archive::loading) {                         // If they were just read back
+            ids.reset((int) pages.size());              // Rebuild the index
+            for (size_t id = 0; id < pages.size(); id++)  // In ID order
+                ids.insert(pages[id], (int) id);        // So every page keeps its ID
+        }                                               // End if statement
+    }                                                   // End of function persist
+
+private:
+    BasicFlatMap<uint64_t> ids;                         // ID of each page seen
+    std::vector<uint64_t> pages;                        // pages[id] = page number
+};
@@ -1,138 +1,30 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <string>
-#include <fstream>
 #include <iostream>
-
-/**
- * @brief Read a single line from the
- * 
- * @param filename The name of the file to read from
- */
-
-std::string readLineFromFile(const char *filename) {    // Function header
-    std::ifstream in(filename);                         // Open file for reading
-    if (!in) {                                          // Check if file is open
-        std::cerr << "Cannot open input file.\n";       // Print error message
-        std::exit(1);                                   // Exit with 1 which indicates error
-    }                                                   // End if statement
-
-    std::string line;                                   // Declare string variable to hold the line
-    if (!std::getline(in, line)) {                      // Read a single line from the file
-        std::cerr << "Input file is empty.\n";          // Print error message
-        std::exit(1);                                   // Exit with 1 which indicates error
-    }                                                   // End if statement
-
-    return line;                                        // Return the line
-}
-
-/**
- * @brief Parse the input line and store the values in the given variables.
- * 
- * @param line The input line to parse.
- * @param algo The selected algorithm.
- * @param frameCount The number of frames in the cache.
- * @param refs An array to store the reference values.
- * @param refCount The number of references in the input line.
- */
-
-void parseInputLine(const std::string &line,            // The input line to parse
-                    char &algo,                         // The selected algorithm
-                    int &frameCount,                    // Number of frames that can be used
-                    int refs[],                         // Reference to the string value from the file
-                    int &refCount)                      // Number of references in the input line
-{
-    algo = 0;                                           // Set the algorithm to 0
-    frameCount = 0;                                     // Set the number of frames to 0
-    refCount = 0;                                       // Set the number of references to 0
-
-    int i = 0;                                          // Index for the input line, set to 0
-    int n = line.size();                                // Size of the input line
-
-    while (i < n &&                                     // While index is less than the size of the input line
-           (line[i] == ' ' ||                           // If the character is a space
-            line[i] == '\t'))                           // Or if the character is a tab
-        i++;                                            // Increment the index
-
-    if (i < n)                                          // If the index is less than the size of the input line
-        algo = line[i++];                               // Set the algorithm to the character at index
-    else                                                // else
-        return;                                         // Return
-
-    while (i < n &&                                     // While index is less than the size of the input line
-           line[i] != ',')                              // And the character is not a comma
-        i++;                                            // Increment the index
-
-    if (i < n &&                                        // If the index is less than the size of the input line
-        line[i] == ',')                                 // And the character is a comma
-        i++;                                            // Increment the index
-
-    while (i < n &&                                     // While index is less than the size of the input line
-           line[i] >= '0' &&                            // And character is greater than or equal to 0
-           line[i] <= '9') {                            // And character is less than or equal to 9
-        frameCount =                                    // frameCount is equal to
-        frameCount * 10 +                               // frameCount * 10 multi digit numbers
-        (line[i] - '0');                                // subtract the character from '0' to convert to numeric value
-        i++;                                            // Increment the index
-    }                                                   // End of while loop
-
-    if (i < n &&                                        // If the index is less than the size of
-        line[i] == ',')                                 // And line is a comma
-        i++;                                            // Increment the index
-
-    while (i < n) {                                     // While index is less than the size of the input line
-
-        while (i < n &&                                 // While index is less than the size of the input line
-               (line[i] == ',' ||                       // And line is a comma
-                line[i] == ' ' ||                       // Or line is a space
-                line[i] == '\t'))                       // Or line is a tab
-            i++;                                        // Increment the index
-
-        if (i >= n) break;                              // Break the loop if index is greater than or equal to the size of the input line
-
-        int val = 0;                                    // Initialize val to 0
-        bool hasDigit = false;                          // Initialize hasDigit to false
-
-        while (i < n &&                                 // While index is less than the size of the input line
-               line[i] >= '0' &&                        // And character is greater than or equal to 0
-               line[i] <= '9') {                        // And character is less than or equal to 9 
-
-            val =                                       // Set val to
-            val * 10 +                                  // val * 10
-            (line[i] - '0');                            // Character minus '0'
-            hasDigit = true;                            // Set hasDigit to true
-
-            i++;                                        // Increment the index
-        }                                               // End of while loop
-
-        if (hasDigit)                                   // If hadDigit is true
-            refs[refCount++] = val;                     // Add val to ref at refCount and increment refCount
-    }                                                   // End while loop
-}                                                       // End of function readInputLine
-
-/**
- * @brief Wipe the view table
- * 
- * @param table the view table
- * @param frameCount the number frames that can be used
- * @param refCount the number of references in the input line
- */
-
-void wipeTable(int table[][1000],                       // The view table
-               int &frameCount,                         // The number of frames that can be used
-               int &refCount)                           // The number of references in the input line
-{
-    for (int i = 0;                                     // Start of for loop
-         i < frameCount;                                // While i is less than frameCount
-         i++) {                                         // Increment the index
-
-        for (int j = 0;                                 // Start of for loop
-             j < refCount;                              // While j is less than refCount
-             j++) {                                     // Increment the index
-
-            table[i][j] = -1;                           // Set table[i][j] to -1
-
-        }                                               // End nested for loop
-    }                                                   // End for loop
-}                                                       // End of function wipeTable
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+#include "bench.h"
+#include "curve.h"
+#include "daemon.h"
+#include "fuzz.h"
+#include "registry.h"
+#include "render.h"
+#include "shards.h"
+#include "shared.h"
+#include "simd.h"
+#include "stats.h"
+#include "sweep.h"
+#include "trace.h"
+#include "workingset.h"
+
+const int MAX_REFS = 1000;                              // Longest trace drawn as a table
 
 /**
  * @brief Find a page in the view
@@ -157,65 +49,6 @@ int findPage(int frames[],                              // The frames
     return -1;                                          // Return -1 if page not found
 }                                                       // End of function findPage
 
-/**
- * @brief Tester function for testing the program functions
- */
-
-void testers()
-{
-    std::string testLine =                              // The input line
-        readLineFromFile("data/TESTER_CORRECT.txt");    // Read the input line from test file
-    
-    std::cout << "Input Line: " <<                      // Print the input line
-        testLine << "\n";                               // Print the string from the file
-
-    int frameCount, refCount;                           // The number of frames that can be used and the reference count
-    char algo;                                          // The algorithm to use
-    int refs[100];                                      // The reference string
-
-    int displayTable[50][1000];                         // Test display table
-
-    parseInputLine(testLine,                            // Testing the parseInputLine function
-                   algo,                                // Algorithm to use
-                   frameCount,                          // Number of frames that can be used
-                   refs,                                // References from input file
-                   refCount);                           // Number of references from input file
-
-    std::cout << "Algorithm: " <<                       // Display algorithm line
-        algo << "\n";                                   // The algorithm used
-    std::cout << "Frame Count: " <<                     // The number of frames that can be used
-        frameCount << "\n";                             // The number of frames that can be used
-    std::cout << "Reference String: ";                  // Start of displaying the reference string
-
-    for (int i = 0;                                     // Start for loop
-         i < refCount;                                  // Number of references in the file
-         i++) {                                         // Increment the index
-        std::cout << refs[i] << " ";                    // Display the reference string
-    }                                                   // End for loop
-
-    std::cout << "\n";                                  // Insert next line
-
-    wipeTable(displayTable,                             // Wipe the displayTable
-              frameCount,                               // Number of frames that can be used
-              refCount);                                // Number of references from input file
-
-    for (int i = 0;                                     // Start for loop
-         i < frameCount;                                // While index is less than the number of frames that can be used
-         i++) {                                         // Increment the index
-
-        for (int j = 0;                                 // Start for loop 
-             j < refCount;                              // While index is less than the number of references from input file
-             j++) {                                     // Increment the index
-
-            std::cout << displayTable[i][j] << " ";     // Display the table results
-        }                                               // End for loop
-        std::cout << "\n";                              // Insert next line
-    }                                                   // End for loop
-    
-    std::cout << "\n";                                  // Insert next line
-
-}                                                       // End testers function
-
 /**
  * @brief Runs the FIFO algorithm that removes oldest loaded page
  *        when new page fault occurs and no free frame is available
@@ -223,18 +56,16 @@ void testers()
  * @param frameCount Number of frames that can be used
  * @param refs[]     Array of page references from the input
  * @param refCount   Number of page references in the input
- * @param table[][]  Table used to record the frame contents over time
+ * @param history    History that records each fault, or nullptr to skip it
  *
  * @return Number of page faults that occurred while running FIFO
  */
 
 int FIFO(int frameCount,                                // Number of frames that can be used
-         int refs[],                                    // Array of page references from input
+         const int refs[],                              // Array of page references from input
          int refCount,                                  // Number of page references in the input
-         int table[][1000])                             // Table used to record all frame states
+         FaultHistory *history)                         // History used to record every fault
 {
-    std::cout << "Running FIFO" << std::endl;           // Display that the program is running FIFO
-
     // Frames[i] = page in frame i, or -1 if empty
     int frames[50];                                     // Array to hold the current pages in each frame
 
@@ -248,53 +79,45 @@ int FIFO(int frameCount,                                // Number of frames that
 
 
     int fifoIndex = 0;                                  // Index of the next frame to replace/FIFO queue pointer
+    ScanKernel scanFrames = scanKernel();               // Vector lookup for this CPU
 
     // t for time
     for (int t = 0; t < refCount; t++)                  // Start of for loop over all references (time steps)
     {                                                   // While index is less than the number of references, increment by one
         int page = refs[t];                             // Get the current page reference
 
-        int position = findPage(frames, frameCount, page);  // Check if the page is already in one of the frames, number of frames that can be used, page to find
+        FrameScan scan = scanFrames(frames, frameCount, page);  // Find the page and the first free frame in one pass
+        int position = scan.position;                   // Where the page is, or -1
 
         bool fault = false;                             // Track whether a page fault occurred at this step
+        int loaded = -1;                                // Frame the page was loaded into
 
         if (position == -1)                             // If the page is not currently in any frame
         {
             fault = true;                               // This is a page fault
             pageFaults++;                               // Increment page fault counter
 
-            // Search for free frame first
-            int freeIndex = -1;                         // Index of a free (empty) frame if any exists
-
-            for (int i = 0; i < frameCount; i++)        // Start of for loop, while index is less than the number of frames, increment index by one
-            {
-                if (frames[i] == -1)                    // If this frame is empty
-                {
-                    freeIndex = i;                      // Mark this frame as free
-                    break;                              // Break out of loop once a free frame is found
-                }                                       // End if statement
-            }                                           // End for loop
+            // Use a free frame first
+            int freeIndex = scan.freeIndex;             // Index of a free (empty) frame if any exists
 
             if (freeIndex != -1)                        // If a free frame was found
             {
                 // Still space, use first free frame
                 frames[freeIndex] = page;               // Place the new page into the free frame
+                loaded = freeIndex;                     // Remember which frame changed
             } else {                                    // Else there is no free frame available
                 // No free frame, replace using FIFO
                 frames[fifoIndex] = page;               // Replace the page at fifoIndex
-                fifoIndex = (fifoIndex + 1) % frameCount; // Move FIFO pointer to the next frame
+                loaded = fifoIndex;                     // Remember which frame changed
+                fifoIndex = (fifoIndex + 1) % frameCount;  // Move FIFO pointer to the next frame
             }                                           // End if statement
         }                                               // End for loop
 
-        // Only write frames into table when a fault occurs
+        // Only record a fault, not every time step
         // Else the column stays blank when printed
-        // f for frame
-        if (fault)                                      // If a page fault occurred at this time step
+        if (fault && history != nullptr)                // If a page fault occurred and faults are being recorded
         {
-            for (int f = 0; f < frameCount; f++)        // Start of for loop, while index is less than the number of frames, increment index by one
-            {
-                table[f][t] = frames[f];                // Store the current content of each frame in the table
-            }                                           // End for loop
+            history->record(t, loaded, page);           // Store which frame received the page
         }                                               // End if statement
 
     }
@@ -303,12 +126,10 @@ int FIFO(int frameCount,                                // Number of frames that
 }                                                       // End FIFO function
 
 int OPT(int frameCount,                                 // Number 
-        int refs[],                                     // References from file
+        const int refs[],                               // References from file
         int refCount,                                   // Number of references
-        int table[][1000])                              // Table to store frames
+        FaultHistory *history)                          // History to store faults
 {
-    std::cout << "Running OPT" << std::endl;            // Display that the program is running OPT
-
     int frames[50];                                     // Initialize frames array
 
     for (int i = 0;                                     // Start of for loop
@@ -319,6 +140,7 @@ int OPT(int frameCount,                                 // Number
     }                                                   // End for loop
 
     int pageFaults = 0;                                 // Initialize page faults to zero
+    ScanKernel scanFrames = scanKernel();               // Vector lookup for this CPU
 
     for (int t = 0;                                     // Start for loop 
          t < refCount;                                  // While the index is less than the number of references in the input file
@@ -326,32 +148,24 @@ int OPT(int frameCount,                                 // Number
 
         int page = refs[t];                             // Get the current reference
 
-        int pos = findPage(frames,                      // Find the position of the current reference in the frames array
-                           frameCount,                  // Number of frames we can use
-                           page);                       // What page we are currently on
+        FrameScan scan = scanFrames(frames,             // Find the current reference and the first empty frame
+                                    frameCount,         // Number of frames we can use
+                                    page);              // What page we are currently on
+        int pos = scan.position;                        // Position of the current reference in the frames array
 
         bool fault = false;                             // Initialize fault to false
+        int loaded = -1;                                // Frame the page was loaded into
 
         if (pos == -1) {                                // If position is zeroed
             fault = true;                               // Set fault to true
             pageFaults++;                               // Increment page faults
 
-            int freeIndex = -1;                         // Initialize free index to zeroed value
-
-            for (int i = 0;                             // Start for loop
-                 i < frameCount;                        // While the index is less than the number of frames we can use
-                 i++) {                                 // Increment index
-
-                if (frames[i] == -1) {                  // If the current frame is empty
-                    freeIndex = i;                      // Set free index to current frame
-                    break;                              // Break out of loop
-                }                                       // End if statement
-
-            }
+            int freeIndex = scan.freeIndex;             // First empty frame, or -1
 
             if (freeIndex != -1) {                      // If there is an empty frame
 
                 frames[freeIndex] = page;               // Set the frame to the current page
+                loaded = freeIndex;                     // Remember which frame changed
 
             } else {                                    // Else
 
@@ -390,13 +204,12 @@ int OPT(int frameCount,                                 // Number
                 }                                       // End for loop
 
                 frames[replaceIndex] = page;            // Set frame at replace index to page
+                loaded = replaceIndex;                  // Remember which frame changed
             }                                           // End if statement
         }                                               // End for loop
 
-        if (fault) {                                    // If fault is true
-            for (int f = 0; f < frameCount; f++) {      // While f is less than frame count
-                table[f][t] = frames[f];                // Set table at f to frames[f]
-            }                                           // End for loop
+        if (fault && history != nullptr) {              // If fault is true and faults are being recorded
+            history->record(t, loaded, page);           // Record the frame that changed
         }                                               // End if statement
     }                                                   // End for statement
 
@@ -409,12 +222,10 @@ int OPT(int frameCount,                                 // Number
  */
 
 int LRU(int frameCount,
-        int refs[],
+        const int refs[],
         int refCount,
-        int table[][1000])
+        FaultHistory *history)
 {
-    std::cout << "Running LRU" << std::endl;            // Display that the program is running LRU
-
     int frames[50];                                     // Array to hold the frames
     int lastUsed[50];                                   // Array to hold the last used time of each frame
                                                         // Clear frames and lastUsed to -1
@@ -427,6 +238,7 @@ int LRU(int frameCount,
     }                                                   // End of for loop
 
     int pageFaults = 0;                                 // Store number of page faults
+    ScanKernel scanFrames = scanKernel();               // Vector lookup for this CPU
 
     for (int t = 0;                                     // Start of for loop
          t < refCount;                                  // As long as index is less than the number of references
@@ -434,11 +246,13 @@ int LRU(int frameCount,
 
         int page = refs[t];                             // Store the current reference in page
                                                         // Check if the current reference is in the frames
-        int position = findPage(frames,                 // Frames array
-                                frameCount,             // How many frames we use
-                                page);                  // Page to find
+        FrameScan scan = scanFrames(frames,             // Frames array
+                                    frameCount,         // How many frames we use
+                                    page);              // Page to find, and the first free frame
+        int position = scan.position;                   // Where the page is, or -1
 
         bool fault = false;                             // Default fault to false
+        int loaded = -1;                                // Frame the page was loaded into
 
         if (position != -1) {                           // If the current position does not equal -1
             lastUsed[position] = t;                     // Set last used at this position to current index
@@ -446,21 +260,12 @@ int LRU(int frameCount,
             fault = true;                               // Set fault to true
             pageFaults++;                               // Increment page faults
 
-            int freeIndex = -1;                         // Set the index to -1
-
-            for (int i = 0;                             // Start of for loop
-                 i < frameCount;                        // As long as index is less than the number of frames we can use
-                 i++) {                                 // Increment index by one
-
-                if (frames[i] == -1) {                  // If this frame is equal to -1
-                    freeIndex = i;                      // Set the free index to this index to show this is available
-                    break;                              // Break
-                }                                       // End if statement
-            }
+            int freeIndex = scan.freeIndex;             // First empty frame, or -1
 
             if (freeIndex != -1) {                      // If the free index is not -1
                 frames[freeIndex] = page;               // Set this frames index to the current page
                 lastUsed[freeIndex] = t;                // Set the last used to current current index
+                loaded = freeIndex;                     // Remember which frame changed
             } else {                                    // Else if
                 int lruIndex = 0;                       // Set the LRU index 
                 int oldest = lastUsed[0];               // Set the the oldest to the first element in the array
@@ -476,15 +281,12 @@ int LRU(int frameCount,
 
                 frames[lruIndex] = page;                // Set the frame at the lru index to this page
                 lastUsed[lruIndex] = t;                 // Set the last used at the lru index to this index
+                loaded = lruIndex;                      // Remember which frame changed
             }                                           // End else statement
         }                                               // End else statement
 
-        if (fault) {                                    // If the fault is true
-            for (int f = 0;                             // Start of for loop
-                 f < frameCount;                        // As long as index is less than the number of frames we can use
-                 f++) {                                 // Increment index by one
-                table[f][t] = frames[f];                // Set the table at this index to this frame
-            }                                           // End for loop
+        if (fault && history != nullptr) {              // If the fault is true and faults are being recorded
+            history->record(t, loaded, page);           // Record the frame that changed
         }                                               // End if statement
     }                                                   // End for loop
 
@@ -492,121 +294,1387 @@ int LRU(int frameCount,
 }                                                       // End of LRU function
 
 /**
- * @brief Prints the table to stdout
- * 
- * @param refs[] Array of references from input file
- * @param refCount Number of references in input file
- * @param frameCount Number of frames allowed to be used per
- * @param table[][] Table to print
- * @param pageFaults Number of page faults that occurred
+ * @brief Tester function for testing the program functions
  */
 
-void printTable(int refs[],
-                int refCount,
-                int frameCount,
-                int table[][1000],
-                int pageFaults)
+void testers()
 {
+    TraceHeader header;                                 // The algorithm and frame count
+    std::vector<int> refs;                              // The reference string
+    PageInterner pages;                                 // Page number behind each ID
 
-    for (int t = 0;                                     // Start for loop
-         t < refCount;                                  // While the index is less than the number of references in the input file
-         t++) {                                         // Increment the index by one
+    if (!readTrace("data/TESTER_CORRECT.txt",           // Read the whole test file
+                   header,                              // Algorithm and frame count
+                   refs,                                // References from input file
+                   pages))                              // Their page numbers
+        return;                                         // The reason has been printed
 
-        std::cout << refs[t] << " ";                    // Add space at current index
-    }                                                   // End for loop        
+    char algo = header.algo;                            // The algorithm to use
+    int frameCount = header.frameCount;                 // The number of frames that can be used
+    int refCount = (int) refs.size();                   // The reference count
 
-    std::cout << "\n";                                  // Add new line
+    std::cout << "Algorithm: " <<                       // Display algorithm line
+        algo << "\n";                                   // The algorithm used
+    std::cout << "Frame Count: " <<                     // The number of frames that can be used
+        frameCount << "\n";                             // The number of frames that can be used
+    std::cout << "Reference String: ";                  // Start of displaying the reference string
 
-    for (int t = 0;                                     // Start for loop
-         t < refCount * 2;                              // While the index is less than twice the number of references in the input file
-         t++) {                                         // Increment the index by one
-        std::cout << "-";                               // Add dash at current index
+    for (int i = 0;                                     // Start for loop
+         i < refCount;                                  // Number of references in the file
+         i++) {                                         // Increment the index
+        std::cout << pages.page(refs[i]) << " ";        // Display the reference string
     }                                                   // End for loop
 
-    std::cout << "\n";                                  // Add new line
+    std::cout << "\n";                                  // Insert next line
+
+    FaultHistory history;                               // Faults from the reference engine
+    const PolicyEntry *entry = findPolicy(algo, true);  // Reference engine for the algorithm
+
+    if (entry != nullptr && frameCount >= 1 && frameCount <= MAX_FRAMES) {  // If it can run
+        int pageFaults = entry->run(frameCount,         // Run the reference engine
+                                    refs.data(),        // Reference array
+                                    refCount,           // Number of references
+                                    &history);          // Record every fault
+        OutputBuffer out;                               // Buffered stdout
+        renderTable(out, refs.data(), pages, refCount, frameCount, history, pageFaults);  // Display the table
+        out.flush();                                    // Write it before the next line
+    }                                                   // End if statement
     
-    for (int f = 0;                                     // Start for loop
-         f < frameCount;                                // While the index is less than the number of frames that can be used in the frame
-         f++) {                                         // Increment the index by one
+    std::cout << "\n";                                  // Insert next line
 
-        for (int t = 0;                                 // Start for loop 
-             t < refCount;                              // While the index is less than the number of references in the input file
-             t++) {                                     // Increment the index by one
+}                                                       // End testers function
 
-            if (table[f][t] == -1)                      // If table is equal to -1 (blank)
-                std::cout << "  ";                      // Display space
+/**
+ * @brief Replace the engine and interner with a checkpoint's and seek the trace to match
+ *
+ * @param path   Checkpoint to read
+ * @param run    The run being resumed; the checkpoint must belong to it
+ * @param reader Trace to reposition
+ * @param pages  Interner to restore
+ * @param engine Engine to restore
+ *
+ * @return false, after printing why, if the checkpoint cannot be used
+ */
+
+bool resumeStream(const char *path,
+                  const CheckpointHeader &run,
+                  TraceReader &reader,
+                  PageInterner &pages,
+                  Engine &engine)
+{
+    std::FILE *in;                                      // The checkpoint
+    CheckpointHeader saved;                             // The run it was taken from
+
+    if (!openCheckpoint(path, in, saved)) {             // If it cannot be read
+        std::cerr << "Cannot read checkpoint '" << path << "'.\n";  // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    if (saved.policy != run.policy || saved.frameCount != run.frameCount ||  // If the policy or frames differ
+        saved.lookahead != run.lookahead ||             // Or the window does
+        saved.pageSize != run.pageSize || saved.traceBytes != run.traceBytes) {  // Or the trace does
+        std::cerr << "Checkpoint '" << path << "' is from a different run (" <<  // Print error message
+            saved.policy << ", " << saved.frameCount << " frames";
+        if (saved.lookahead > 0)                        // If the policy has a window
+            std::cerr << ", window " << saved.lookahead;  // Show it too
+        std::cerr << ").\n";
+        std::fclose(in);                                // Close it
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    CheckpointReader archive(in);                       // Archive over the state
+    archive(pages);                                     // Page IDs first, so the engine's IDs mean the same pages
+    bool ok = archive.good() && engine.load(archive);   // Then the engine
+    std::fclose(in);                                    // Done with the file
+
+    if (!ok || !reader.seek(saved.position)) {          // If the state or the trace position is unusable
+        std::cerr << "Cannot resume from checkpoint '" << path << "'.\n";  // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    std::cout << "Resumed at reference " << saved.position.refs << "\n";  // Display where the run picks up
+    return true;                                        // The run can continue
+}                                                       // End of function resumeStream
+
+/**
+ * @brief Streams a trace through a policy without holding it in memory
+ *
+ * @param filename   Trace file to read, or "-" for stdin
+ * @param policyName Policy to run instead of the one in the header, or nullptr
+ * @param pageSize   Bytes per page if references are addresses, else 1
+ * @param checkpoint Checkpoint file to write periodically, or nullptr
+ * @param interval   Seconds between checkpoints
+ * @param resume     Whether to start from the checkpoint instead of the beginning
+ * @param tlbSpec    TLB to translate every reference through first, or nullptr
+ * @param prefetch   Prefetcher to run beside the policy, or nullptr; a
+ *                   plain engine runs the same references for comparison
+ * @param cost       Latencies for the effective access time, or nullptr
+ *                   to show it with the defaults only if the trace writes
+ * @param stats      Records each chunk's parse and simulate phases if on
+ *
+ * @return Exit status for main
+ */
+
+int runStream(const char *filename,
+              const char *policyName,
+              uint64_t pageSize,
+              const char *checkpoint,
+              double interval,
+              bool resume,
+              const TlbSpec *tlbSpec,
+              const PrefetchSpec *prefetch,
+              const CostModel *cost,
+              Instrumentation &stats)
+{
+    TraceReader reader;                                 // Reader over the input
+    reader.setPageSize(pageSize);                       // Divide addresses down to pages
+
+    if (!reader.open(filename)) {                       // Check if file is open
+        std::cerr << "Cannot open input file.\n";       // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    TraceHeader header;                                 // Algorithm and frame count
+    if (!reader.readHeader(header)) {                   // Read the "algo,frames" prefix
+        std::cerr << "Input file is empty.\n";          // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (reader.framesOverflowed()) {                    // If the header's frame count is out of range
+        std::cerr << "Frame count is larger than 2147483647.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (header.frameCount < 1) {                        // If there are no frames to use
+        std::cerr << "Frame count must be at least 1.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    const PolicyEntry *entry = policyName ?             // Policy named on the command line
+        findPolicy(policyName) :                        // Or the one in the header
+        findPolicy(header.algo, false);
+
+    if (entry == nullptr) {                             // If there is no such policy
+        std::cerr << "Unknown algorithm.\n";            // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (entry->wholeTrace || entry->make == nullptr) {  // If the policy cannot stream
+        std::cerr << entry->label <<                    // Print error message
+            " needs the whole trace; run it without --stream.\n";
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (prefetch != nullptr && entry->makePrefetching == nullptr) {  // If the policy cannot take speculative loads
+        std::cerr << entry->label << " cannot prefetch.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    std::cout << "Running " << entry->label << "\n";    // Display which policy is running
+
+    std::unique_ptr<Engine> engine =                    // Specialized loop for the policy
+        (prefetch ? entry->makePrefetching : entry->make)(header.frameCount);
+    std::unique_ptr<Engine> baseline;                   // The policy without prefetching, if it is compared
+    if (prefetch != nullptr)                            // If it is
+        baseline = entry->make(header.frameCount);      // Run it beside the prefetching engine
+    Prefetcher prefetcher(prefetch ? *prefetch : PrefetchSpec{PrefetchSpec::NEXT, 1});  // Proposes the pages to load
+    std::vector<uint64_t> chunk(TRACE_CHUNK_SIZE);      // Chunk of parsed page numbers
+    std::vector<int> ids(TRACE_CHUNK_SIZE);             // The same chunk as dense page IDs
+    PageInterner pages;                                 // Assigns the IDs
+    double parseSeconds = 0;                            // Time spent parsing
+    bool sawWrites = false;                             // Whether any reference wrote
+
+    long long lookahead = entry->make == makeLookaheadEngine ? WindowedOptPolicy::lookahead : 0;  // Window, if the policy has one
+    CheckpointHeader run{entry->name, header.frameCount, pageSize, traceFileSize(filename), {}, lookahead};  // What a checkpoint belongs to
+    if (resume && !resumeStream(checkpoint, run, reader, pages, *engine))  // If the run cannot pick up where it was
+        return 1;                                       // Return 1 which indicates error
+    long long skipped = resume ? reader.bytesRead() : 0;  // Bytes a resumed run does not parse again
+    Checkpointer checkpoints(checkpoint, interval);     // Snapshots the run as it goes
+    Tlb tlb;                                            // Translation stage, if one was asked for
+    if (tlbSpec != nullptr)                             // If it was
+        tlb.init(*tlbSpec);                             // Start with empty TLBs
+
+    while (true) {                                      // Until the trace runs out
+        auto start = std::chrono::steady_clock::now();  // Time the parse of this chunk
+        int count;                                      // References in the chunk
+        {
+            ScopedPhase parsing(stats, "", "parse");    // Count the parse too, if --stats is on
+            count = reader.nextChunk(chunk.data(),      // Parse the next chunk
+                                     TRACE_CHUNK_SIZE); // Up to a full chunk of references
+            pages.intern(chunk.data(), count, ids.data());  // Replace each page with its ID
+            parsing.setReferences(count);
+        }
+        parseSeconds += std::chrono::duration<double>(  // Add the parse time
+            std::chrono::steady_clock::now() - start).count();
+
+        if (count == 0)                                 // If the trace is exhausted
+            break;                                      // Stop streaming
+
+        {
+            ScopedPhase simulating(stats, entry->label, // Time the engine on this chunk
+                                   prefetch ? "simulate+prefetch" : tlbSpec ? "simulate+tlb" : "simulate", count);
+            const char *writes = reader.chunkHasWrites() ? reader.writes() : nullptr;  // Write flags, if the chunk has any
+            sawWrites = sawWrites || writes != nullptr; // Report the write-backs
+            if (prefetch != nullptr) {                  // If pages are prefetched
+                engine->runPrefetched(ids.data(), chunk.data(), count, prefetcher, pages, writes);  // Feed the chunk and the loads
+            } else if (tlbSpec == nullptr && writes != nullptr) {  // If the chunk writes
+                engine->runWrites(ids.data(), writes, count);  // Feed it with the flags
+            } else if (tlbSpec == nullptr) {            // If there is no TLB
+                engine->run(ids.data(), count);         // Feed the chunk to the engine
+            } else if (!engine->runTranslated(ids.data(), chunk.data(), count, pages.pageNumbers().data(), tlb, writes)) {  // Else translate as well
+                std::cerr << entry->label << " cannot run behind a TLB.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+        }
+
+        if (prefetch != nullptr) {                      // If the policy is compared without prefetching
+            ScopedPhase comparing(stats, entry->label, "baseline", count);  // Time that separately
+            if (reader.chunkHasWrites())                // If the chunk writes
+                baseline->runWrites(ids.data(), reader.writes(), count);  // Feed it the flags too
             else                                        // Else
-                std::cout << table[f][t] << " ";        // Display the value at this point
+                baseline->run(ids.data(), count);       // Feed it the chunk alone
+        }                                               // End if statement
+
+        if (checkpoints.due()) {                        // If a checkpoint is due
+            run.position = reader.position();           // The chunk boundary just reached
+            checkpoints.take(run, [&](CheckpointWriter &out) {  // Write it from a forked copy
+                out(pages);                             // Page IDs
+                engine->save(out);                      // Engine state
+            });
+        }                                               // End if statement
+    }                                                   // End while loop
+
+    checkpoints.finish();                               // Let a checkpoint in flight complete
+
+    {
+        ScopedPhase finishing(stats, entry->label, "finish");  // Lagging engines still have work here
+        engine->finish();                               // Settle references the engine is holding back
+    }
+
+    if (reader.overflowed()) {                          // If a reference was too large
+        std::cerr << "Reference does not fit in 64 bits, or is the reserved page 2^64-1.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (reader.truncated()) {                           // If the binary body ended early
+        std::cerr << "Binary trace is truncated.\n";    // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    double megabytes = (reader.bytesRead() - skipped) / 1e6;  // Size of the trace parsed in MB
+
+    std::cout << "Total references = " <<               // Display the number of references
+        reader.refsRead() << "\n";
+    std::cout << "Distinct pages = " <<                 // Display the number of pages interned
+        pages.size() << "\n";
+    std::cout << "Total page faults = " <<              // Display the total number of faults
+        engine->pageFaults() << "\n";
+
+    if (cost != nullptr || sawWrites || engine->writeBacks() > 0) {  // If the cost of faults is wanted or writes change it
+        CostModel model;                                // Latencies to use
+        if (cost == nullptr)                            // If none were given
+            parseCostModel("default", model);           // Use the defaults
+        std::cout << "Write-backs = " << engine->writeBacks() << "\n";  // Display the dirty evictions
+        std::cout << "Effective access time = " <<      // Display the mean time per reference
+            effectiveAccessTime(cost ? *cost : model, reader.refsRead(), engine->pageFaults(), engine->writeBacks()) << " ns\n";
+    }                                                   // End if statement
+
+    if (tlbSpec != nullptr) {                           // If references were translated
+        double n = tlb.accesses > 0 ? tlb.accesses / 100.0 : 1;  // One percent of the translations
+        std::cout << "TLB L1 hits = " << tlb.l1Hits << " (" << tlb.l1Hits / n << "%)\n";  // Display each level's share
+        std::cout << "TLB L2 hits = " << tlb.l2Hits << " (" << tlb.l2Hits / n << "%)\n";
+        std::cout << "Page walks = " << tlb.walks << " (" << tlb.walks / n << "%)\n";
+    }                                                   // End if statement
+
+    if (prefetch != nullptr) {                          // If pages were prefetched
+        PrefetchStats stats = engine->prefetchStats();  // What the speculative loads came to
+        double n = stats.issued > 0 ? stats.issued / 100.0 : 1;  // One percent of the prefetches
+        std::cout << "Faults without prefetching = " << baseline->pageFaults() << "\n";  // Display the comparison
+        std::cout << "Demand faults avoided = " << baseline->pageFaults() - engine->pageFaults() << "\n";
+        std::cout << "Prefetches issued = " << stats.issued << "\n";  // Display where the loads went
+        std::cout << "Prefetches useful = " << stats.useful << " (" << stats.useful / n << "%)\n";
+        std::cout << "Prefetches wasted = " << stats.wasted << " (" << stats.wasted / n << "%)\n";
+        std::cout << "Prefetches unused at end = " << stats.issued - stats.useful - stats.wasted << "\n";
+        std::cout << "Evictions caused by prefetching = " << stats.evictions << "\n";  // Display the extra frame pressure
+    }                                                   // End if statement
+
+    std::cout << "Parsed " << megabytes << " MB in " << // Display the parse throughput
+        parseSeconds << " s (" <<
+        (parseSeconds > 0 ? megabytes / parseSeconds : 0) << " MB/s)\n";
+
+    if (checkpoints.enabled())                          // If checkpoints were taken
+        std::cout << "Checkpoints written = " << checkpoints.checkpoints() <<  // Display how many, and their cost
+            " (" << checkpoints.failures() << " failed, longest pause " << checkpoints.pauseMs() << " ms)\n";
+
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function runStream
+
+/**
+ * @brief Remove a failed conversion's output, unless it is not a regular file such as /dev/full
+ */
+
+void discardOutput(const char *output)
+{
+    struct stat info;                                   // What the output is
+    if (stat(output, &info) == 0 && S_ISREG(info.st_mode))  // If it is an ordinary file
+        unlink(output);                                 // Remove it
+}                                                       // End of function discardOutput
+
+/**
+ * @brief Convert a trace to the binary format of bintrace.h
+ *
+ * @param input    Text or binary trace to read, or "-" for stdin
+ * @param output   Binary trace to write
+ * @param refCount Receives the number of references converted
+ * @param bytes    Receives the size of the binary trace
+ *
+ * @return false if either file cannot be opened or written, or the input is bad
+ */
+
+bool convertTrace(const char *input,
+                  const char *output,
+                  long long &refCount,
+                  long long &bytes)
+{
+    TraceReader reader;                                 // Reader over the input
+    TraceHeader header;                                 // Algorithm and frame count
+
+    reader.keepReserved();                              // Addresses are stored as is; the page size is applied on reading
+
+    if (!reader.open(input) || !reader.readHeader(header)) {  // If the input cannot be read
+        std::cerr << "Cannot read input file '" << input << "'.\n";  // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    if (reader.framesOverflowed()) {                    // If the header's frame count is out of range
+        std::cerr << "Frame count is larger than 2147483647.\n";  // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    BinaryTraceWriter writer;                           // Writer for the output
+    TracePosition start = reader.position();            // First reference, to start over from
+    bool writes = std::strcmp(input, "-") == 0;         // stdin cannot start over, so it keeps write flags throughout
+
+    if (!writer.open(output, header.algo, header.frameCount, writes)) {  // If the output cannot be created
+        std::cerr << "Cannot create output file '" << output << "'.\n";  // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    std::vector<uint64_t> chunk(TRACE_CHUNK_SIZE);      // Chunk of parsed references
+    int count;                                          // Size of the current chunk
+
+    while ((count = reader.nextChunk(chunk.data(), TRACE_CHUNK_SIZE)) > 0) {  // While references remain
+        if (!writes && reader.chunkHasWrites()) {       // If the first write turns up in a read-only file
+            writes = true;                              // Start over with write flags
+            writer.close();                             // Drop what was written
+            if (!reader.seek(start) || !writer.open(output, header.algo, header.frameCount, true)) {  // Rewind both
+                std::cerr << "Cannot restart conversion of '" << input << "'.\n";  // Print error message
+                return false;                           // Report the failure
+            }                                           // End if statement
+            continue;                                   // Read the first chunk again
+        }                                               // End if statement
+        writer.write(chunk.data(), count, reader.writes());  // Encode the chunk
+    }                                                   // End while loop
+
+    bool written = writer.close();                      // Patch the count and close the file
+
+    if (!written) {                                     // If the output did not reach the disk
+        std::cerr << "Cannot write output file '" << output << "'.\n";  // Print error message
+        discardOutput(output);                          // Do not leave a partial copy behind
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    if (reader.overflowed()) {                          // If a reference was too large
+        std::cerr << "Reference does not fit in 64 bits.\n";  // Print error message
+        discardOutput(output);                          // Do not leave a saturated copy behind
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    if (reader.truncated()) {                           // If a binary input ended early
+        std::cerr << "Binary trace is truncated.\n";    // Print error message
+        discardOutput(output);                          // Do not leave a short copy behind
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    refCount = (long long) writer.references();         // Report the references written
+    bytes = (long long) writer.size();                  // And the size of the file
+    return true;                                        // The conversion succeeded
+}                                                       // End of function convertTrace
+
+/**
+ * @brief Make an empty temporary file and return its name
+ */
+
+std::string tempFile()
+{
+    char name[] = "/tmp/pagerXXXXXX";                   // Template for mkstemp
+    int fd = mkstemp(name);                             // Create a unique file
+    if (fd < 0) {                                       // If it could not be created
+        std::cerr << "Cannot create a temporary file.\n";  // Print error message
+        std::exit(1);                                   // Exit with 1 which indicates error
+    }                                                   // End if statement
+    close(fd);                                          // Only the name is needed
+    return name;                                        // Return the name
+}                                                       // End of function tempFile
+
+/**
+ * @brief Check that a text trace survives conversion to binary and back
+ *
+ * @param filename Text trace to check
+ *
+ * @return true if the header and every page number come back unchanged
+ */
+
+bool checkRoundTrip(const char *filename)
+{
+    std::string binaryFile = tempFile();                // Where the binary copy goes
+    long long refCount, bytes;                          // Size of the conversion
+
+    if (!convertTrace(filename, binaryFile.c_str(), refCount, bytes)) {  // Convert the trace
+        unlink(binaryFile.c_str());                     // Remove the temporary file
+        return false;                                   // The conversion failed
+    }                                                   // End if statement
+
+    TraceHeader textHeader, binaryHeader;               // Headers from each format
+    std::vector<int> textRefs, binaryRefs;              // Page IDs from each format
+    std::vector<char> textWrites, binaryWrites;         // Write flags from each format
+    PageInterner textPages, binaryPages;                // Page numbers behind the IDs
+
+    bool read = readTrace(filename, textHeader, textRefs, textPages, 1, &textWrites) &&  // Parse the text trace
+        readTrace(binaryFile.c_str(), binaryHeader, binaryRefs, binaryPages, 1, &binaryWrites);  // Decode the binary trace
+    unlink(binaryFile.c_str());                         // Remove the temporary file
+
+    bool same = read && textHeader.algo == binaryHeader.algo &&  // Compare the algorithms
+        textHeader.frameCount == binaryHeader.frameCount &&  // The frame counts
+        textRefs == binaryRefs &&                       // Every reference
+        textWrites == binaryWrites &&                   // Every write flag
+        textPages.pageNumbers() == binaryPages.pageNumbers() &&  // And every page behind it
+        refCount == (long long) textRefs.size();        // The header count must agree too
+
+    std::cout << (same ? "PASS " : "FAIL ") << filename <<  // Display the result
+        " (" << textRefs.size() << " references, " << bytes << " bytes)\n";
+    return same;                                        // Report the result
+}                                                       // End of function checkRoundTrip
+
+/**
+ * @brief Check the chunked stack-distance pass against the sequential one
+ *
+ * @param name    Workload to generate
+ * @param threads Worker threads for the chunked pass
+ *
+ * @return true if the histograms and the LRU fault counts agree
+ */
+
+bool checkParallelDistances(const char *name,
+                            int threads)
+{
+    WorkloadSpec spec;                                  // The pattern
+    std::vector<int> refs;                              // Generated page IDs
+    parseWorkload(name, spec);                          // Parse its name
+    generateWorkload(spec, 5000, 1 << 19, 7, refs);     // Enough references for several chunks
+
+    std::vector<long long> sequential, parallel;        // Histogram from each pass
+    long long sequentialCold, parallelCold;             // Cold misses from each pass
+    lruStackDistances(refs.data(), (int) refs.size(), sequential, sequentialCold);  // The sequential pass
+    parallelStackDistances(refs.data(), (int) refs.size(), threads, parallel, parallelCold);  // The chunked pass
+
+    bool same = sequential == parallel && sequentialCold == parallelCold;  // The histograms must match exactly
+    for (int frames : {1, 16, 256})                     // A few sizes against the LRU engine itself
+        same = same && lruFaults(parallel, (int) refs.size(), frames) ==
+            simulate<LruPolicy>(frames, refs.data(), (int) refs.size(), nullptr);
+
+    std::cout << (same ? "PASS " : "FAIL ") << "parallel stack distances, " <<  // Display the result
+        name << " on " << threads << " threads\n";
+    return same;                                        // Report the result
+}                                                       // End of function checkParallelDistances
+
+/**
+ * @brief Check windowed OPT against OPT when the window covers the trace
+ *
+ * With a window at least as long as the trace every next use is known,
+ * so the fault counts must match exactly; a one-reference window must
+ * never beat OPT.
+ *
+ * @param name Workload to generate
+ *
+ * @return true if the fault counts agree
+ */
+
+bool checkLookahead(const char *name)
+{
+    WorkloadSpec spec;                                  // The pattern
+    std::vector<int> refs;                              // Generated page IDs
+    parseWorkload(name, spec);                          // Parse its name
+    generateWorkload(spec, 2000, 100000, 11, refs);     // Enough references to wrap the ring many times
+
+    int saved = WindowedOptPolicy::lookahead;           // Window to restore afterwards
+    bool same = true;                                   // Whether every size agreed
+
+    for (int frames : {1, 16, 256}) {                   // A few sizes
+        int opt = simulate<OptPolicy>(frames, refs.data(), (int) refs.size(), nullptr);  // Exact OPT
+        WindowedOptPolicy::lookahead = (int) refs.size();  // See the whole trace
+        same = same && simulateLookahead(frames, refs.data(), (int) refs.size(), nullptr) == opt;
+        WindowedOptPolicy::lookahead = 1;               // See almost nothing
+        same = same && simulateLookahead(frames, refs.data(), (int) refs.size(), nullptr) >= opt;
+    }                                                   // End for loop
+
+    WindowedOptPolicy::lookahead = saved;               // Put the window back
+    std::cout << (same ? "PASS " : "FAIL ") << "windowed OPT, " << name << "\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkLookahead
+
+/**
+ * @brief Check the incremental working-set sizes against a rescan of each window
+ *
+ * @param name Workload to generate
+ *
+ * @return true if every size and fault count agrees
+ */
+
+bool checkWorkingSet(const char *name)
+{
+    WorkloadSpec spec;                                  // The pattern
+    std::vector<int> refs;                              // Generated page IDs
+    parseWorkload(name, spec);                          // Parse its name
+    generateWorkload(spec, 300, 20000, 13, refs);       // Small enough to rescan
+
+    std::vector<long long> deltas = {1, 7, 100, 1000};  // Short and long windows
+    WorkingSetTracker tracker;                          // The incremental version
+    tracker.init(deltas);
+    std::vector<long long> faults(deltas.size(), 0);    // Faults from the rescan
+    std::vector<int> seen(300, -1);                     // Last window each page was counted in
+    bool same = true;                                   // Whether everything agreed
+
+    for (int t = 0; t < (int) refs.size(); t++) {       // For every reference
+        tracker.access(refs[t]);                        // Update the tracker
+        for (size_t d = 0; d < deltas.size(); d++) {    // For every window
+            int begin = (int) std::max<long long>(0, t - deltas[d] + 1);  // Oldest reference in W(t, delta)
+            bool inside = false;                        // Whether the page was in W(t - 1, delta)
+            for (int u = std::max(0, begin - 1); u < t; u++)  // Rescan the previous window
+                inside = inside || refs[u] == refs[t];
+            faults[d] += !inside;                       // Count the fault
+
+            long long size = 0;                         // Distinct pages in the window
+            int stamp = t * 8 + (int) d;                // Unique per (time, window)
+            for (int u = begin; u <= t; u++)            // Rescan the window
+                if (seen[refs[u]] != stamp) {           // If the page is new to it
+                    seen[refs[u]] = stamp;              // Count it once
+                    size++;
+                }                                       // End if statement
+
+            same = same && tracker.windows[d].size == size && tracker.windows[d].faults == faults[d];
+        }                                               // End for loop
+    }                                                   // End for loop
+
+    std::cout << (same ? "PASS " : "FAIL ") << "working set, " << name << "\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkWorkingSet
+
+/**
+ * @brief Check the prefetch accounting of every policy that can prefetch
+ *
+ * Each prefetcher runs on the workload and on a plain scan, which
+ * readahead under LRU must turn into a single fault. Every prefetch must end up
+ * useful, wasted or still resident, and the ones still resident must fit
+ * in the frames.
+ *
+ * @param name Workload to generate
+ *
+ * @return true if every count is consistent
+ */
+
+bool checkPrefetch(const char *name)
+{
+    WorkloadSpec spec;                                  // The pattern
+    std::vector<int> refs;                              // Generated page IDs
+    parseWorkload(name, spec);                          // Parse its name
+    generateWorkload(spec, 2000, 50000, 17, refs);      // Used as page numbers too
+    std::vector<uint64_t> numbers(refs.begin(), refs.end());  // The trace as page numbers
+    std::vector<uint64_t> scan(5000);                   // A sequential scan
+    for (int i = 0; i < (int) scan.size(); i++)
+        scan[i] = i;
+    bool same = true;                                   // Whether every count was consistent
+
+    for (int i = 0; i < POLICY_COUNT; i++) {            // For every policy
+        if (POLICIES[i].makePrefetching == nullptr)     // That can prefetch
+            continue;
+
+        for (const char *how : {"next:2", "stride:4", "markov:2"}) {  // Under every prefetcher
+            PrefetchSpec prefetch;                      // Parse it
+            parsePrefetchSpec(how, prefetch);
+            for (std::vector<uint64_t> *trace : {&numbers, &scan}) {  // On both traces
+                PageInterner pages;                     // IDs for the trace and the prefetches
+                std::vector<int> ids(trace->size());
+                pages.intern(trace->data(), (int) trace->size(), ids.data());
+                Prefetcher prefetcher(prefetch);
+                std::unique_ptr<Engine> engine = POLICIES[i].makePrefetching(64);
+                engine->runPrefetched(ids.data(), trace->data(), (int) ids.size(), prefetcher, pages, nullptr);
+
+                PrefetchStats stats = engine->prefetchStats();  // What the loads came to
+                long long unused = stats.issued - stats.useful - stats.wasted;  // Still resident and unreferenced
+                same = same && stats.useful >= 0 && stats.wasted >= 0 && unused >= 0 && unused <= 64 &&
+                    stats.wasted <= stats.evictions;
+                if (trace == &scan && how[0] == 'n' && std::strcmp(POLICIES[i].name, "lru") == 0)  // Readahead on a scan
+                    same = same && engine->pageFaults() == 1;  // Only the first page faults
+            }                                           // End for loop
+        }                                               // End for loop
+    }                                                   // End for loop
+
+    std::cout << (same ? "PASS " : "FAIL ") << "prefetch, " << name << "\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkPrefetch
 
+/**
+ * @brief Check that the prefetchers stop at page 0 and at the highest page
+ *
+ * A descending stride into page 0 and readahead off the top of the range
+ * must propose fewer pages, never wrapped ones or the reserved page.
+ *
+ * @return true if every proposal stays in range
+ */
+
+bool checkPrefetchBounds()
+{
+    std::vector<uint64_t> candidates;                   // Pages proposed
+    bool same = true;                                   // Whether every proposal was in range
+
+    for (const char *how : {"stride:4", "next:4"}) {    // Both detectors that compute pages
+        PrefetchSpec spec;                              // Parse it
+        parsePrefetchSpec(how, spec);
+        Prefetcher down(spec), up(spec);                // Toward page 0, then toward the top
+        for (uint64_t page : {5, 4, 3, 2, 1, 0}) {      // A stack growing down into page 0
+            down.observe(page, (int) page, true, false, candidates);
+            for (uint64_t proposed : candidates)        // Nothing below 0 may wrap around
+                same = same && proposed < 10;
+        }                                               // End for loop
+        for (uint64_t page = PageInterner::RESERVED - 4; page < PageInterner::RESERVED; page++) {  // Up to the highest page
+            up.observe(page, 0, true, false, candidates);
+            for (uint64_t proposed : candidates)        // Nothing past it may wrap or be reserved
+                same = same && proposed > page && proposed < PageInterner::RESERVED;
         }                                               // End for loop
+    }                                                   // End for loop
 
-        std::cout << "\n";                              // Add new line
+    std::cout << (same ? "PASS " : "FAIL ") << "prefetch bounds\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkPrefetchBounds
 
+/**
+ * @brief Check that TLB tags keep the whole page number
+ *
+ * Pages 2^63 apart must not share an L2 entry, and the top pages must
+ * not look like empty entries when mapped huge.
+ *
+ * @return true if every translation is counted where it belongs
+ */
+
+bool checkTlbTags()
+{
+    TlbSpec spec;                                       // One-entry levels, so every switch misses L1
+    parseTlbSpec("l1=1:1,l2=1:1", spec);
+    Tlb tlb;                                            // Alternate between pages 2^63 apart
+    tlb.init(spec);
+    for (int i = 0; i < 6; i++)
+        tlb.translate(i % 2 ? (1ULL << 63) + 1 : 1, false);
+    bool same = tlb.walks == 6 && tlb.l2Hits == 0;      // Each switch is a walk
+
+    parseTlbSpec("l1=1:1,l1huge=1:1,l2=2:2,huge=2", spec);  // Huge pages, with the top one in the mix
+    tlb.init(spec);
+    tlb.translate(PageInterner::RESERVED - 1, false);   // Walks
+    tlb.translate(0, false);                            // Walks; evicts the top page from L1 only
+    tlb.translate(PageInterner::RESERVED - 1, false);   // Served by L2
+    same = same && tlb.walks == 2 && tlb.l2Hits == 1;
+
+    std::cout << (same ? "PASS " : "FAIL ") << "TLB tags\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkTlbTags
+
+/**
+ * @brief Check the dirty-page accounting and clean-first LRU
+ *
+ * Clean-first LRU has no clean page to prefer when nothing or everything
+ * writes, so it must then match LRU fault for fault. Neither can write
+ * back more pages than it replaces.
+ *
+ * @param name Workload to generate
+ *
+ * @return true if every count agrees
+ */
+
+bool checkDirty(const char *name)
+{
+    WorkloadSpec spec;                                  // The pattern
+    std::vector<int> refs;                              // Generated page IDs
+    parseWorkload(name, spec);                          // Parse its name
+    generateWorkload(spec, 2000, 50000, 19, refs);
+    std::mt19937 rng(19);                               // Fixed seed so failures reproduce
+    bool same = true;                                   // Whether every count agreed
+
+    for (int percent : {0, 30, 100}) {                  // No, some and only writes
+        std::vector<char> writes(refs.size());          // Which references write
+        for (char &write : writes)
+            write = (int) (rng() % 100) < percent;
+
+        for (int frames : {1, 16, 256}) {               // A few sizes
+            long long faults[2], writeBacks[2];         // LRU, then clean-first LRU
+            const char *names[2] = {"lru", "lru-clean"};
+            for (int k = 0; k < 2; k++) {               // Run both
+                std::unique_ptr<Engine> engine = findPolicy(names[k])->make(frames);
+                engine->runWrites(refs.data(), writes.data(), (int) refs.size());
+                faults[k] = engine->pageFaults();
+                writeBacks[k] = engine->writeBacks();
+                same = same && writeBacks[k] <= std::max(0LL, faults[k] - frames);  // Only replacements write back
+            }                                           // End for loop
+
+            if (percent == 0 || percent == 100)         // If no page is cleaner than another
+                same = same && faults[0] == faults[1] && writeBacks[0] == writeBacks[1];
+        }                                               // End for loop
     }                                                   // End for loop
 
-    std::cout << "Total page faults = " <<              // Display the message for the total number of faults
-        pageFaults << "\n";                             // Display total number of page faults
-}                                                       // End of printTable function
+    std::cout << (same ? "PASS " : "FAIL ") << "dirty pages, " << name << "\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkDirty
+
+/**
+ * @brief Check that the all-ones page is refused instead of aliasing page ID 0
+ *
+ * The reader must reject it as a page number but accept it as an address
+ * that a page size divides down.
+ *
+ * @return true if every case behaved
+ */
+
+bool checkReservedPage()
+{
+    PageInterner pages;                                 // Fresh interner
+    bool same = pages.intern(7) == 0 && pages.intern(PageInterner::RESERVED) == -1 && pages.size() == 1;
+
+    std::string file = tempFile();                      // Trace ending in the all-ones value
+    std::FILE *out = std::fopen(file.c_str(), "w");
+    std::fprintf(out, "L,2,7,18446744073709551615\n");
+    std::fclose(out);
+
+    for (uint64_t pageSize : {1, 4096}) {               // As a page number, then as an address
+        TraceReader reader;                             // Reader over the trace
+        TraceHeader header;
+        std::vector<uint64_t> chunk(TRACE_CHUNK_SIZE);
+        reader.setPageSize(pageSize);
+        same = same && reader.open(file.c_str()) && reader.readHeader(header) &&
+            reader.nextChunk(chunk.data(), TRACE_CHUNK_SIZE) == 2 && chunk[1] != PageInterner::RESERVED &&
+            reader.overflowed() == (pageSize == 1);     // Only the page number is refused
+    }                                                   // End for loop
+    unlink(file.c_str());                               // Remove the temporary file
+
+    std::cout << (same ? "PASS " : "FAIL ") << "reserved page\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkReservedPage
+
+/**
+ * @brief Check that a frame count past INT_MAX is flagged, not wrapped
+ *
+ * @return true if only the out-of-range count is refused
+ */
+
+bool checkFrameCountOverflow()
+{
+    std::string file = tempFile();                      // Traces with large frame counts
+    bool same = true;                                   // Whether every header read as expected
+
+    const std::pair<const char *, bool> cases[] = {     // Header, and whether its count fits in an int
+        {"F,2147483647,1\n", true}, {"F,4294967297,1\n", false}, {"F,99999999999999999999,1\n", false}};
+    for (const auto &[text, fits] : cases) {            // For every header
+        std::FILE *out = std::fopen(file.c_str(), "w");
+        std::fputs(text, out);
+        std::fclose(out);
+
+        TraceReader reader;                             // Reader over the trace
+        TraceHeader header;
+        same = same && reader.open(file.c_str()) && reader.readHeader(header) &&
+            reader.framesOverflowed() == !fits && header.frameCount == (fits ? INT_MAX : 0);
+    }                                                   // End for loop
+    unlink(file.c_str());                               // Remove the temporary file
+
+    std::cout << (same ? "PASS " : "FAIL ") << "frame count overflow\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkFrameCountOverflow
+
+/**
+ * @brief Check that --stats records phases only when on, and merges them
+ *
+ * Timings and counters vary from run to run, so only the bookkeeping is
+ * checked: which (engine, phase) pairs appear and how many references
+ * each one handled, whether or not hardware counters are available.
+ *
+ * @return true if every record agrees
+ */
+
+bool checkStats()
+{
+    Instrumentation off, on, worker;                    // Disabled, enabled, and a second thread's share
+    on.enable(true);                                    // Without the note if counters are missing
+    worker.enable(true);
+
+    for (Instrumentation *stats : {&off, &on, &on, &worker}) {  // The same phases into each
+        { ScopedPhase parsing(*stats, "", "parse", 10); }
+        { ScopedPhase simulating(*stats, "LRU", "simulate", 100); }
+    }                                                   // End for loop
+    on.add(worker);                                     // Merge the second thread's records
+
+    std::ostringstream none, json, text;                // What each reports
+    off.report(none, true);
+    on.report(json, true);
+    on.report(text, false);
+
+    std::string lines = json.str();                     // One object per pair
+    bool same = none.str().empty() &&                   // Nothing was recorded while off
+        std::count(lines.begin(), lines.end(), '\n') == 2 &&  // Two pairs, each merged into one line
+        lines.find("\"phase\":\"parse\",\"ns\":") != std::string::npos &&
+        lines.find("\"references\":30,") != std::string::npos &&  // Three parses of ten references
+        lines.find("\"references\":300,") != std::string::npos &&  // Three runs of a hundred
+        text.str().find("LRU simulate: ") != std::string::npos;
+
+    std::cout << (same ? "PASS " : "FAIL ") << "phase statistics\n";  // Display the result
+    return same;                                        // Report the result
+}                                                       // End of function checkStats
+
+/**
+ * @brief Round-trip the bundled traces and generated ones through the binary format
+ *
+ * Also checks the chunked stack-distance pass against the sequential one,
+ * windowed OPT against OPT, the working-set tracker against a rescan,
+ * the prefetch accounting, the dirty-page accounting, the phase
+ * statistics, the reserved page, and a short differential fuzz of the
+ * optimized engines against the reference engines.
+ *
+ * @return Exit status for main
+ */
+
+int runTests()
+{
+    const char *files[] = {"data/FIFO.txt", "data/LRU.txt", "data/OPT.txt", "data/TESTER_CORRECT.txt"};  // Bundled traces
+    bool passed = true;                                 // Whether every check passed
+
+    for (const char *file : files)                      // For every bundled trace
+        passed = checkRoundTrip(file) && passed;        // Check it
+
+    for (bool writes : {false, true}) {                 // Read-only, then with write flags
+        std::string textFile = tempFile();              // Generated trace with awkward values
+        std::FILE *out = std::fopen(textFile.c_str(), "w");  // Write it as text
+        std::mt19937 rng(12345);                        // Fixed seed so failures reproduce
+
+        std::fprintf(out, "L,16,0,2147483647,0,1,0,18446744073709551614,4294967296,0\n");  // Extremes and negative steps
+        for (int i = 0; i < 100000; i++) {              // Then a long mixed trace
+            int ref = (i % 3 == 0) ? (int) (rng() & 0x7fffffff) :  // Large jumps either way
+                      (i % 3 == 1) ? i : (int) (rng() % 64);  // Sequential runs and small pages
+            const char *mode = writes && rng() % 4 == 0 ? "w" : "";  // Some references write
+            std::fprintf(out, "%d%s%s", ref, mode, (i % 17 == 0) ? "\n" : ",");  // Spread over many lines
+        }                                               // End for loop
+        if (writes)                                     // End on the widest write
+            std::fprintf(out, ",18446744073709551614w\n");
+        std::fclose(out);                               // Finish the text trace
+
+        passed = checkRoundTrip(textFile.c_str()) && passed;  // Check it
+        unlink(textFile.c_str());                       // Remove the temporary file
+    }                                                   // End for loop
+
+    for (const char *name : {"zipf", "phase", "loop", "uniform"})  // Reuse patterns near and far
+        for (int threads : {2, 3, 8})                   // Even and uneven splits
+            passed = checkParallelDistances(name, threads) && passed;  // Check them
+
+    for (const char *name : {"zipf", "phase", "loop", "uniform"})  // The same patterns
+        passed = checkLookahead(name) && passed;        // Check windowed OPT on each
+
+    for (const char *name : {"zipf", "phase", "loop"})  // Patterns with and without locality
+        passed = checkWorkingSet(name) && passed;       // Check the working-set tracker on each
+
+    for (const char *name : {"zipf", "loop"})           // Skewed and sequential reuse
+        passed = checkPrefetch(name) && passed;         // Check the prefetch accounting on each
+    passed = checkPrefetchBounds() && passed;           // And the ends of the page range
+    passed = checkTlbTags() && passed;                  // Check the TLB keeps pages 2^63 apart
+
+    for (const char *name : {"zipf", "phase", "uniform"})  // Patterns with and without locality
+        passed = checkDirty(name) && passed;            // Check the write-backs on each
+
+    passed = checkStats() && passed;                    // Check the --stats bookkeeping
+
+    passed = checkReservedPage() && passed;             // Check the all-ones page is refused
+    passed = checkFrameCountOverflow() && passed;       // Check a huge frame count is refused
+
+    long long disagreements = fuzzEngines(7, 500, true);  // A quick pass of --fuzz
+    std::cout << (disagreements == 0 ? "PASS " : "FAIL ") << "differential fuzz, 500 cases\n";  // Display the result
+    passed = disagreements == 0 && passed;
+
+    std::cout << (passed ? "All tests passed\n" : "Some tests FAILED\n");  // Display the summary
+    return passed ? 0 : 1;                              // Fail the run if any check failed
+}                                                       // End of function runTests
+
+/**
+ * @brief Time loading a trace as text and as binary
+ *
+ * @param filename Text trace to benchmark
+ *
+ * @return Exit status for main
+ */
+
+int benchLoad(const char *filename)
+{
+    std::string binaryFile = tempFile();                // Where the binary copy goes
+    long long refCount, bytes;                          // Size of the conversion
+
+    if (!convertTrace(filename, binaryFile.c_str(), refCount, bytes)) {  // Convert the trace
+        unlink(binaryFile.c_str());                     // Remove the temporary file
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    const char *files[2] = {filename, binaryFile.c_str()};  // Text first, then binary
+    const char *names[2] = {"text", "binary"};          // Labels for the output
+    double best[2] = {0, 0};                            // Fastest load of each format
+
+    for (int run = 0; run < 5; run++) {                 // Best of five, after the cache is warm
+        for (int k = 0; k < 2; k++) {                   // For each format
+            TraceHeader header;                         // Algorithm and frame count
+            std::vector<int> refs;                      // Every reference in the trace
+            PageInterner pages;                         // Page number behind each ID
+            auto start = std::chrono::steady_clock::now();  // Time the load
+            if (!readTrace(files[k], header, refs, pages)) {  // Load the whole trace
+                unlink(binaryFile.c_str());             // Remove the temporary file
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+            double seconds = std::chrono::duration<double>(  // Time taken
+                std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < best[k])          // If this is the fastest so far
+                best[k] = seconds;                      // Keep it
+        }                                               // End for loop
+    }                                                   // End for loop
+
+    long long sizes[2];                                 // File size of each format
+    for (int k = 0; k < 2; k++) {                       // For each format
+        std::FILE *file = std::fopen(files[k], "rb");   // Open it
+        std::fseek(file, 0, SEEK_END);                  // Seek to the end
+        sizes[k] = std::ftell(file);                    // The offset is the size
+        std::fclose(file);                              // Close it
+    }                                                   // End for loop
+    unlink(binaryFile.c_str());                         // Remove the temporary file
+
+    std::cout << "format,bytes,bytes_per_ref,seconds,mrefs_per_s\n";  // CSV header
+    for (int k = 0; k < 2; k++)                         // For each format
+        std::cout << names[k] << "," << sizes[k] << "," <<  // Display one row
+            (refCount ? (double) sizes[k] / refCount : 0) << "," << best[k] << "," <<
+            (best[k] > 0 ? refCount / best[k] / 1e6 : 0) << "\n";
+
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function benchLoad
+
+/**
+ * @brief Time frame lookups by scan, vector scan and hash at several frame counts
+ *
+ * Half the lookups hit. Prints CSV of nanoseconds per lookup so the
+ * frame count where hashing overtakes scanning can be read off.
+ *
+ * @return Exit status for main
+ */
+
+int benchFind()
+{
+    const int LOOKUPS = 1 << 20;                        // Lookups timed per method and frame count
+    const int sizes[] = {4, 8, 16, 32, 48, 64, 128, 256, 512, 1024};  // Frame counts to try
+    const char *kernelName;                             // Kernel the engines use
+    scanKernel(&kernelName);                            // Look it up
+    bool avx2 = cpuHasAvx2();                           // Whether the AVX2 column can run
+    std::mt19937 rng(42);                               // Fixed seed so runs compare
+
+    std::cout << "frames,findPage_ns,scalar_ns,sse2_ns,avx2_ns,hash_ns\n";  // CSV header
+
+    for (int frameCount : sizes) {                      // For every frame count
+        std::vector<int> frames(frameCount);            // Resident pages
+        std::vector<int> queries(LOOKUPS);              // Pages to look up
+        FlatMap slotOf;                                 // Hash index over the same frames
+        slotOf.reset(frameCount);                       // Sized for every frame
+
+        std::vector<int> pages(frameCount * 2);         // Candidate pages; half end up resident
+        for (int i = 0; i < frameCount * 2; i++)        // Number them
+            pages[i] = i;
+        std::shuffle(pages.begin(), pages.end(), rng);  // Pick a random half
+        for (int i = 0; i < frameCount; i++) {          // Fill every frame
+            frames[i] = pages[i];                       // With one of them
+            slotOf.insert(pages[i], i);                 // And index it
+        }                                               // End for loop
+        for (int &query : queries)                      // Every lookup
+            query = (int) (rng() % (frameCount * 2));   // Hits about half the time
+
+        double ns[5];                                   // Time per lookup for each method
+        long long sums[5];                              // Sum of positions, to check the methods agree
+
+        for (int m = 0; m < 5; m++) {                   // For every method
+            if (m == 3 && !avx2) {                      // If AVX2 is not available
+                ns[m] = 0;                              // Leave the column empty
+                sums[m] = sums[0];                      // Nothing to compare
+                continue;                               // Skip it
+            }                                           // End if statement
+
+            long long sum = 0;                          // Sum of positions found
+            auto start = std::chrono::steady_clock::now();  // Time the lookups
+            for (int q : queries) {                     // For every lookup
+                int position;                           // Where the page is, or -1
+                if (m == 0)                             // The original scan
+                    position = findPage(frames.data(), frameCount, q);
+                else if (m == 1)                        // Scalar scan that also finds a free frame
+                    position = scanFramesScalar(frames.data(), frameCount, q).position;
+#ifdef PAGER_X86
+                else if (m == 2)                        // Four frames per step
+                    position = scanFramesSse2(frames.data(), frameCount, q).position;
+                else if (m == 3)                        // Eight frames per step
+                    position = scanFramesAvx2(frames.data(), frameCount, q).position;
+#endif
+                else                                    // Hash lookup
+                    position = slotOf.find(q);
+                sum += position;                        // Keep the result live
+            }                                           // End for loop
+            ns[m] = std::chrono::duration<double, std::nano>(  // Time per lookup
+                std::chrono::steady_clock::now() - start).count() / LOOKUPS;
+            sums[m] = sum;                              // Remember the result
+        }                                               // End for loop
+
+        for (int m = 1; m < 5; m++)                     // Every method must agree with findPage
+            if (sums[m] != sums[0]) {                   // If one does not
+                std::cerr << "Lookup methods disagree at " << frameCount << " frames.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+
+        std::cout << frameCount;                        // Display one row
+        for (int m = 0; m < 5; m++) {                   // For every method
+            std::cout << ",";                           // Separate the columns
+            if (m != 3 || avx2)                         // Skip AVX2 when it did not run
+                std::cout << ns[m];                     // Display the time
+        }                                               // End for loop
+        std::cout << "\n";                              // End the row
+    }                                                   // End for loop
+
+    std::cerr << "Engines use the " << kernelName << " kernel\n";  // Report the dispatch choice
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function benchFind
 
 /**
  * @brief Main function
  */
 
 int main(int argc, char *argv[]) {                      // Main function
-    
-    if (argc != 2) {                                    // If the number of arguments is not equal to 2
+
+    if (argc > 1 && std::strcmp(argv[1], "--sweep") == 0)  // If a parameter sweep was requested
+        return runSweep(argc, argv, 2);                 // Run it with its own options
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)  // If the engine benchmark was requested
+        return runBench(argc, argv, 2);                 // Run it with its own options
+
+    if (argc > 1 && std::strcmp(argv[1], "--fuzz") == 0)  // If the differential test was requested
+        return runFuzz(argc, argv, 2);                  // Run it with its own options
+
+    if (argc > 1 && std::strcmp(argv[1], "--daemon") == 0)  // If a long-running simulator was requested
+        return runDaemon(argc, argv, 2);                // Run it with its own options
+
+    if (argc > 1 && std::strcmp(argv[1], "--shared") == 0)  // If processes should share one pool
+        return runShared(argc, argv, 2);                // Run it with its own options
+
+    if (argc == 4 && std::strcmp(argv[1], "--convert") == 0) {  // If a conversion was requested
+        long long refCount, bytes;                      // Size of the conversion
+        if (!convertTrace(argv[2], argv[3], refCount, bytes))  // Convert the trace
+            return 1;                                   // Return 1 which indicates error
+        std::cout << "Wrote " << refCount << " references in " << bytes << " bytes\n";  // Display the result
+        return 0;                                       // Return 0 which indicates success
+    }                                                   // End if statement
+
+    if (argc == 2 && std::strcmp(argv[1], "--test") == 0)  // If the self-test was requested
+        return runTests();                              // Run it
+
+    if (argc == 3 && std::strcmp(argv[1], "--bench-load") == 0)  // If a load benchmark was requested
+        return benchLoad(argv[2]);                      // Run it
+
+    if (argc == 2 && std::strcmp(argv[1], "--bench-find") == 0)  // If a lookup benchmark was requested
+        return benchFind();                             // Run it
+
+    bool stream = false;                                // Whether to stream the trace
+    bool reference = false;                             // Whether to run the reference engines
+    bool curve = false;                                 // Whether to print the miss-ratio curve
+    bool noHistory = false;                             // Whether to skip recording faults
+    double sampleRate = 0;                              // Page sampling rate for an approximate curve, or 0
+    int sampleSize = 0;                                 // Page budget for an approximate curve, or 0
+    uint64_t pageSize = 1;                              // Bytes per page if references are addresses
+    int threads = 1;                                    // Worker threads for LRU and the curve
+    long long window = WindowedOptPolicy::lookahead;    // References opt-window sees ahead
+    std::vector<long long> windows;                     // Window sizes for --lookahead, if any
+    std::vector<long long> deltas;                      // Working-set windows for --working-set, if any
+    std::vector<long long> taus;                        // PFF thresholds for --pff, if any
+    long long interval = 0;                             // References between time-series rows, or 0 for the default
+    const char *checkpoint = nullptr;                   // Checkpoint file for --stream, or nullptr
+    double checkpointSeconds = 60;                      // Seconds between checkpoints
+    bool resume = false;                                // Whether to pick up from the checkpoint
+    TlbSpec tlbSpec;                                    // TLB configuration for --tlb
+    bool useTlb = false;                                // Whether to translate through a TLB
+    PrefetchSpec prefetchSpec;                          // Prefetcher for --prefetch
+    bool usePrefetch = false;                           // Whether to prefetch
+    CostModel cost;                                     // Latencies for --cost
+    bool useCost = false;                               // Whether to report the effective access time
+    bool statsText = false;                             // Whether to report per-phase timings and counters
+    bool statsJson = false;                             // Whether to report them as JSON lines
+    OutputFormat format = FORMAT_TABLE;                 // How the results are written
+    const char *outputName = nullptr;                   // File named with --output, or stdout
+    const char *policyName = nullptr;                   // Policy named with --policy
+    const char *filename = nullptr;                     // Trace to read
+    bool usage = false;                                 // Whether the command line is bad
+
+    for (int i = 1; i < argc; i++) {                    // Walk the command line
+        if (std::strcmp(argv[i], "--stream") == 0)      // If streaming was requested
+            stream = true;                              // Stream the trace
+        else if (std::strcmp(argv[i], "--reference") == 0)  // If the reference engines were requested
+            reference = true;                           // Run the original scanning engines
+        else if (std::strcmp(argv[i], "--curve") == 0)  // If the miss-ratio curve was requested
+            curve = true;                               // Sweep every frame count
+        else if (std::strcmp(argv[i], "--no-history") == 0)  // If recording was turned off
+            noHistory = true;                           // Only count faults
+        else if (std::strcmp(argv[i], "--sample-rate") == 0 && i + 1 < argc)  // If a sampling rate was given
+            sampleRate = std::atof(argv[++i]);          // Sample that fraction of pages
+        else if (std::strcmp(argv[i], "--sample-size") == 0 && i + 1 < argc)  // If a page budget was given
+            sampleSize = std::atoi(argv[++i]);          // Track at most that many pages
+        else if (std::strcmp(argv[i], "--page-size") == 0 && i + 1 < argc)  // If references are addresses
+            pageSize = std::strtoull(argv[++i], nullptr, 0);  // Divide them by this
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)  // If a thread count was given
+            threads = std::atoi(argv[++i]);             // Split LRU's stack distances over that many
+        else if (std::strcmp(argv[i], "--window") == 0 && i + 1 < argc)  // If a lookahead window was given
+            window = std::atoll(argv[++i]);             // opt-window sees that many references ahead
+        else if (std::strcmp(argv[i], "--lookahead") == 0 && i + 1 < argc)  // If window sizes were listed
+            usage = !parseSizeList(argv[++i], windows) || usage;  // Compare each with OPT, or reject the command line
+        else if (std::strcmp(argv[i], "--working-set") == 0 && i + 1 < argc)  // If working-set windows were listed
+            usage = !parseSizeList(argv[++i], deltas) || usage;  // Track each, or reject the command line
+        else if (std::strcmp(argv[i], "--pff") == 0 && i + 1 < argc)  // If PFF thresholds were listed
+            usage = !parseSizeList(argv[++i], taus) || usage;  // Run each, or reject the command line
+        else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc)  // If a row interval was given
+            interval = std::atoll(argv[++i]);           // Print a row that often
+        else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)  // If a checkpoint file was named
+            checkpoint = argv[++i];                     // Snapshot the run there
+        else if (std::strcmp(argv[i], "--checkpoint-interval") == 0 && i + 1 < argc)  // If an interval was given
+            checkpointSeconds = std::atof(argv[++i]);   // Snapshot that often
+        else if (std::strcmp(argv[i], "--tlb") == 0 && i + 1 < argc)  // If a TLB was described
+            usage = !(useTlb = parseTlbSpec(argv[++i], tlbSpec)) || usage;  // Stream through it, or reject the command line
+        else if (std::strcmp(argv[i], "--cost") == 0 && i + 1 < argc)  // If latencies were given
+            usage = !(useCost = parseCostModel(argv[++i], cost)) || usage;  // Report the access time, or reject the command line
+        else if (std::strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc)  // If a prefetcher was named
+            usage = !(usePrefetch = parsePrefetchSpec(argv[++i], prefetchSpec)) || usage;  // Stream with it, or reject the command line
+        else if (std::strcmp(argv[i], "--stats") == 0)  // If the phases should be measured
+            statsText = true;                           // Report them as text
+        else if (std::strcmp(argv[i], "--stats-json") == 0)  // If they should be measured for a script
+            statsJson = true;                           // Report them as JSON lines
+        else if (std::strcmp(argv[i], "--resume") == 0) // If the run should continue from its checkpoint
+            resume = true;                              // Load it before reading
+        else if (std::strcmp(argv[i], "--policy") == 0 && i + 1 < argc)  // If a policy was named
+            policyName = argv[++i];                     // Run it instead of the header's algorithm
+        else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)  // If a format was named
+            usage = !parseFormat(argv[++i], format) || usage;  // Use it, or reject the command line
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)  // If an output file was named
+            outputName = argv[++i];                     // Write the results there
+        else if (filename == nullptr)                   // Else if no file has been named yet
+            filename = argv[i];                         // This is the trace file
+        else                                            // Else there is an extra argument
+            usage = true;                               // Mark the command line as bad
+    }                                                   // End for loop
+
+    if (sampleRate < 0 || sampleRate > 1 || sampleSize < 0 || pageSize == 0 || threads < 0 ||  // If an option is out of range
+        window < 1 || window > 1000000000)
+        usage = true;                                   // Mark the command line as bad
+
+    stream = stream || useTlb || usePrefetch || useCost;  // TLB, prefetching and cost runs always stream
+
+    if (useTlb && usePrefetch)                          // The two stages do not combine
+        usage = true;                                   // Mark the command line as bad
+
+    if ((statsText || statsJson) && (curve || !deltas.empty() || !taus.empty() || !windows.empty()))  // Only single-policy runs have phases
+        usage = true;                                   // Mark the command line as bad
+
+    if ((checkpoint != nullptr && (!stream || useTlb || usePrefetch)) || (resume && checkpoint == nullptr) || checkpointSeconds < 0)  // Checkpoints are for plain streamed runs
+        usage = true;                                   // Mark the command line as bad
+
+    if (filename == nullptr || usage) {                 // If there is not exactly one trace
         std::cerr << "Usage: " <<                       // Throw an error message
-            argv[0] << " <input_file>\n";               // Display the usage message
+            argv[0] << " [--stream | --curve] [--reference] [--no-history] [--policy <name>]\n" <<
+            "       [--format table|csv|jsonl] [--output <file>] [--sample-rate R | --sample-size N]\n" <<
+            "       [--page-size <bytes>] [--threads N] [--window W | --lookahead 1e2,1e4,...]\n" <<
+            "       [--working-set 1e3,1e4,...] [--pff 1e2,1e3,...] [--interval N]\n" <<
+            "       [--tlb default|l1=64:4,l1huge=32:4,l2=1536:12,huge=512,replace=lru|fifo|random]\n" <<
+            "       [--prefetch next:N|stride:N|markov:N] [--cost memory=200,fault=8e6,writeback=8e6]\n" <<
+            "       [--stats | --stats-json] [--checkpoint <file> [--checkpoint-interval S] [--resume]] <input_file|->\n";  // Display the usage message
+        std::cerr << "       " << argv[0] <<            // Display the sweep usage
+            " --sweep [--policies a,b,...] [--frames 1-64:4,128] [--threads N] [--cost ...]\n" <<
+            "       [--stats | --stats-json] <trace>...\n";
+        std::cerr << "       " << argv[0] << " --convert <input_file> <binary_file>\n";  // Display the conversion usage
+        std::cerr << "       " << argv[0] << " --bench-load <input_file>\n";  // Display the benchmark usage
+        std::cerr << "       " << argv[0] << " --bench-find\n";  // Display the lookup benchmark usage
+        std::cerr << "       " << argv[0] <<            // Display the engine benchmark usage
+            " --bench [--workloads uniform,zipf:0.99,...] [--sizes 1e3,1e6] [--frames 32] [--json]\n";
+        std::cerr << "       " << argv[0] <<            // Display the differential test usage
+            " --fuzz [--cases N] [--seed N] [--throughput [--sizes 1e4,1e5] [--frames 8,32,50]]\n";
+        std::cerr << "       " << argv[0] <<            // Display the daemon usage
+            " --daemon [--socket <path>] [--policies fifo,lru,clock] [--frames N] [--page-size <bytes>]\n";
+        std::cerr << "       " << argv[0] <<            // Display the shared-pool usage
+            " --shared [--policy lru] [--allocation global,fixed,proportional] [--interleave rr[:Q] | time]\n" <<
+            "       [--frames N] [--page-size <bytes>] [--threads N] <trace>...\n";
+        std::cerr << "       " << argv[0] << " --test\n";  // Display the self-test usage
+        std::cerr << "Policies:";                       // List the registered policies
+        for (int i = 0; i < POLICY_COUNT; i++)          // For every policy
+            std::cerr << " " << POLICIES[i].name;       // Show its name
+        std::cerr << "\n";                              // End the list
 
         return 1;                                       // Return 1
     }                                                   // End if statement
 
-    std::string line = readLineFromFile(argv[1]);       // Run readLineFromFile function using argv[1] as an argument
-    
-    int frameCount, refCount;                           // Declare frame count and reference count variables
-    char algo;                                          // Declare algorithm variable
-    int refs[100];                                      // Declare reference count array
+    WindowedOptPolicy::lookahead = (int) window;        // Window for opt-window
+
+    Instrumentation stats;                              // Phase timings and counters for --stats
+    if (statsText || statsJson)                         // If they were asked for
+        stats.enable();                                 // Open the counters on this thread
+
+    if (stream) {                                       // If streaming was requested
+        int status = runStream(filename, policyName, pageSize,  // Stream the trace through the policy
+                               checkpoint, checkpointSeconds, resume,
+                               useTlb ? &tlbSpec : nullptr,
+                               usePrefetch ? &prefetchSpec : nullptr,
+                               useCost ? &cost : nullptr,
+                               stats);
+        if (status == 0)                                // If the run completed
+            stats.report(std::cerr, statsJson);         // Show where its time went
+        return status;                                  // Return the run's status
+    }                                                   // End if statement
+
+    if (curve && (sampleRate > 0 || sampleSize > 0))    // If an approximate curve was requested
+        return printSampledCurve(filename, sampleRate, sampleSize, pageSize);  // Stream the trace through a sample
+
+    TraceHeader header;                                 // Algorithm and frame count
+    std::vector<int> refs;                              // Declare reference array
+    PageInterner pages;                                 // Page number behind each reference's ID
+    std::vector<char> writes;                           // Write flags, only to notice that there are any
+
+    {
+        ScopedPhase parsing(stats, "", "parse");        // Count the parse, if --stats is on
+        if (!readTrace(filename, header, refs, pages, pageSize, &writes))  // Read the whole trace
+            return 1;                                   // Return 1 which indicates error
+        parsing.setReferences((long long) refs.size());
+    }
+
+    if (!writes.empty())                                // If the trace writes
+        std::cerr << "Note: this mode treats writes as reads; "  // Say the flags are not simulated here
+                     "use --stream or --cost to count write-backs.\n";
+
+    int frameCount = header.frameCount;                 // Declare frame count variable
+    int refCount = (int) refs.size();                   // Declare reference count variable
+
+    if (frameCount < 1) {                               // If there are no frames to use
+        std::cerr << "Frame count must be at least 1.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (curve) {                                        // If the miss-ratio curve was requested
+        printMissCurve(refs.data(),                     // Sweep 1..frameCount in one pass
+                       refCount,                        // Number of references
+                       frameCount,                      // Largest frame count
+                       threads);                        // Worker threads
+        return 0;                                       // Return 0 which indicates success
+    }                                                   // End if statement
+
+    if (!deltas.empty() || !taus.empty()) {             // If variable allocation was asked for
+        printWorkingSetSeries(refs.data(),              // Track it over time
+                              refCount,                 // Number of references
+                              pages.size(),             // Number of distinct pages
+                              deltas,                   // Working-set windows
+                              taus,                     // PFF thresholds
+                              interval);                // References between rows
+        return 0;                                       // Return 0 which indicates success
+    }                                                   // End if statement
+
+    if (!windows.empty()) {                             // If windowed OPT was to be compared with OPT
+        printLookaheadCurve(refs.data(),                // Run it at each window size
+                            refCount,                   // Number of references
+                            frameCount,                 // Frames from the header
+                            windows);                   // Window sizes
+        return 0;                                       // Return 0 which indicates success
+    }                                                   // End if statement
+
+    const PolicyEntry *entry = policyName ?             // Policy named on the command line
+        findPolicy(policyName) :                        // Or the one in the header
+        findPolicy(header.algo, reference);
+
+    if (entry == nullptr) {                             // If there is no such policy
+        std::cerr << "Unknown algorithm '" <<           // Print error message
+            (policyName ? policyName : std::string(1, header.algo)) << "'.\n";  // Show what was asked for
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
 
-    int displayTable[50][1000];
+    if (entry->reference && frameCount > MAX_FRAMES) {  // The reference engines have fixed-size frame arrays
+        std::cerr << "The reference engines need at most " << MAX_FRAMES <<  // Print error message
+            " frames.\n";
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
 
-    parseInputLine(line,                                // Parse the input line
-                   algo,                                // Algorithm to be used
-                   frameCount,                          // Frame count that can be used
-                   refs,                                // Reference count array
-                   refCount);                           // Number of references from the input line
+    OutputBuffer out;                                   // Buffered results
 
-    wipeTable(displayTable, frameCount, refCount);      // Wipe display table
+    if (outputName != nullptr && !out.open(outputName)) {  // If the output file cannot be created
+        std::cerr << "Cannot create output file.\n";    // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
 
-    int pageFaults;                                     // Declare number of page faults
+    if (format == FORMAT_TABLE) {                       // Only the human table names the policy
+        out.put("Running ");                            // Display which policy is running
+        out.put(entry->label);
+        out.put('\n');
+    }                                                   // End if statement
 
-    switch (algo)                                       // Start switch statement
+    if (noHistory ||                                    // If no history is wanted
+        (format == FORMAT_TABLE && refCount > MAX_REFS)) {  // Or the table would be too wide to read
+        long long pageFaults;                           // Faults the policy takes
+
+        if (threads != 1 && std::strcmp(entry->name, "lru") == 0) {  // If LRU can be split across threads
+            std::vector<long long> histogram;           // References at each stack distance
+            long long coldMisses;                       // First references to a page
+            parallelStackDistances(refs.data(), refCount, threads, histogram, coldMisses);  // Chunked stack distances
+            pageFaults = lruFaults(histogram, refCount, frameCount);  // LRU faults at this size
+        } else {                                        // Else run the policy itself
+            ScopedPhase simulating(stats, entry->label, "simulate", refCount);  // Time it, if --stats is on
+            pageFaults = entry->run(frameCount,         // Run the policy without recording
+                                    refs.data(),        // Reference array
+                                    refCount,           // Number of references
+                                    nullptr);           // No history
+        }                                               // End if statement
+        {
+            ScopedPhase rendering(stats, entry->label, "render", refCount);  // Time the output, if --stats is on
+            renderSummary(out, format, refCount, pageFaults);  // Display the total number of faults
+            out.flush();                                // Write it inside the phase
+        }
+        stats.report(std::cerr, statsJson);             // Show where the time went, if --stats is on
+        return 0;                                       // Return 0 which indicates success
+    }                                                   // End if statement
+
+    FaultHistory history;                               // Frame changes at each fault
+    history.reset(std::min(refCount, MAX_REFS));        // Room for a drawn table; longer histories grow as faults occur
+
+    int pageFaults;                                     // Faults the policy takes
     {
-        case 'F': case 'f':                             // If file contains f or F
-            pageFaults = FIFO(frameCount,               // Run FIFO with frameCount
-                              refs,                     // Reference array
-                              refCount,                 // Number of refs from the input line
-                              displayTable);            // The table for displaying
-            break;                                      // Break out of switch statement
-
-        case 'O': case 'o':                             // If file contains o or O
-            pageFaults = OPT(frameCount,                // Run OPT with frameCount
-                             refs,                      // Reference array
-                             refCount,                  // Number of refs from the input line
-                             displayTable);             // The table for displaying
-            break;                                      // Break out of switch statement
-
-        case 'L': case 'l':                             // If file contains l or L
-            pageFaults = LRU(frameCount,                // Run LRU with frameCount
-                             refs,                      // Reference array
-                             refCount,                  // Number of refs from the input line
-                             displayTable);             // The table for displaying
-            break;                                      // Break out of switch statement
+        ScopedPhase simulating(stats, entry->label, "simulate+history", refCount);  // Time it, if --stats is on
+        pageFaults = entry->run(frameCount,             // Run the selected policy
+                                refs.data(),            // Reference array
+                                refCount,               // Number of refs from the input line
+                                &history);              // Record every fault
     }
 
-    printTable(refs,                                    // Reference array
-               refCount,                                // Number of refs from the input line
-               frameCount,                              // Frame count
-               displayTable,                            // The table for displaying
-               pageFaults);                             // Number of page faults
-    
-}                                                       // End main statement
\ No newline at end of file
+    {
+        ScopedPhase rendering(stats, entry->label, "render", refCount);  // Time the output, if --stats is on
+        if (format == FORMAT_TABLE)                     // If the human table was asked for
+            renderTable(out,                            // Draw it
+                        refs.data(),                    // Reference array
+                        pages,                          // Page numbers behind the references
+                        refCount,                       // Number of refs from the input line
+                        frameCount,                     // Frame count
+                        history,                        // Faults to rebuild the table from
+                        pageFaults);                    // Number of page faults
+        else                                            // Else write one record per fault
+            renderFaults(out, format, refCount, frameCount, history, pages);
+        out.flush();                                    // Write it inside the phase
+    }
+    stats.report(std::cerr, statsJson);                 // Show where the time went, if --stats is on
+
+}                                                       // End main statement
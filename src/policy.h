@@ -0,0 +1,691 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "flatmap.h"
+
+/*
+ * Replacement policies for the Simulator in simulator.h.
+ *
+ * The simulator owns the frames and finds resident pages; a policy only
+ * keeps the bookkeeping it needs to pick a victim. Every policy provides:
+ *
+ *   void init(int frameCount)                   reset to empty frames
+ *   void prepare(const int refs[], int count)   see the whole trace first (OPT only)
+ *   void onHit(int slot, long long t)           the page in frame slot was referenced
+ *   int  victim(int page, long long t)          frames are full; choose the frame to evict
+ *   void onMiss(int slot, int page, long long t) page was loaded into frame slot
+ *   void onWrite(int slot)                      the page in frame slot was written (after onHit or onMiss)
+ *
+ * Frames fill in index order before victim() is ever called, exactly as
+ * the first-free-frame scan in the reference engines does.
+ */
+
+/**
+ * @brief Doubly linked list of frames threaded through a node pool
+ *
+ * Node i belongs to frame i, so membership changes never allocate.
+ * The front is the most recently inserted frame.
+ */
+
+class FrameList {
+public:
+    /**
+     * @brief Reset to an empty list over frameCount frames
+     */
+
+    void init(int frameCount) {
+        nodes.assign(frameCount, Node{-1, -1});         // No frame is on the list
+        head = tail = -1;                               // The list is empty
+        count = 0;                                      // No members
+    }                                                   // End of function init
+
+    /**
+     * @brief Put frame slot at the front of the list
+     */
+
+    void pushFront(int slot) {
+        nodes[slot] = Node{-1, head};                   // Link in ahead of the old front
+        if (head != -1) nodes[head].prev = slot; else tail = slot;  // Fix up the old front
+        head = slot;                                    // The frame is now the front
+        count++;                                        // One more member
+    }                                                   // End of function pushFront
+
+    /**
+     * @brief Remove frame slot from the list
+     */
+
+    void unlink(int slot) {
+        Node &node = nodes[slot];                       // Node of the frame
+        if (node.prev != -1) nodes[node.prev].next = node.next; else head = node.next;  // Bypass forwards
+        if (node.next != -1) nodes[node.next].prev = node.prev; else tail = node.prev;  // Bypass backwards
+        count--;                                        // One fewer member
+    }                                                   // End of function unlink
+
+    /**
+     * @brief Move frame slot to the front of the list
+     */
+
+    void moveToFront(int slot) {
+        if (slot == head)                               // If it is already the front
+            return;                                     // Nothing to move
+        unlink(slot);                                   // Take it off the list
+        pushFront(slot);                                // Put it back at the front
+    }                                                   // End of function moveToFront
+
+    int back() const { return tail; }                   // Least recently inserted frame, or -1
+    int previous(int slot) const { return nodes[slot].prev; }  // Frame in front of slot, or -1
+    int size() const { return count; }                  // Number of frames on the list
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(nodes, head, tail, count); }  // Checkpoint every field
+
+private:
+    struct Node {
+        int prev;                                       // Neighbour towards the front, or -1
+        int next;                                       // Neighbour towards the back, or -1
+    };
+
+    std::vector<Node> nodes;                            // One node per frame
+    int head;                                           // Front of the list
+    int tail;                                           // Back of the list
+    int count;                                          // Number of frames on the list
+};
+
+/**
+ * @brief First in, first out: evict frames in the order they were filled
+ */
+
+struct FifoPolicy {
+    int frameCount;                                     // Number of frames that can be used
+    int fifoIndex;                                      // Index of the next frame to replace/FIFO queue pointer
+
+    void init(int frames) { frameCount = frames; fifoIndex = 0; }  // Start replacing at the first frame
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(frameCount, fifoIndex); }  // Checkpoint every field
+    void prepare(const int [], int) {}                  // FIFO never looks ahead
+    void onHit(int, long long) {}                       // Hits do not change the queue
+    void onMiss(int, int, long long) {}                 // Frames are replaced in a fixed rotation
+    void onWrite(int) {}                                // Dirty pages are not treated differently
+
+    int victim(int, long long) {
+        int slot = fifoIndex;                           // Replace the page at fifoIndex
+        fifoIndex = (fifoIndex + 1) % frameCount;       // Move FIFO pointer to the next frame
+        return slot;                                    // Return the frame to evict
+    }                                                   // End of function victim
+};
+
+/**
+ * @brief Least recently used, on an O(1) recency list
+ */
+
+struct LruPolicy {
+    FrameList recency;                                  // Front is the most recently used frame
+
+    void init(int frames) { recency.init(frames); }     // Nothing has been used yet
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(recency); }          // Checkpoint every field
+    void prepare(const int [], int) {}                  // LRU never looks ahead
+    void onHit(int slot, long long) { recency.moveToFront(slot); }  // Now the most recently used
+    void onMiss(int slot, int, long long) { recency.pushFront(slot); }  // Newly loaded is most recent
+    void onWrite(int) {}                                // Dirty pages are not treated differently
+
+    int victim(int, long long) {
+        int slot = recency.back();                      // The back of the list is the LRU page
+        recency.unlink(slot);                           // Take it off the list
+        return slot;                                    // Return the frame to evict
+    }                                                   // End of function victim
+};
+
+/**
+ * @brief Belady's OPT using precomputed next-use indices
+ *
+ * One backward pass records, for every reference, when the same page is
+ * referenced next. Resident pages sit in an ordered set keyed by
+ * (next use, -frame), so the victim is always the last element: pages
+ * never used again go first, lowest frame first, matching OPT().
+ */
+
+struct OptPolicy {
+    std::vector<int> nextUse;                           // nextUse[t] = next time refs[t] is referenced
+    std::set<std::pair<int, int>> byNextUse;            // (next use, -frame) of every resident page
+
+    void init(int) { byNextUse.clear(); }               // No resident pages
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(nextUse, byNextUse); }  // Checkpoint every field
+
+    void prepare(const int refs[], int refCount) {
+        std::vector<int> lastSeen;                      // Earliest time each page ID is seen in the backward pass
+        nextUse.resize(refCount);                       // One entry per reference
+
+        for (int t = refCount - 1; t >= 0; t--) {       // Walk the trace backwards
+            if (refs[t] >= (int) lastSeen.size())       // If the page ID is new
+                lastSeen.resize(refs[t] + 1, refCount); // refCount means never used again
+            nextUse[t] = lastSeen[refs[t]];             // Later reference to this page
+            lastSeen[refs[t]] = t;                      // This is now the nearest reference
+        }                                               // End for loop
+    }                                                   // End of function prepare
+
+    void onHit(int slot, long long t) {
+        byNextUse.erase({(int) t, -slot});              // Its next use was now
+        byNextUse.insert({nextUse[t], -slot});          // Key it by the following use
+    }                                                   // End of function onHit
+
+    void onMiss(int slot, int, long long t) {
+        byNextUse.insert({nextUse[t], -slot});          // Key the page by its next use
+    }                                                   // End of function onMiss
+
+    void onWrite(int) {}                                // Dirty pages are not treated differently
+
+    int victim(int, long long) {
+        auto last = std::prev(byNextUse.end());         // Largest next use, lowest frame on ties
+        int slot = -last->second;                       // Frame to replace
+        byNextUse.erase(last);                          // Drop the victim's key
+        return slot;                                    // Return the frame to evict
+    }                                                   // End of function victim
+};
+
+/**
+ * @brief OPT that sees only the next lookahead references
+ *
+ * The caller observes each reference as it arrives and only simulates
+ * it once lookahead later references have been observed (see
+ * runLookahead in simulator.h). The window is a ring of the pending
+ * references; each slot's next use is filled in when the page turns up
+ * again, through a map from page to its latest slot that forgets a page
+ * once its last slot leaves the window. A resident page whose next use
+ * is not in the window counts as never used again, and gets its real
+ * next use the moment that reference arrives. Memory is O(lookahead +
+ * frames) however long the stream; with a window at least as long as
+ * the trace, every decision matches OptPolicy.
+ */
+
+struct WindowedOptPolicy {
+    static constexpr long long NEVER = LLONG_MAX;       // Next use of a page not seen in the window
+    static inline int lookahead = 1000000;              // References seen ahead of the one simulated
+
+    std::vector<int> window;                            // Pending references, as a ring
+    std::vector<char> writes;                           // Whether each pending reference is a write
+    std::vector<long long> nextUse;                     // Next use of each ring slot's page, or NEVER
+    long long head;                                     // Time of the oldest pending reference
+    long long tail;                                     // Time of the next reference to arrive
+    FlatMap latest;                                     // Ring slot of each pending page's latest reference
+    FlatMap residentSlot;                               // Frame of each resident page
+    std::vector<int> pageIn;                            // Page in each frame
+    std::vector<long long> keyOf;                       // Next use of each frame's page
+    std::set<std::pair<long long, int>> byNextUse;      // (next use, -frame) of every resident page
+
+    void init(int frameCount) {
+        window.assign(lookahead + 1, -1);               // The simulated reference plus the lookahead
+        writes.assign(lookahead + 1, 0);
+        nextUse.assign(lookahead + 1, NEVER);
+        head = tail = 0;                                // Nothing pending
+        latest.reset(1024);                             // Grows with the pages in the window
+        residentSlot.reset(frameCount);                 // At most one entry per frame
+        pageIn.assign(frameCount, -1);                  // No resident pages
+        keyOf.assign(frameCount, NEVER);
+        byNextUse.clear();
+    }                                                   // End of function init
+
+    /**
+     * @brief Checkpoint every field but lookahead, which the checkpoint header records
+     *
+     * A loaded ring must match the current lookahead, or full() and the
+     * ring indexing would disagree.
+     */
+
+    template <class Archive>
+    void persist(Archive &ar) {
+        ar(window, writes, nextUse, head, tail, latest, residentSlot, pageIn, keyOf, byNextUse);
+        if constexpr (Archive::loading)                 // If the state was just read back
+            if (window.size() != (size_t) lookahead + 1 || writes.size() != window.size() ||  // If the ring is the wrong size
+                nextUse.size() != window.size() || head > tail || tail - head > lookahead)  // Or holds too much
+                ar.fail();                              // The checkpoint is unusable
+    }                                                   // End of function persist
+
+    void prepare(const int *, int) {}                   // Sees the trace only through observe
+
+    /**
+     * @brief A reference arrived; add it to the window
+     */
+
+    void observe(int page, bool write = false) {
+        int slot = (int) (tail % window.size());        // Ring slot for it
+        window[slot] = page;                            // Remember the page
+        writes[slot] = write;                           // And whether it writes
+        nextUse[slot] = NEVER;                          // Its own next use is not known yet
+
+        int previous = latest.find(page);               // Latest pending reference to the page
+        if (previous != -1) {                           // If there is one
+            nextUse[previous] = tail;                   // This is its next use
+        } else {                                        // Else the page may be resident with no known next use
+            int frame = residentSlot.find(page);        // Frame holding it, if any
+            if (frame != -1) {                          // If it is resident
+                byNextUse.erase({keyOf[frame], -frame});  // Its key was NEVER
+                keyOf[frame] = tail;                    // Now it is this reference
+                byNextUse.insert({tail, -frame});
+            }                                           // End if statement
+        }                                               // End if statement
+
+        latest.insert(page, slot);                      // This is now the page's latest reference
+        tail++;                                         // One more pending reference
+    }                                                   // End of function observe
+
+    bool full() const { return tail - head > lookahead; }  // Whether the oldest reference has its full lookahead
+    bool pending() const { return tail > head; }        // Whether any reference is waiting
+    int oldest() const { return window[head % window.size()]; }  // Page of the next reference to simulate
+    bool oldestWrites() const { return writes[head % window.size()]; }  // Whether that reference is a write
+
+    /**
+     * @brief The oldest reference has been simulated; drop it from the window
+     */
+
+    void retire() {
+        int slot = (int) (head % window.size());        // Its ring slot
+        if (latest.find(window[slot]) == slot)          // If no later reference to the page is pending
+            latest.erase(window[slot]);                 // Forget the page
+        head++;                                         // Move the window on
+    }                                                   // End of function retire
+
+    void onHit(int slot, long long t) {
+        byNextUse.erase({keyOf[slot], -slot});          // Its next use was now
+        keyOf[slot] = nextUse[t % window.size()];       // Key it by the following use
+        byNextUse.insert({keyOf[slot], -slot});
+    }                                                   // End of function onHit
+
+    void onMiss(int slot, int page, long long t) {
+        residentSlot.insert(page, slot);                // The page is resident
+        pageIn[slot] = page;
+        keyOf[slot] = nextUse[t % window.size()];       // Key it by its next use
+        byNextUse.insert({keyOf[slot], -slot});
+    }                                                   // End of function onMiss
+
+    void onWrite(int) {}                                // Dirty pages are not treated differently
+
+    int victim(int, long long) {
+        auto last = std::prev(byNextUse.end());         // Largest next use, lowest frame on ties
+        int slot = -last->second;                       // Frame to replace
+        byNextUse.erase(last);                          // Drop the victim's key
+        residentSlot.erase(pageIn[slot]);               // The page leaves
+        return slot;                                    // Return the frame to evict
+    }                                                   // End of function victim
+};
+
+/**
+ * @brief CLOCK and Second-Chance: FIFO order with a reference bit
+ *
+ * The hand sweeps the frames in fill order, clearing set reference bits
+ * and evicting the first frame whose bit is already clear. CLOCK sets
+ * the bit when a page is loaded (the load counts as a use); classic
+ * Second-Chance only sets it on a later hit, so a page that is never
+ * touched again is evicted on the first pass.
+ *
+ * @tparam ReferenceOnLoad Whether loading a page sets its reference bit
+ */
+
+template <bool ReferenceOnLoad>
+struct ReferenceBitPolicy {
+    std::vector<char> referenced;                       // Reference bit of each frame
+    int frameCount;                                     // Number of frames that can be used
+    int hand;                                           // Frame the hand points at
+
+    void init(int frames) {
+        referenced.assign(frames, 0);                   // All bits clear
+        frameCount = frames;                            // Remember the frame count
+        hand = 0;                                       // Start at the first frame
+    }                                                   // End of function init
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(referenced, frameCount, hand); }  // Checkpoint every field
+
+    void prepare(const int [], int) {}                  // CLOCK never looks ahead
+    void onHit(int slot, long long) { referenced[slot] = 1; }  // Set the reference bit
+    void onMiss(int slot, int, long long) { referenced[slot] = ReferenceOnLoad; }  // Loading may count as a use
+    void onWrite(int) {}                                // Dirty pages are not treated differently
+
+    int victim(int, long long) {
+        while (referenced[hand]) {                      // While the hand points at a referenced frame
+            referenced[hand] = 0;                       // Give it a second chance
+            hand = (hand + 1) % frameCount;             // Advance the hand
+        }                                               // End while loop
+
+        int slot = hand;                                // First frame with a clear bit
+        hand = (hand + 1) % frameCount;                 // The new page goes behind the hand
+        return slot;                                    // Return the frame to evict
+    }                                                   // End of function victim
+};
+
+typedef ReferenceBitPolicy<true> ClockPolicy;           // CLOCK
+typedef ReferenceBitPolicy<false> SecondChancePolicy;   // Second-Chance
+
+/**
+ * @brief Enhanced second chance: CLOCK that would rather evict clean pages
+ *
+ * Frames fall into four classes by (reference bit, dirty bit), and the
+ * victim comes from the lowest class present. The hand first sweeps for
+ * an unreferenced clean frame without touching anything, then for an
+ * unreferenced dirty one, clearing reference bits as it goes; after at
+ * most two rounds of both sweeps some frame qualifies. A dirty page is
+ * passed over while a clean one of the same recency is left, trading a
+ * little hit ratio for fewer write-backs.
+ */
+
+struct EnhancedClockPolicy {
+    std::vector<char> referenced;                       // Reference bit of each frame
+    std::vector<char> dirty;                            // Dirty bit of each frame
+    int frameCount;                                     // Number of frames that can be used
+    int hand;                                           // Frame the hand points at
+
+    void init(int frames) {
+        referenced.assign(frames, 0);                   // All bits clear
+        dirty.assign(frames, 0);
+        frameCount = frames;                            // Remember the frame count
+        hand = 0;                                       // Start at the first frame
+    }                                                   // End of function init
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(referenced, dirty, frameCount, hand); }  // Checkpoint every field
+
+    void prepare(const int [], int) {}                  // CLOCK never looks ahead
+    void onHit(int slot, long long) { referenced[slot] = 1; }  // Set the reference bit
+    void onWrite(int slot) { dirty[slot] = 1; }         // Set the dirty bit
+
+    void onMiss(int slot, int, long long) {
+        referenced[slot] = 1;                           // The load counts as a use
+        dirty[slot] = 0;                                // The page arrives clean
+    }                                                   // End of function onMiss
+
+    int victim(int, long long) {
+        while (true) {                                  // Until a frame qualifies
+            for (int k = 0; k < frameCount; k++) {      // Sweep once for (0, 0)
+                int slot = (hand + k) % frameCount;     // Next frame under the hand
+                if (!referenced[slot] && !dirty[slot]) {  // If it is unreferenced and clean
+                    hand = (slot + 1) % frameCount;     // The new page goes behind the hand
+                    return slot;                        // Return the frame to evict
+                }                                       // End if statement
+            }                                           // End for loop
+
+            for (int k = 0; k < frameCount; k++) {      // Sweep once for (0, 1)
+                int slot = hand;                        // Frame under the hand
+                hand = (hand + 1) % frameCount;         // Advance the hand
+                if (!referenced[slot])                  // If it is unreferenced (so dirty)
+                    return slot;                        // Return the frame to evict
+                referenced[slot] = 0;                   // Give it a second chance
+            }                                           // End for loop
+        }                                               // End while loop
+    }                                                   // End of function victim
+};
+
+/**
+ * @brief Clean-first LRU (Park et al.)
+ *
+ * LRU, except that the least recently used quarter of the frames is a
+ * clean-first region: the victim is the least recently used clean page
+ * there, and only if all of them are dirty the LRU page itself. The
+ * region is walked from the back of the recency list, so a fault costs
+ * at most frames / 4 steps.
+ */
+
+struct CleanFirstLruPolicy {
+    FrameList recency;                                  // Front is the most recently used frame
+    std::vector<char> dirty;                            // Dirty bit of each frame
+    int region;                                         // Frames at the LRU end searched for a clean page
+
+    void init(int frames) {
+        recency.init(frames);                           // Nothing has been used yet
+        dirty.assign(frames, 0);                        // Nothing has been written
+        region = std::max(1, frames / 4);               // A quarter of the frames
+    }                                                   // End of function init
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(recency, dirty, region); }  // Checkpoint every field
+    void prepare(const int [], int) {}                  // LRU never looks ahead
+    void onHit(int slot, long long) { recency.moveToFront(slot); }  // Now the most recently used
+    void onWrite(int slot) { dirty[slot] = 1; }         // Set the dirty bit
+
+    void onMiss(int slot, int, long long) {
+        recency.pushFront(slot);                        // Newly loaded is most recent
+        dirty[slot] = 0;                                // And clean
+    }                                                   // End of function onMiss
+
+    int victim(int, long long) {
+        int slot = recency.back();                      // Fall back to the LRU page
+        for (int k = 0, s = slot; k < region && s != -1; k++, s = recency.previous(s))  // Walk the clean-first region
+            if (!dirty[s]) {                            // If this page is clean
+                slot = s;                               // It goes instead
+                break;                                  // Stop looking
+            }                                           // End if statement
+        recency.unlink(slot);                           // Take it off the list
+        return slot;                                    // Return the frame to evict
+    }                                                   // End of function victim
+};
+
+/**
+ * @brief Least frequently used, ties broken by least recently used
+ *
+ * Counts start at one when a page is loaded and are forgotten when it is
+ * evicted. Frames are kept in an ordered set keyed by (count, last use),
+ * so every step is O(log frames).
+ */
+
+struct LfuPolicy {
+    std::vector<long long> uses;                        // Reference count of each frame
+    std::vector<long long> lastUse;                     // Time of each frame's latest reference
+    std::set<std::tuple<long long, long long, int>> byUses;  // (count, last use, frame)
+
+    void init(int frames) {
+        uses.assign(frames, 0);                         // No references yet
+        lastUse.assign(frames, -1);                     // Never used
+        byUses.clear();                                 // No resident pages
+    }                                                   // End of function init
+
+    template <class Archive>
+    void persist(Archive &ar) { ar(uses, lastUse, byUses); }  // Checkpoint every field
+
+    void prepare(const int [], int) {}                  // LFU never looks ahead
+
+    void onHit(int slot, long long t) {
+        byUses.erase(std::make_tuple(uses[slot], lastUse[slot], slot));  // Drop the old key
+        uses[slot]++;                                   // One more reference
+        lastUse[slot] = t;                              // Referenced now
+        byUses.insert(std::make_tuple(uses[slot], lastUse[slot], slot));  // Insert the new key
+    }                                                   // End of function onHit
+
+    void onMiss(int slot, int, long long t) {
+        uses[slot] = 1;                                 // The load is the first reference
+        lastUse[slot] = t;                              // Referenced now
+        byUses.insert(std::make_tuple(uses[slot], lastUse[slot], slot));  // Insert the key
+    }                                                   // End of function onMiss
+
+    void onWrite(int) {}                                // Dirty pages are not treated differently
+
+    int victim(int, long long) {
+        int slot = std::get<2>(*byUses.begin());        // Fewest uses, oldest first
+        byUses.erase(byUses.begin());                   // Drop the victim's key
+        return slot;                                    // Return the frame to evict
+    }                                                   // End of function victim
+};
+
+/**
+ * @brief Adaptive Replacement Cache (Megiddo and Modha)
+ *
+ * Resident frames are split between T1 (seen once recently) and T2 (seen
+ * at least twice). Ghost lists B1 and B2 remember the pages recently
+ * evicted from each, and hits in them move the target size p of T1.
+ * Ghost entries are pages, not frames, so they live in their own pool
+ * indexed through a FlatMap.
+ */
+
+struct ArcPolicy {
+    FrameList t1;                                       // Resident pages seen once recently
+    FrameList t2;                                       // Resident pages seen at least twice recently
+    std::vector<char> inT2;                             // Whether each frame is on T2
+    std::vector<int> pageOf;                            // Page held by each frame
+    int capacity;                                       // c, the number of frames
+    int target;                                         // p, the target size of T1
+
+    struct Ghost {
+        int page;                                       // Evicted page
+        int prev;                                       // Neighbour towards the front, or -1
+        int next;                                       // Neighbour towards the back, or -1
+        int list;                                       // 1 for B1, 2 for B2
+    };
+
+    std::vector<Ghost> ghosts;                          // Pool of ghost entries
+    std::vector<int> freeGhosts;                        // Unused entries in the pool
+    FlatMap ghostOf;                                    // Ghost entry of each evicted page
+    int ghostHead[3];                                   // Front (most recent) of B1 and B2
+    int ghostTail[3];                                   // Back (oldest) of B1 and B2
+    int ghostSize[3];                                   // Length of B1 and B2
+
+    void init(int frames) {
+        t1.init(frames);                                // T1 is empty
+        t2.init(frames);                                // T2 is empty
+        inT2.assign(frames, 0);                         // No frame is on T2
+        pageOf.assign(frames, -1);                      // No frame holds a page
+        capacity = frames;                              // c
+        target = 0;                                     // p starts at zero
+        ghosts.clear();                                 // No ghosts
+        freeGhosts.clear();                             // Nothing to recycle
+        ghostOf.reset(2 * frames);                      // B1 and B2 hold at most 2c pages
+        for (int list = 1; list <= 2; list++) {         // For B1 and B2
+            ghostHead[list] = ghostTail[list] = -1;     // The list is empty
+            ghostSize[list] = 0;                        // No members
+        }                                               // End for loop
+    }                                                   // End of function init
+
+    template <class Archive>
+    void persist(Archive &ar) {                         // Checkpoint every field
+        ar(t1, t2, inT2, pageOf, capacity, target, ghosts, freeGhosts, ghostOf, ghostHead, ghostTail, ghostSize);
+    }                                                   // End of function persist
+
+    void prepare(const int [], int) {}                  // ARC never looks ahead
+
+    void onHit(int slot, long long) {
+        if (inT2[slot]) {                               // If the page is already on T2
+            t2.moveToFront(slot);                       // Make it the most recent
+        } else {                                        // Else it was seen once before
+            t1.unlink(slot);                            // Leave T1
+            t2.pushFront(slot);                         // Join T2
+            inT2[slot] = 1;                             // Remember the move
+        }                                               // End if statement
+    }                                                   // End of function onHit
+
+    int victim(int page, long long) {
+        int ghost = ghostOf.find(page);                 // Ghost entry of the faulting page, if any
+        int list = ghost == -1 ? 0 : ghosts[ghost].list;  // Which ghost list holds it
+
+        if (list == 1) {                                // Case II: hit in B1, favour recency
+            int delta = ghostSize[2] / ghostSize[1];    // |B2| / |B1|
+            target = std::min(capacity, target + std::max(delta, 1));  // Grow p
+            return replace(false);                      // Evict into the ghost lists
+        }                                               // End if statement
+
+        if (list == 2) {                                // Case III: hit in B2, favour frequency
+            int delta = ghostSize[1] / ghostSize[2];    // |B1| / |B2|
+            target = std::max(0, target - std::max(delta, 1));  // Shrink p
+            return replace(true);                       // Evict into the ghost lists
+        }                                               // End if statement
+
+        if (t1.size() + ghostSize[1] == capacity) {     // Case IV-A: L1 is full
+            if (t1.size() < capacity) {                 // If B1 has entries
+                dropGhost(1);                           // Forget the oldest page in B1
+                return replace(false);                  // Evict into the ghost lists
+            }                                           // End if statement
+
+            int slot = t1.back();                       // B1 is empty: evict the oldest page in T1 outright
+            t1.unlink(slot);                            // Take it off T1
+            return slot;                                // Return the frame to evict
+        }                                               // End if statement
+
+        if (t1.size() + t2.size() + ghostSize[1] + ghostSize[2] == 2 * capacity)  // Case IV-B: directory is full
+            dropGhost(2);                               // Forget the oldest page in B2
+        return replace(false);                          // Evict into the ghost lists
+    }                                                   // End of function victim
+
+    void onMiss(int slot, int page, long long) {
+        int ghost = ghostOf.find(page);                 // Ghost entry of the page, if any
+        pageOf[slot] = page;                            // Remember which page the frame holds
+
+        if (ghost != -1) {                              // If the page was in B1 or B2
+            removeGhost(ghost);                         // It is resident again
+            t2.pushFront(slot);                         // Seen twice: join T2
+            inT2[slot] = 1;                             // Remember the list
+        } else {                                        // Else it is new
+            t1.pushFront(slot);                         // Seen once: join T1
+            inT2[slot] = 0;                             // Remember the list
+        }                                               // End if statement
+    }                                                   // End of function onMiss
+
+    void onWrite(int) {}                                // Dirty pages are not treated differently
+
+private:
+    /**
+     * @brief ARC's REPLACE: evict from T1 or T2 and remember the page as a ghost
+     *
+     * @param inB2 Whether the faulting page is in B2
+     */
+
+    int replace(bool inB2) {
+        bool fromT1 = t1.size() > 0 &&                  // T1 has a page to give up
+            (t1.size() > target || (inB2 && t1.size() == target) || t2.size() == 0);  // And is over target
+
+        FrameList &list = fromT1 ? t1 : t2;             // List losing a page
+        int slot = list.back();                         // Its oldest page
+        list.unlink(slot);                              // Take it off the list
+        addGhost(fromT1 ? 1 : 2, pageOf[slot]);         // Remember it in B1 or B2
+        return slot;                                    // Return the frame to evict
+    }                                                   // End of function replace
+
+    /**
+     * @brief Put page at the front of ghost list 1 (B1) or 2 (B2)
+     */
+
+    void addGhost(int list, int page) {
+        int ghost;                                      // Entry to fill
+        if (!freeGhosts.empty()) {                      // If an entry can be recycled
+            ghost = freeGhosts.back();                  // Reuse it
+            freeGhosts.pop_back();                      // It is no longer free
+        } else {                                        // Else grow the pool
+            ghost = (int) ghosts.size();                // Next new entry
+            ghosts.push_back(Ghost{});                  // Allocate it
+        }                                               // End if statement
+
+        ghosts[ghost] = Ghost{page, -1, ghostHead[list], list};  // Link in at the front
+        if (ghostHead[list] != -1) ghosts[ghostHead[list]].prev = ghost; else ghostTail[list] = ghost;  // Fix up the old front
+        ghostHead[list] = ghost;                        // The entry is now the front
+        ghostSize[list]++;                              // One more member
+        ghostOf.insert(page, ghost);                    // Index it by page
+    }                                                   // End of function addGhost
+
+    /**
+     * @brief Remove a ghost entry from its list and recycle it
+     */
+
+    void removeGhost(int ghost) {
+        Ghost &g = ghosts[ghost];                       // The entry
+        if (g.prev != -1) ghosts[g.prev].next = g.next; else ghostHead[g.list] = g.next;  // Bypass forwards
+        if (g.next != -1) ghosts[g.next].prev = g.prev; else ghostTail[g.list] = g.prev;  // Bypass backwards
+        ghostSize[g.list]--;                            // One fewer member
+        ghostOf.erase(g.page);                          // Unindex the page
+        freeGhosts.push_back(ghost);                    // Recycle the entry
+    }                                                   // End of function removeGhost
+
+    /**
+     * @brief Forget the oldest page in ghost list 1 (B1) or 2 (B2)
+     */
+
+    void dropGhost(int list) {
+        if (ghostTail[list] != -1)                      // If the list has a member
+            removeGhost(ghostTail[list]);               // Remove the oldest
+    }                                                   // End of function dropGhost
+};
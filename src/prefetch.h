@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief Which prefetcher to run and how far ahead it reaches
+ */
+
+struct PrefetchSpec {
+    enum Kind { NEXT, STRIDE, MARKOV } kind;            // Detector
+    int degree;                                         // Pages proposed per trigger
+};
+
+/**
+ * @brief Parse "next:N", "stride:N" or "markov:N" (N defaults to 1)
+ *
+ * @return false if the text is none of them
+ */
+
+inline bool parsePrefetchSpec(const char *text,
+                              PrefetchSpec &spec)
+{
+    const char *colon = std::strchr(text, ':');         // Start of the degree, if any
+    size_t length = colon ? (size_t) (colon - text) : std::strlen(text);  // Length of the name
+
+    if (length == 4 && std::strncmp(text, "next", 4) == 0)  // Sequential readahead
+        spec.kind = PrefetchSpec::NEXT;
+    else if (length == 6 && std::strncmp(text, "stride", 6) == 0)  // Stride detector
+        spec.kind = PrefetchSpec::STRIDE;
+    else if (length == 6 && std::strncmp(text, "markov", 6) == 0)  // Successor history
+        spec.kind = PrefetchSpec::MARKOV;
+    else                                                // Else the name is unknown
+        return false;                                   // The text is invalid
+
+    spec.degree = 1;                                    // One page unless told otherwise
+    if (colon == nullptr)                               // If no degree was given
+        return true;                                    // Keep it
+
+    char *end;                                          // End of the degree
+    long degree = std::strtol(colon + 1, &end, 10);     // Pages per trigger
+    spec.degree = (int) degree;                         // Use it
+    return end != colon + 1 && *end == '\0' && degree >= 1 && degree <= 1024;  // It must be a sensible count
+}                                                       // End of function parsePrefetchSpec
+
+/**
+ * @brief Proposes pages to load ahead of demand, from the references seen so far
+ *
+ * next:N   on a demand fault, or the first use of a prefetched page,
+ *          proposes the N pages that follow (sequential readahead)
+ * stride:N once two consecutive references have moved by the same
+ *          non-zero stride, proposes the next N pages along it
+ * markov:N remembers the last N distinct pages that followed each
+ *          page and proposes them whenever the page is referenced
+ *
+ * The detectors see page numbers, so sequential and strided runs are
+ * found in address order; the Markov table is indexed by dense ID.
+ * Runs stop at page 0 and at the highest page rather than wrap.
+ */
+
+class Prefetcher {
+public:
+    explicit Prefetcher(const PrefetchSpec &how) : spec(how), lastPage(0), lastStride(0), previous(-1), repeats(0) {}
+
+    /**
+     * @brief Note a demand reference and propose pages to prefetch
+     *
+     * @param page       Page number referenced
+     * @param id         Its dense ID
+     * @param fault      Whether the reference faulted
+     * @param firstUse   Whether it was the first use of a prefetched page
+     * @param candidates Receives the page numbers to prefetch
+     */
+
+    void observe(uint64_t page,
+                 int id,
+                 bool fault,
+                 bool firstUse,
+                 std::vector<uint64_t> &candidates) {
+        candidates.clear();                             // Nothing proposed yet
+
+        switch (spec.kind) {
+        case PrefetchSpec::NEXT:                        // Sequential readahead
+            if (fault || firstUse)                      // If the stream needs more pages
+                for (int k = 1; k <= spec.degree && (uint64_t) k <= LAST - page; k++)  // The next degree pages, short of the top
+                    candidates.push_back(page + k);
+            break;
+
+        case PrefetchSpec::STRIDE: {                    // Stride detector
+            int64_t stride = (int64_t) (page - lastPage);  // Step from the previous reference
+            repeats = stride != 0 && stride == lastStride ? repeats + 1 : 0;  // Confirmed if it repeats
+            lastStride = stride;                        // Remember it
+            lastPage = page;
+            if (repeats > 0) {                          // If the stride is confirmed
+                uint64_t step = stride > 0 ? (uint64_t) stride : 0 - (uint64_t) stride;  // Its size
+                uint64_t room = stride > 0 ? LAST - page : page;  // How far the pages go that way
+                for (int k = 1; k <= spec.degree && (uint64_t) k <= room / step; k++)  // Run ahead along it, stopping at either end
+                    candidates.push_back(stride > 0 ? page + step * k : page - step * k);
+            }                                           // End if statement
+            break;
+        }
+
+        case PrefetchSpec::MARKOV:                      // Successor history
+            if (previous != -1 && previous != id)       // If there is a transition to learn
+                learn(previous, page);                  // Record it
+            previous = id;                              // This page is the next source
+            if ((size_t) id < successors.size())        // If it has a history
+                for (int k = 0; k < spec.degree; k++)   // Propose its successors, most recent first
+                    if (successors[id][k] != NONE)
+                        candidates.push_back(successors[id][k]);
+            break;
+        }                                               // End switch statement
+    }                                                   // End of function observe
+
+private:
+    static constexpr uint64_t NONE = ~0ULL;             // Empty successor slot
+    static constexpr uint64_t LAST = ~0ULL - 1;         // Highest page; all ones cannot be interned
+
+    /**
+     * @brief Record that page followed the page with ID from
+     */
+
+    void learn(int from, uint64_t page) {
+        if ((size_t) from >= successors.size())         // If the source is new
+            successors.resize(from + 1, std::vector<uint64_t>(spec.degree, NONE));  // Give it an empty history
+        std::vector<uint64_t> &next = successors[from]; // Its successors, most recent first
+
+        int k = 0;                                      // Where page is, or the last slot
+        while (k < spec.degree - 1 && next[k] != page)  // Find page or stop at the oldest
+            k++;
+        for (; k > 0; k--)                              // Shift the newer ones back
+            next[k] = next[k - 1];
+        next[0] = page;                                 // page is now the most recent
+    }                                                   // End of function learn
+
+    PrefetchSpec spec;                                  // Detector and degree
+    uint64_t lastPage;                                  // Previous page (stride)
+    int64_t lastStride;                                 // Previous step (stride)
+    int previous;                                       // Previous page ID (Markov)
+    int repeats;                                        // Times the stride has repeated
+    std::vector<std::vector<uint64_t>> successors;      // successors[id] = pages that followed it
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+
+#include "checkpoint.h"
+#include "history.h"
+#include "intern.h"
+#include "policy.h"
+#include "prefetch.h"
+#include "simulator.h"
+#include "tlb.h"
+
+/*
+ * Reference engines, defined in main.cpp. They scan the frames on every
+ * reference, hold at most MAX_FRAMES frames, and are kept to check the
+ * policies in policy.h against.
+ */
+
+const int MAX_FRAMES = 50;                              // Frames the reference engines can hold
+
+int FIFO(int frameCount, const int refs[], int refCount, FaultHistory *history);
+int LRU(int frameCount, const int refs[], int refCount, FaultHistory *history);
+int OPT(int frameCount, const int refs[], int refCount, FaultHistory *history);
+
+/**
+ * @brief A simulator that consumes a trace chunk by chunk
+ *
+ * Type-erased wrapper so callers can pick a policy at run time and
+ * still get a loop specialized for it; the virtual call happens once
+ * per chunk, not once per reference.
+ */
+
+class Engine {
+public:
+    virtual ~Engine() {}
+    virtual void prepare(const int refs[], int refCount) = 0;  // Show the policy the whole trace
+    virtual void run(const int refs[], int count) = 0;  // Feed the next chunk
+    virtual void runWrites(const int refs[], const char writes[], int count) = 0;  // Feed the next chunk with write flags
+    virtual void finish() {}                            // The trace has ended; settle any lagging references
+    virtual long long pageFaults() const = 0;           // Page faults so far
+    virtual long long writeBacks() const = 0;           // Dirty pages replaced so far
+    virtual bool save(CheckpointWriter &out) = 0;       // Write the whole state to a checkpoint
+    virtual bool load(CheckpointReader &in) = 0;        // Replace the state with a checkpoint's
+
+    /**
+     * @brief Feed the next chunk with every reference translated through tlb first
+     *
+     * @param ids         The chunk as dense page IDs
+     * @param pages       The same chunk as page numbers
+     * @param pageNumbers Page number behind every ID, for shootdowns
+     * @param writes      Write flag of every reference, or nullptr if all read
+     *
+     * @return false if the engine cannot tell which reference faulted
+     */
+
+    virtual bool runTranslated(const int [], const uint64_t [], int, const uint64_t [], Tlb &, const char []) { return false; }
+
+    /**
+     * @brief Feed the next chunk, loading the pages prefetcher proposes after each reference
+     *
+     * @param ids    The chunk as dense page IDs
+     * @param pages  The same chunk as page numbers
+     * @param writes Write flag of every reference, or nullptr if all read
+     *
+     * The prefetcher proposes page numbers; the interner gives them IDs.
+     *
+     * @return false if the engine cannot prefetch
+     */
+
+    virtual bool runPrefetched(const int [], const uint64_t [], int, Prefetcher &, PageInterner &, const char []) { return false; }
+    virtual PrefetchStats prefetchStats() const { return PrefetchStats{0, 0, 0, 0}; }  // Speculative loads so far
+};
+
+/**
+ * @brief Engine over a counting-only Simulator for Policy
+ *
+ * @tparam Prefetch Whether runPrefetched works; only the engines made
+ *                  for --prefetch pay for it
+ */
+
+template <class Policy, bool Prefetch = false>
+class PolicyEngine : public Engine {
+public:
+    explicit PolicyEngine(int frameCount) { sim.init(frameCount); }  // Start with empty frames
+
+    void prepare(const int refs[], int refCount) override { sim.prepare(refs, refCount); }  // Forward
+    void run(const int refs[], int count) override { sim.run(refs, count); }  // Forward
+    long long pageFaults() const override { return sim.pageFaults; }  // Forward
+    long long writeBacks() const override { return sim.writeBacks; }  // Forward
+    bool save(CheckpointWriter &out) override { out(sim); return out.good(); }  // Frames, counters and policy
+
+    void runWrites(const int refs[], const char writes[], int count) override {
+        for (int i = 0; i < count; i++)                 // For every reference in the chunk
+            sim.access(refs[i], writes[i] != 0);        // Read or write the page
+    }                                                   // End of function runWrites
+    bool load(CheckpointReader &in) override { in(sim); return in.good(); }  // The same, read back
+
+    bool runTranslated(const int ids[], const uint64_t pages[], int count,
+                       const uint64_t pageNumbers[], Tlb &tlb, const char writes[]) override {
+        for (int i = 0; i < count; i++) {               // For every reference in the chunk
+            bool fault = sim.access(ids[i], writes != nullptr && writes[i]);  // Simulate it
+            if (fault && sim.evicted != -1)             // If a page left memory
+                tlb.evict(pageNumbers[sim.evicted]);    // Its translation goes too
+            tlb.translate(pages[i], fault);             // Then translate the reference
+        }                                               // End for loop
+        return true;                                    // Every reference was translated
+    }                                                   // End of function runTranslated
+
+    bool runPrefetched(const int ids[], const uint64_t pages[], int count,
+                       Prefetcher &prefetcher, PageInterner &interner, const char writes[]) override {
+        if constexpr (Prefetch) {                       // If the simulator can load speculatively
+            for (int i = 0; i < count; i++) {           // For every reference in the chunk
+                bool fault = sim.access(ids[i], writes != nullptr && writes[i]);  // Simulate it
+                prefetcher.observe(pages[i], ids[i], fault, !fault && sim.firstUse, candidates);  // Ask what to load next
+                for (uint64_t page : candidates) {      // For every proposed page
+                    int id = interner.intern(page);     // Its ID, or -1 if it cannot have one
+                    if (id != -1)                       // If it can
+                        sim.prefetch(id);               // Load it unless it is resident
+                }                                       // End for loop
+            }                                           // End for loop
+            return true;                                // Every reference was simulated
+        }                                               // End if statement
+        return false;                                   // This engine was built without prefetching
+    }                                                   // End of function runPrefetched
+
+    PrefetchStats prefetchStats() const override { return sim.prefetched; }  // Forward
+
+private:
+    Simulator<Policy, false, Prefetch> sim;             // The specialized loop
+    std::vector<uint64_t> candidates;                   // Pages the prefetcher proposed
+};
+
+/**
+ * @brief Create an Engine for Policy
+ */
+
+template <class Policy, bool Prefetch = false>
+std::unique_ptr<Engine> makeEngine(int frameCount)
+{
+    return std::unique_ptr<Engine>(new PolicyEngine<Policy, Prefetch>(frameCount));  // Heap allocate the engine
+}                                                       // End of function makeEngine
+
+/**
+ * @brief Engine for OPT over a bounded lookahead window
+ *
+ * Runs behind the input by the window size, so its fault count only
+ * covers the whole trace after finish.
+ */
+
+class LookaheadEngine : public Engine {
+public:
+    explicit LookaheadEngine(int frameCount) { sim.init(frameCount); }  // Start with empty frames
+
+    void prepare(const int *, int) override {}          // Sees the trace only through run
+    void run(const int refs[], int count) override { runLookahead(sim, refs, count); }  // Extend the window
+    void runWrites(const int refs[], const char writes[], int count) override { runLookahead(sim, refs, count, writes); }  // The same, flags and all
+    void finish() override { drainLookahead(sim); }     // Simulate what is left in the window
+    long long pageFaults() const override { return sim.pageFaults; }  // Forward
+    long long writeBacks() const override { return sim.writeBacks; }  // Forward
+    bool save(CheckpointWriter &out) override { out(sim); return out.good(); }  // Frames, counters and window
+    bool load(CheckpointReader &in) override { in(sim); return in.good(); }  // The same, read back
+
+private:
+    Simulator<WindowedOptPolicy, false> sim;            // The specialized loop
+};
+
+/**
+ * @brief Create a LookaheadEngine
+ */
+
+inline std::unique_ptr<Engine> makeLookaheadEngine(int frameCount)
+{
+    return std::unique_ptr<Engine>(new LookaheadEngine(frameCount));  // Heap allocate the engine
+}                                                       // End of function makeLookaheadEngine
+
+/**
+ * @brief One replacement policy the command line can select
+ */
+
+struct PolicyEntry {
+    const char *name;                                   // Name for --policy
+    char code;                                          // Algorithm letter in the trace header
+    const char *label;                                  // Name shown in "Running ..."
+    bool reference;                                     // Whether this is one of the scanning reference engines
+    bool wholeTrace;                                    // Whether the policy must see the whole trace first
+    int (*run)(int frameCount, const int refs[], int refCount, FaultHistory *history);  // Run a whole trace
+    std::unique_ptr<Engine> (*make)(int frameCount);    // Create a streaming engine, or nullptr
+    std::unique_ptr<Engine> (*makePrefetching)(int frameCount);  // Create a streaming engine that can prefetch, or nullptr
+};
+
+const PolicyEntry POLICIES[] = {
+    {"fifo",          'F', "FIFO",          false, false, simulate<FifoPolicy>,         makeEngine<FifoPolicy>,         makeEngine<FifoPolicy, true>},
+    {"lru",           'L', "LRU",           false, false, simulate<LruPolicy>,          makeEngine<LruPolicy>,          makeEngine<LruPolicy, true>},
+    {"opt",           'O', "OPT",           false, true,  simulate<OptPolicy>,          makeEngine<OptPolicy>,          nullptr},
+    {"clock",         'C', "CLOCK",         false, false, simulate<ClockPolicy>,        makeEngine<ClockPolicy>,        makeEngine<ClockPolicy, true>},
+    {"second-chance", 'S', "Second-Chance", false, false, simulate<SecondChancePolicy>, makeEngine<SecondChancePolicy>, makeEngine<SecondChancePolicy, true>},
+    {"lfu",           'U', "LFU",           false, false, simulate<LfuPolicy>,          makeEngine<LfuPolicy>,          makeEngine<LfuPolicy, true>},
+    {"arc",           'A', "ARC",           false, false, simulate<ArcPolicy>,          makeEngine<ArcPolicy>,          makeEngine<ArcPolicy, true>},
+    {"clock-dirty",   'E', "Enhanced CLOCK", false, false, simulate<EnhancedClockPolicy>, makeEngine<EnhancedClockPolicy>, makeEngine<EnhancedClockPolicy, true>},
+    {"lru-clean",     'D', "Clean-First LRU", false, false, simulate<CleanFirstLruPolicy>, makeEngine<CleanFirstLruPolicy>, makeEngine<CleanFirstLruPolicy, true>},
+    {"opt-window",    'W', "OPT (windowed)", false, false, simulateLookahead,          makeLookaheadEngine,            nullptr},
+    {"fifo-ref",      'F', "FIFO",          true,  false, FIFO,                         nullptr,                        nullptr},
+    {"lru-ref",       'L', "LRU",           true,  false, LRU,                          nullptr,                        nullptr},
+    {"opt-ref",       'O', "OPT",           true,  true,  OPT,                          nullptr,                        nullptr},
+};
+
+const int POLICY_COUNT = sizeof(POLICIES) / sizeof(POLICIES[0]);  // Number of registered policies
+
+/**
+ * @brief Find a policy by its --policy name
+ *
+ * @return The entry, or nullptr if no policy has that name
+ */
+
+inline const PolicyEntry *findPolicy(const char *name)
+{
+    for (int i = 0; i < POLICY_COUNT; i++)              // For every registered policy
+        if (std::strcmp(POLICIES[i].name, name) == 0)   // If the name matches
+            return &POLICIES[i];                        // Return the entry
+    return nullptr;                                     // No such policy
+}                                                       // End of function findPolicy
+
+/**
+ * @brief Find a policy by the algorithm letter in a trace header
+ *
+ * @param code      Algorithm letter, either case
+ * @param reference Whether to pick the scanning reference engine
+ *
+ * @return The entry, or nullptr if no policy uses that letter
+ */
+
+inline const PolicyEntry *findPolicy(char code, bool reference)
+{
+    if (code >= 'a' && code <= 'z')                     // Letters may be lower case
+        code = code - 'a' + 'A';                        // Compare in upper case
+
+    for (int i = 0; i < POLICY_COUNT; i++)              // For every registered policy
+        if (POLICIES[i].code == code &&                 // If the letter matches
+            POLICIES[i].reference == reference)         // And so does the kind of engine
+            return &POLICIES[i];                        // Return the entry
+    return nullptr;                                     // No such policy
+}                                                       // End of function findPolicy
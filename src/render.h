@@ -0,0 +1,354 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "history.h"
+#include "intern.h"
+
+const int OUTPUT_BUFFER_SIZE = 1 << 16;                 // Bytes formatted before each write
+const int OUTPUT_SLACK = 32;                            // Room kept for one number or short string
+
+/**
+ * @brief Output formats for a run's fault history
+ */
+
+enum OutputFormat {
+    FORMAT_TABLE,                                       // Human-readable frame grid
+    FORMAT_CSV,                                         // One CSV row per fault
+    FORMAT_JSONL                                        // One JSON object per fault
+};
+
+/**
+ * @brief Parse a --format name
+ *
+ * @return false if the name is not a known format
+ */
+
+inline bool parseFormat(const char *name,
+                        OutputFormat &format)
+{
+    if (std::strcmp(name, "table") == 0)                // If the grid was asked for
+        format = FORMAT_TABLE;                          // Use it
+    else if (std::strcmp(name, "csv") == 0)             // If CSV was asked for
+        format = FORMAT_CSV;                            // Use it
+    else if (std::strcmp(name, "jsonl") == 0)           // If JSON lines were asked for
+        format = FORMAT_JSONL;                          // Use it
+    else                                                // Else the name is unknown
+        return false;                                   // Report the failure
+    return true;                                        // The format was set
+}                                                       // End of function parseFormat
+
+/**
+ * @brief Formats text into a reusable block and writes it out in bulk
+ *
+ * Replaces one stream insertion per cell with appends into a 64 KB
+ * buffer, so a large history costs a few big fwrite calls instead of
+ * millions of small formatted writes.
+ */
+
+class OutputBuffer {
+public:
+    OutputBuffer() : file(stdout), ownsFile(false), pos(0), buffer(OUTPUT_BUFFER_SIZE) {}
+
+    ~OutputBuffer() {
+        flush();                                        // Write whatever is left
+        if (ownsFile)                                   // Only close files we opened ourselves
+            std::fclose(file);                          // Close the output file
+    }                                                   // End destructor
+
+    /**
+     * @brief Write to filename instead of stdout
+     *
+     * @return false if the file cannot be created
+     */
+
+    bool open(const char *filename) {
+        file = std::fopen(filename, "wb");              // Create the output file
+        ownsFile = file != nullptr;                     // Close it in the destructor if it opened
+        if (file == nullptr)                            // If it could not be created
+            file = stdout;                              // Keep a valid target for the destructor
+        return ownsFile;                                // Report whether the file is open
+    }                                                   // End of function open
+
+    /**
+     * @brief Append one character
+     */
+
+    void put(char c) {
+        reserve();                                      // Make room
+        buffer[pos++] = c;                              // Store the character
+    }                                                   // End of function put
+
+    /**
+     * @brief Append a string
+     */
+
+    void put(const char *text) {
+        while (*text) {                                 // While characters remain
+            reserve();                                  // Make room
+            int room = (int) buffer.size() - pos;       // Bytes free in the buffer
+            int n = 0;                                  // Bytes copied this pass
+            while (n < room && text[n])                 // Copy until full or done
+                buffer[pos + n] = text[n], n++;         // Copy one byte
+            pos += n;                                   // Account for them
+            text += n;                                  // Move past them
+        }                                               // End while loop
+    }                                                   // End of function put
+
+    /**
+     * @brief Append value in decimal
+     */
+
+    void putInt(long long value) {
+        if (value < 0) {                                // If the value is negative
+            put('-');                                   // Write the sign
+            putUnsigned(0 - (unsigned long long) value);  // Then the magnitude
+        } else {                                        // Else
+            putUnsigned(value);                         // Write it as is
+        }                                               // End if statement
+    }                                                   // End of function putInt
+
+    /**
+     * @brief Append an unsigned value in decimal
+     *
+     * Converts two digits per step through a lookup table rather than
+     * going through the locale-aware stream formatter.
+     */
+
+    void putUnsigned(unsigned long long v) {
+        static const char pairs[] =                     // "00" through "99"
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        reserve();                                      // Make room for the longest number
+        char digits[20];                                // Digits, filled from the end
+        int n = 20;                                     // Start of the digits written so far
+        while (v >= 100) {                              // While more than two digits remain
+            int pair = (int) (v % 100) * 2;             // Offset of the lowest two digits
+            v /= 100;                                   // Drop them
+            digits[--n] = pairs[pair + 1];              // Ones digit
+            digits[--n] = pairs[pair];                  // Tens digit
+        }                                               // End while loop
+        if (v >= 10) {                                  // If two digits remain
+            digits[--n] = pairs[v * 2 + 1];             // Ones digit
+            digits[--n] = pairs[v * 2];                 // Tens digit
+        } else {                                        // Else one digit remains
+            digits[--n] = (char) ('0' + v);             // Write it
+        }                                               // End if statement
+
+        std::memcpy(&buffer[pos], digits + n, 20 - n);  // Copy the digits out
+        pos += 20 - n;                                  // Account for them
+    }                                                   // End of function putUnsigned
+
+    /**
+     * @brief Append the page number behind id, or -1 for no page
+     */
+
+    void putPage(const PageInterner &pages, int id) {
+        if (id == -1)                                   // If there is no page
+            put("-1");                                  // Say so
+        else                                            // Else
+            putUnsigned(pages.page(id));                // Write the page number
+    }                                                   // End of function putPage
+
+    /**
+     * @brief Write everything formatted so far
+     */
+
+    void flush() {
+        if (pos > 0)                                    // If anything is waiting
+            std::fwrite(buffer.data(), 1, pos, file);   // Write it in one block
+        pos = 0;                                        // The buffer is empty again
+        std::fflush(file);                              // Push it past stdio
+    }                                                   // End of function flush
+
+private:
+    /**
+     * @brief Write the buffer out if it is too full for another item
+     */
+
+    void reserve() {
+        if (pos + OUTPUT_SLACK > (int) buffer.size()) { // If a number might not fit
+            std::fwrite(buffer.data(), 1, pos, file);   // Write the block
+            pos = 0;                                    // Start over
+        }                                               // End if statement
+    }                                                   // End of function reserve
+
+    std::FILE *file;                                    // Where the output goes
+    bool ownsFile;                                      // Whether the destructor closes it
+    int pos;                                            // Bytes formatted into buffer
+    std::vector<char> buffer;                           // Formatted output
+};
+
+/**
+ * @brief Draw the human-readable frame grid
+ *
+ * Each frame's row is rebuilt by replaying the fault history: a column
+ * shows the frames only where the reference faulted.
+ *
+ * @param out        Where the grid goes
+ * @param refs[]     Page IDs of the references from input file
+ * @param pages      Maps the IDs back to page numbers
+ * @param refCount   Number of references in input file
+ * @param frameCount Number of frames allowed to be used
+ * @param history    Faults recorded while the policy ran
+ * @param pageFaults Number of page faults that occurred
+ */
+
+inline void renderTable(OutputBuffer &out,
+                        const int refs[],
+                        const PageInterner &pages,
+                        int refCount,
+                        int frameCount,
+                        const FaultHistory &history,
+                        long long pageFaults)
+{
+    for (int t = 0; t < refCount; t++) {                // For every reference
+        out.putPage(pages, refs[t]);                    // Display it
+        out.put(' ');                                   // Followed by a space
+    }                                                   // End for loop
+    out.put('\n');                                      // Add new line
+
+    for (int t = 0; t < refCount * 2; t++)              // Two dashes per reference
+        out.put('-');                                   // Add dash
+    out.put('\n');                                      // Add new line
+
+    for (int f = 0; f < frameCount; f++) {              // For every frame
+        int page = -1;                                  // Page in frame f so far (-1 is empty)
+        long long next = 0;                             // Next fault to replay
+
+        for (int t = 0; t < refCount; t++) {            // For every reference
+            bool fault = next < history.size() &&       // Whether the reference at t faulted
+                history[next].time == t;
+
+            if (fault) {                                // If it did
+                if (history[next].slot == f)            // If the fault loaded frame f
+                    page = history[next].page;          // Frame f now holds that page
+                next++;                                 // Move to the next fault
+            }                                           // End if statement
+
+            if (!fault || page == -1) {                 // If there is no fault or the frame is empty
+                out.put("  ");                          // Display blank
+            } else {                                    // Else
+                out.putPage(pages, page);               // Display the page
+                out.put(' ');                           // Followed by a space
+            }                                           // End if statement
+        }                                               // End for loop
+
+        out.put('\n');                                  // Add new line
+    }                                                   // End for loop
+
+    out.put("Total page faults = ");                    // Display the total number of faults
+    out.putInt(pageFaults);
+    out.put('\n');
+}                                                       // End of function renderTable
+
+/**
+ * @brief Write one record per fault, with the frames after it
+ *
+ * CSV rows are "time,page,frame,evicted,f0,f1,..."; JSON lines carry the
+ * same fields with the frames as an array, followed by a summary line.
+ * An empty frame or a fault with no victim shows as -1.
+ *
+ * @param out        Where the records go
+ * @param format     FORMAT_CSV or FORMAT_JSONL
+ * @param refCount   Number of references in the trace
+ * @param frameCount Number of frames allowed to be used
+ * @param history    Faults recorded while the policy ran
+ * @param pages      Maps the recorded page IDs back to page numbers
+ */
+
+inline void renderFaults(OutputBuffer &out,
+                         OutputFormat format,
+                         long long refCount,
+                         int frameCount,
+                         const FaultHistory &history,
+                         const PageInterner &pages)
+{
+    std::vector<int> frames(frameCount, -1);            // Frames as of the current fault
+
+    if (format == FORMAT_CSV) {                         // CSV starts with a header
+        out.put("time,page,frame,evicted");             // Fixed columns
+        for (int f = 0; f < frameCount; f++) {          // One column per frame
+            out.put(",f");                              // Column name
+            out.putInt(f);
+        }                                               // End for loop
+        out.put('\n');                                  // End the header
+    }                                                   // End if statement
+
+    for (long long i = 0; i < history.size(); i++) {    // For every fault
+        const FaultHistory::Fault &fault = history[i];  // The fault
+        int evicted = frames[fault.slot];               // Page it replaced, or -1
+        frames[fault.slot] = fault.page;                // Apply it
+
+        if (format == FORMAT_CSV) {                     // One CSV row
+            out.putInt(fault.time);
+            out.put(',');
+            out.putPage(pages, fault.page);
+            out.put(',');
+            out.putInt(fault.slot);
+            out.put(',');
+            out.putPage(pages, evicted);
+            for (int f = 0; f < frameCount; f++) {      // Every frame
+                out.put(',');
+                out.putPage(pages, frames[f]);
+            }                                           // End for loop
+        } else {                                        // One JSON object
+            out.put("{\"time\":");
+            out.putInt(fault.time);
+            out.put(",\"page\":");
+            out.putPage(pages, fault.page);
+            out.put(",\"frame\":");
+            out.putInt(fault.slot);
+            out.put(",\"evicted\":");
+            out.putPage(pages, evicted);
+            out.put(",\"frames\":[");
+            for (int f = 0; f < frameCount; f++) {      // Every frame
+                if (f > 0)                              // Separate the entries
+                    out.put(',');
+                out.putPage(pages, frames[f]);
+            }                                           // End for loop
+            out.put("]}");
+        }                                               // End if statement
+        out.put('\n');                                  // End the record
+    }                                                   // End for loop
+
+    if (format == FORMAT_JSONL) {                       // JSON lines end with a summary
+        out.put("{\"references\":");
+        out.putInt(refCount);
+        out.put(",\"faults\":");
+        out.putInt(history.size());
+        out.put("}\n");
+    }                                                   // End if statement
+}                                                       // End of function renderFaults
+
+/**
+ * @brief Write only the fault total, for runs without a history
+ */
+
+inline void renderSummary(OutputBuffer &out,
+                          OutputFormat format,
+                          long long refCount,
+                          long long pageFaults)
+{
+    if (format == FORMAT_TABLE) {                       // Plain text
+        out.put("Total page faults = ");
+        out.putInt(pageFaults);
+        out.put('\n');
+    } else if (format == FORMAT_CSV) {                  // CSV with its own header
+        out.put("references,faults\n");
+        out.putInt(refCount);
+        out.put(',');
+        out.putInt(pageFaults);
+        out.put('\n');
+    } else {                                            // A single JSON object
+        out.put("{\"references\":");
+        out.putInt(refCount);
+        out.put(",\"faults\":");
+        out.putInt(pageFaults);
+        out.put("}\n");
+    }                                                   // End if statement
+}                                                       // End of function renderSummary
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+const size_t CACHE_LINE = 64;                           // Bytes per cache line, to keep the indices apart
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer and one consumer
+ *
+ * The producer only writes tail and the consumer only writes head, so
+ * each index has a single writer and needs no read-modify-write. The
+ * release store that publishes an index pairs with the acquire load on
+ * the other side, which makes the slot contents visible before the
+ * index that covers them. The indices sit on separate cache lines so
+ * the two threads do not bounce one line between them, and each side
+ * keeps a cached copy of the other's index to avoid reading it at all
+ * while there is known room or data.
+ */
+
+template <class T>
+class SpscRing {
+public:
+    /**
+     * @brief Make room for capacity items (rounded up to a power of two)
+     */
+
+    explicit SpscRing(size_t capacity) : head(0), tail(0), cachedHead(0), cachedTail(0) {
+        size_t size = 2;                                // At least two slots
+        while (size < capacity)                         // Round up to a power of two
+            size *= 2;
+        slots.resize(size);                             // Allocate the slots once
+        mask = size - 1;                                // Index modulo the size
+    }                                                   // End constructor
+
+    /**
+     * @brief Producer: append item unless the ring is full
+     *
+     * @return false if the ring is full; item is left untouched
+     */
+
+    bool tryPush(T &item) {
+        size_t t = tail.load(std::memory_order_relaxed);  // Only this thread writes tail
+        if (t - cachedHead == slots.size()) {           // If the ring looks full
+            cachedHead = head.load(std::memory_order_acquire);  // Refresh the consumer's position
+            if (t - cachedHead == slots.size())         // If it really is full
+                return false;                           // Report it
+        }                                               // End if statement
+        slots[t & mask] = std::move(item);              // Fill the slot
+        tail.store(t + 1, std::memory_order_release);   // Publish it
+        return true;                                    // The item is queued
+    }                                                   // End of function tryPush
+
+    /**
+     * @brief Consumer: take the oldest item unless the ring is empty
+     *
+     * @return false if the ring is empty
+     */
+
+    bool tryPop(T &item) {
+        size_t h = head.load(std::memory_order_relaxed);  // Only this thread writes head
+        if (h == cachedTail) {                          // If the ring looks empty
+            cachedTail = tail.load(std::memory_order_acquire);  // Refresh the producer's position
+            if (h == cachedTail)                        // If it really is empty
+                return false;                           // Report it
+        }                                               // End if statement
+        item = std::move(slots[h & mask]);              // Take the item
+        head.store(h + 1, std::memory_order_release);   // Hand the slot back
+        return true;                                    // An item was taken
+    }                                                   // End of function tryPop
+
+    /**
+     * @brief Items queued, as seen from any thread (may be momentarily stale)
+     */
+
+    size_t size() const {
+        size_t h = head.load(std::memory_order_acquire);  // Read head first; tail can only be further on
+        return tail.load(std::memory_order_acquire) - h;  // Items between them
+    }                                                   // End of function size
+
+private:
+    std::vector<T> slots;                               // Ring storage
+    size_t mask;                                        // slots.size() - 1
+    alignas(CACHE_LINE) std::atomic<size_t> head;       // Next slot to pop; written by the consumer
+    alignas(CACHE_LINE) std::atomic<size_t> tail;       // Next slot to fill; written by the producer
+    alignas(CACHE_LINE) size_t cachedHead;              // Producer's last view of head
+    alignas(CACHE_LINE) size_t cachedTail;              // Consumer's last view of tail
+};
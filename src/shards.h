@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "curve.h"
+#include "flatmap.h"
+#include "trace.h"
+
+const uint32_t SHARDS_MODULUS = 1 << 24;                // Hash values are taken modulo this
+const uint64_t NO_PAGE = ~0ULL;                         // Marks a free position; the parser never produces it
+
+/**
+ * @brief Spread a page number over 64 bits (SplitMix64 finalizer)
+ */
+
+inline uint64_t mixPage(uint64_t page)
+{
+    uint64_t x = page + 0x9e3779b97f4a7c15ULL;          // Offset so page 0 does not hash to 0
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;        // First mixing round
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;        // Second mixing round
+    return x ^ (x >> 31);                               // Final fold
+}                                                       // End of function mixPage
+
+/**
+ * @brief Approximate LRU stack distances from a hash-sampled subset of pages
+ *
+ * SHARDS (spatially hashed sampling): a page is tracked only if its
+ * hash falls below a threshold T, i.e. with rate R = T / modulus, and
+ * since the choice depends only on the page, every reference to a
+ * tracked page is seen. Distances among tracked pages are scaled by
+ * 1/R to estimate the true stack distance, using the same Fenwick
+ * count as lruStackDistances.
+ *
+ * With a page budget, T starts at the full modulus and drops whenever
+ * too many pages are tracked: the pages with the largest hashes are
+ * evicted and the counts gathered so far are rescaled to the new rate
+ * (lazily, by raising the weight of later references instead).
+ * The Fenwick positions are compacted when they run out, so memory
+ * stays proportional to the tracked pages rather than the trace length.
+ * At the end the smallest-distance bucket absorbs the difference
+ * between the expected and actual number of sampled references
+ * (SHARDS_adj), which removes most of the bias from sampling a few hot
+ * pages more or less often than their share.
+ */
+
+class ShardsSampler {
+public:
+    /**
+     * @brief Start a new sample
+     *
+     * @param rate        Fraction of pages to track (ignored if budget is set)
+     * @param budget      Most pages to track at once, or 0 for a fixed rate
+     * @param maxDistance Largest frame count the curve is needed for
+     */
+
+    void init(double rate, int budget, int maxDistance) {
+        if (budget > 0)                                 // A budget starts by tracking everything
+            rate = 1;
+        threshold = rate >= 1 ? SHARDS_MODULUS :        // Hash values below this are tracked
+            std::max<uint32_t>(1, (uint32_t) (rate * SHARDS_MODULUS));
+        maxPages = budget;                              // Page budget, or 0
+        histogram.assign(maxDistance + 2, 0);           // Last bucket collects deeper distances
+        references = 0;                                 // No references yet
+        sampled = 0;                                    // No sampled references yet
+        weight = 1;                                     // Nothing rescaled yet
+        peak = 0;                                       // No pages tracked yet
+        capacity = 1 << 12;                             // Initial Fenwick positions
+        next = 0;                                       // Next free position
+        marks.reset(capacity);                          // No marks
+        pageAt.assign(capacity, NO_PAGE);               // No page owns a position
+        lastPos.reset(1024);                            // Grows with the tracked pages
+        largest = std::priority_queue<std::pair<uint32_t, uint64_t>>();  // No tracked pages
+    }                                                   // End of function init
+
+    /**
+     * @brief Feed one reference
+     */
+
+    void access(uint64_t page) {
+        references++;                                   // Every reference counts toward the total
+        uint32_t hash = (uint32_t) (mixPage(page) & (SHARDS_MODULUS - 1));  // Page's sampling value
+        if (hash >= threshold)                          // If the page is not sampled
+            return;                                     // Ignore it
+
+        sampled += weight;                              // One more sampled reference
+        int previous = lastPos.find(page);              // Position of the page's latest reference
+
+        if (previous == -1) {                           // If the page is new to the sample
+            histogram.back() += weight;                 // A cold miss at every size
+            if (maxPages > 0)                           // If a budget is enforced
+                largest.push(std::make_pair(hash, page));  // Remember it for eviction
+        } else {                                        // Else measure its distance
+            long long distance = marks.prefix(next - 1) - marks.prefix(previous) + 1;  // Tracked pages since, plus this one
+            long long scaled = (long long) std::llround(distance * (double) SHARDS_MODULUS / threshold);  // Scale to all pages
+            histogram[std::min<long long>(scaled, histogram.size() - 1)] += weight;  // Count it
+            marks.add(previous, -1);                    // The old reference is no longer the latest
+            pageAt[previous] = NO_PAGE;                 // Free its position
+        }                                               // End if statement
+
+        if (next == capacity)                           // If the positions are used up
+            compact();                                  // Renumber the live ones
+        marks.add(next, 1);                             // This reference is now the latest
+        pageAt[next] = page;                            // Owned by this page
+        lastPos.insert(page, next++);                   // Remember where it is
+
+        if (maxPages > 0 && (int) lastPos.size() > maxPages)  // If the budget is exceeded
+            lowerThreshold();                           // Drop the pages with the largest hashes
+        peak = std::max(peak, (int) lastPos.size());    // Track the most pages held
+    }                                                   // End of function access
+
+    /**
+     * @brief Estimated LRU miss ratio for 1..maxDistance frames
+     *
+     * @param missRatio missRatio[k] receives the estimate for k frames (index 0 unused)
+     */
+
+    void curve(std::vector<double> &missRatio) const {
+        std::vector<double> counts(histogram.size());   // Counts at the final rate
+        for (size_t d = 0; d < counts.size(); d++)      // For every bucket
+            counts[d] = histogram[d] / weight;          // Undo the deferred rescaling
+        double expected = references * rate();          // Sampled references an unbiased sample would have
+
+        size_t first = std::min<size_t>((size_t) std::llround(1 / rate()), counts.size() - 1);  // Bucket of the smallest distance
+        counts[first] += expected - sampled / weight;   // SHARDS_adj correction
+        double total = expected > 0 ? expected : 1;     // Avoid dividing by zero
+
+        missRatio.assign(counts.size() - 1, 1.0);       // Everything misses with no frames
+        double hits = 0;                                // Sampled references that hit so far
+        for (size_t k = 1; k < missRatio.size(); k++) { // For every frame count
+            hits += counts[k];                          // References at distance k hit from here on
+            missRatio[k] = std::min(1.0, std::max(0.0, 1 - hits / total));  // Clamp rounding noise
+        }                                               // End for loop
+    }                                                   // End of function curve
+
+    double rate() const { return (double) threshold / SHARDS_MODULUS; }  // Current sampling rate
+    long long referenceCount() const { return references; }  // References fed so far
+    int peakPages() const { return peak; }              // Most pages tracked at once
+
+private:
+    /**
+     * @brief Renumber live positions 0..live-1, growing if over half are live
+     */
+
+    void compact() {
+        int live = 0;                                   // Positions kept so far
+        for (int i = 0; i < next; i++)                  // In time order
+            if (pageAt[i] != NO_PAGE) {                 // If the position is a page's latest reference
+                pageAt[live] = pageAt[i];               // Move it down
+                lastPos.insert(pageAt[i], live++);      // And record its new position
+            }                                           // End if statement
+
+        if (live * 2 > capacity)                        // If compaction freed too little
+            capacity *= 2;                              // Grow
+        pageAt.resize(capacity);                        // Match the new size
+        std::fill(pageAt.begin() + live, pageAt.end(), NO_PAGE);  // Everything past the live ones is free
+        marks.reset(capacity);                          // Rebuild the marks
+        for (int i = 0; i < live; i++)                  // One per live position
+            marks.add(i, 1);
+        next = live;                                    // Continue after them
+    }                                                   // End of function compact
+
+    /**
+     * @brief Evict the largest-hash pages and rescale to the lower rate
+     */
+
+    void lowerThreshold() {
+        uint32_t newThreshold = largest.top().first;    // Pages at or above this hash go
+        double scale = (double) newThreshold / threshold;  // Ratio of the new rate to the old
+
+        while (!largest.empty() && largest.top().first >= newThreshold) {  // For every page to evict
+            uint64_t page = largest.top().second;       // The page
+            largest.pop();                              // Stop tracking its hash
+            int position = lastPos.find(page);          // Its latest reference
+            marks.add(position, -1);                    // Clear the mark
+            pageAt[position] = NO_PAGE;                 // Free the position
+            lastPos.erase(page);                        // Forget the page
+        }                                               // End while loop
+
+        weight /= scale;                                // Later references outweigh earlier ones by the rate change
+        threshold = newThreshold;                       // Sample less from now on
+    }                                                   // End of function lowerThreshold
+
+    uint32_t threshold;                                 // Hash values below this are sampled
+    int maxPages;                                       // Page budget, or 0
+    std::vector<double> histogram;                      // Sampled references per scaled distance; last is deeper or cold
+    long long references;                               // Every reference seen
+    double sampled;                                     // Sampled references, in the same units as the histogram
+    double weight;                                      // What one sampled reference adds; dividing by it rescales to the current rate
+    int peak;                                           // Most pages tracked at once
+    int capacity;                                       // Fenwick positions
+    int next;                                           // Next unused position
+    Fenwick marks;                                      // 1 at each tracked page's latest position
+    std::vector<uint64_t> pageAt;                       // Page owning each position, or NO_PAGE
+    BasicFlatMap<uint64_t> lastPos;                     // Latest position of each tracked page
+    std::priority_queue<std::pair<uint32_t, uint64_t>> largest;  // Tracked pages by hash, largest on top (budget only)
+};
+
+/**
+ * @brief Stream a trace through a ShardsSampler and print its LRU curve
+ *
+ * @param filename Trace to read, or "-" for stdin
+ * @param rate     Fraction of pages to sample (when budget is 0)
+ * @param budget   Most pages to track at once, or 0 for a fixed rate
+ * @param pageSize Bytes per page if references are addresses, else 1
+ *
+ * @return Exit status for main
+ */
+
+inline int printSampledCurve(const char *filename,
+                             double rate,
+                             int budget,
+                             uint64_t pageSize)
+{
+    TraceReader reader;                                 // Reader over the input
+    TraceHeader header;                                 // Algorithm and frame count
+    reader.setPageSize(pageSize);                       // Divide addresses down to pages
+
+    if (!reader.open(filename) || !reader.readHeader(header)) {  // If the trace cannot be read
+        std::cerr << "Cannot read input file.\n";       // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (reader.framesOverflowed()) {                    // If the header's frame count is out of range
+        std::cerr << "Frame count is larger than 2147483647.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (header.frameCount < 1) {                        // If there are no frames to use
+        std::cerr << "Frame count must be at least 1.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    ShardsSampler sampler;                              // The sample
+    sampler.init(rate, budget, header.frameCount);      // Curve up to the header's frame count
+    std::vector<uint64_t> chunk(TRACE_CHUNK_SIZE);      // Chunk of parsed page numbers
+    int count;                                          // Size of the current chunk
+
+    while ((count = reader.nextChunk(chunk.data(), TRACE_CHUNK_SIZE)) > 0)  // While references remain
+        for (int i = 0; i < count; i++)                 // For every reference in the chunk
+            sampler.access(chunk[i]);                   // Feed it to the sample
+
+    if (reader.overflowed()) {                          // If a reference was too large
+        std::cerr << "Reference does not fit in 64 bits, or is the reserved page 2^64-1.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (reader.truncated()) {                           // If the binary body ended early
+        std::cerr << "Binary trace is truncated.\n";    // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    std::vector<double> missRatio;                      // Estimated curve
+    sampler.curve(missRatio);                           // Compute it
+
+    std::cout << "frames,lru_faults\n";                 // CSV header
+    for (int frames = 1; frames <= header.frameCount; frames++)  // For every frame count
+        std::cout << frames << "," <<                   // Display one row of the curve
+            std::llround(missRatio[frames] * sampler.referenceCount()) << "\n";
+
+    std::cerr << "Sampled at rate " << sampler.rate() << ", tracking at most " <<  // Summarize the sample
+        sampler.peakPages() << " pages\n";
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function printSampledCurve
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "registry.h"
+#include "sweep.h"
+#include "threadpool.h"
+#include "trace.h"
+
+const int MAX_PROCESSES = 65536;                        // Processes an owner tag can name
+
+/**
+ * @brief How the processes' references are merged into one stream
+ */
+
+struct InterleaveSpec {
+    bool byTime;                                        // Spread each trace over a common timeline instead of taking turns
+    int quantum;                                        // References each process issues per turn (round-robin)
+};
+
+/**
+ * @brief Parse "rr", "rr:Q" or "time"
+ *
+ * @return false if the text is none of them
+ */
+
+inline bool parseInterleave(const char *text,
+                            InterleaveSpec &spec)
+{
+    spec = InterleaveSpec{false, 1};                    // One reference per turn
+    if (std::strcmp(text, "time") == 0) {               // If the traces share a timeline
+        spec.byTime = true;                             // Merge by position in each trace
+        return true;                                    // The text is valid
+    }                                                   // End if statement
+
+    if (std::strncmp(text, "rr", 2) != 0)               // If it is not round-robin either
+        return false;                                   // The text is invalid
+    if (text[2] == '\0')                                // If no quantum was given
+        return true;                                    // Keep one reference per turn
+    if (text[2] != ':')                                 // If something else follows
+        return false;                                   // The text is invalid
+
+    char *end;                                          // End of the quantum
+    long quantum = std::strtol(text + 3, &end, 10);     // References per turn
+    spec.quantum = (int) quantum;                       // Use it
+    return end != text + 3 && *end == '\0' && quantum >= 1 && quantum <= 1000000000;  // It must be a positive number
+}                                                       // End of function parseInterleave
+
+/**
+ * @brief Merge every process's references into one stream of global page IDs
+ *
+ * Processes have private address spaces, so process p's page IDs are
+ * offset past every earlier process's pages and no two processes share
+ * a page. Round-robin gives each process quantum references per turn;
+ * "time" places the k-th of a process's n references at (k + 1/2) / n on
+ * a common timeline, so every process runs at a steady rate and they
+ * all finish together.
+ *
+ * @param traces   One trace per process
+ * @param spec     Interleaving
+ * @param combined Receives the merged global page IDs
+ * @param owner    Receives the process behind each merged reference
+ */
+
+inline void interleaveTraces(const std::vector<SweepTrace> &traces,
+                             const InterleaveSpec &spec,
+                             std::vector<int> &combined,
+                             std::vector<uint16_t> &owner)
+{
+    int processes = (int) traces.size();                // Number of processes
+    std::vector<int> base(processes);                   // First global ID of each process
+    std::vector<size_t> cursor(processes, 0);           // Next reference of each process
+    size_t total = 0;                                   // References in every trace
+
+    for (int p = 0, next = 0; p < processes; p++) {     // For every process
+        base[p] = next;                                 // Its pages follow the previous process's
+        next += traces[p].pages.size();                 // Reserve an ID per distinct page
+        total += traces[p].refs.size();                 // Count its references
+    }                                                   // End for loop
+
+    combined.clear();                                   // Start with an empty stream
+    owner.clear();
+    combined.reserve(total);                            // One entry per reference
+    owner.reserve(total);
+
+    auto emit = [&](int p, size_t count) {              // Append process p's next count references
+        const std::vector<int> &refs = traces[p].refs;  // Its trace
+        for (size_t end = cursor[p] + count; cursor[p] < end; cursor[p]++) {  // For each of them
+            combined.push_back(base[p] + refs[cursor[p]]);  // Its global page ID
+            owner.push_back((uint16_t) p);              // And who issued it
+        }                                               // End for loop
+    };
+
+    if (!spec.byTime) {                                 // If the processes take turns
+        while (combined.size() < total)                 // Until every reference is placed
+            for (int p = 0; p < processes; p++)         // Each process in turn
+                emit(p, std::min((size_t) spec.quantum, traces[p].refs.size() - cursor[p]));  // Up to a quantum
+        return;                                         // The stream is complete
+    }                                                   // End if statement
+
+    typedef std::pair<double, int> Event;               // (time of the next reference, process)
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> due;  // Earliest first, lowest process on ties
+    for (int p = 0; p < processes; p++)                 // For every process
+        if (!traces[p].refs.empty())                    // With anything to issue
+            due.push(Event{0.5 / traces[p].refs.size(), p});  // Its first reference
+
+    while (!due.empty()) {                              // Until every process is done
+        int p = due.top().second;                       // Process with the earliest reference
+        due.pop();                                      // Take it
+        emit(p, 1);                                     // Issue it
+        size_t n = traces[p].refs.size();               // Length of its trace
+        if (cursor[p] < n)                              // If it has more
+            due.push(Event{(cursor[p] + 0.5) / n, p});  // Schedule the next one
+    }                                                   // End while loop
+}                                                       // End of function interleaveTraces
+
+/**
+ * @brief Split frames between processes, at least one each
+ *
+ * Fixed gives every process the same share; proportional gives each a
+ * share of the frames beyond the first per process in proportion to
+ * its distinct pages (its virtual size). Leftover frames go to the
+ * largest remainders.
+ *
+ * @param traces       One trace per process
+ * @param frames       Frames in the pool; at least one per process
+ * @param proportional Whether to weight by distinct pages
+ *
+ * @return Frames for each process
+ */
+
+inline std::vector<int> partitionFrames(const std::vector<SweepTrace> &traces,
+                                        int frames,
+                                        bool proportional)
+{
+    int processes = (int) traces.size();                // Number of processes
+    std::vector<long long> weight(processes, 1);        // Equal shares unless proportional
+    long long totalWeight = 0;                          // Sum of the weights
+
+    for (int p = 0; p < processes; p++) {               // For every process
+        if (proportional)                               // If shares follow size
+            weight[p] = traces[p].pages.size();         // Weigh it by its distinct pages
+        totalWeight += weight[p];                       // Add it to the total
+    }                                                   // End for loop
+    if (totalWeight == 0)                               // If every trace is empty
+        totalWeight = 1;                                // Avoid dividing by zero
+
+    long long spare = frames - processes;               // Frames beyond the first per process
+    std::vector<int> share(processes, 1);               // Everybody gets one
+    std::vector<std::pair<long long, int>> remainders;  // (remainder, -process) for the leftovers
+    long long given = 0;                                // Spare frames handed out so far
+
+    for (int p = 0; p < processes; p++) {               // For every process
+        long long exact = spare * weight[p];            // Its share, scaled by totalWeight
+        share[p] += (int) (exact / totalWeight);        // Whole frames
+        given += exact / totalWeight;                   // Count them
+        remainders.push_back({exact % totalWeight, -p});  // Lowest process first on ties
+    }                                                   // End for loop
+
+    std::sort(remainders.rbegin(), remainders.rend());  // Largest remainder first
+    for (int i = 0; given < spare; i++, given++)        // Until every frame is handed out
+        share[-remainders[i].second]++;                 // One more for the next largest remainder
+
+    return share;                                       // Return the split
+}                                                       // End of function partitionFrames
+
+/**
+ * @brief Simulate processes that compete for one pool of frames
+ *
+ * Each argument after the options is one process's trace. Under global
+ * replacement the traces are interleaved into one stream of
+ * process-private page IDs and run through a single engine over the
+ * whole pool, so any frame can go to any process; faults are charged
+ * to the process whose reference missed. Partitioned replacement gives
+ * each process its own frames (equal or proportional shares) and its
+ * own engine, so the interleaving cannot change the result and the
+ * processes run in parallel on the pool.
+ *
+ * @param argc  Argument count from main
+ * @param argv  Arguments from main
+ * @param first Index of the first argument after --shared
+ *
+ * @return Exit status for main
+ */
+
+inline int runShared(int argc,
+                     char *argv[],
+                     int first)
+{
+    const PolicyEntry *policy = findPolicy("lru");      // Policy every allocation runs
+    std::vector<std::string> allocations = {"global", "fixed", "proportional"};  // Allocations to compare
+    InterleaveSpec interleave{false, 1};                // Round-robin, one reference per turn
+    std::vector<SweepTrace> traces;                     // One trace per process
+    int frames = 0;                                     // Frames in the pool; 0 means the sum of the headers
+    uint64_t pageSize = 1;                              // Bytes per page if references are addresses
+    int threads = 0;                                    // Worker threads; 0 means one per hardware thread
+    bool usage = false;                                 // Whether the command line is bad
+
+    for (int i = first; i < argc; i++) {                // Walk the rest of the command line
+        bool more = i + 1 < argc;                       // Whether a value follows
+        if (std::strcmp(argv[i], "--policy") == 0 && more) {  // If a policy was named
+            policy = findPolicy(argv[++i]);             // Look it up
+            usage = usage || policy == nullptr;         // It must exist
+        } else if (std::strcmp(argv[i], "--allocation") == 0 && more) {  // If allocations were listed
+            std::string list = std::string(argv[++i]) + ",";  // Every name ends in a comma
+            allocations.clear();                        // Replace the defaults
+            for (size_t start = 0, comma; (comma = list.find(',', start)) != std::string::npos; start = comma + 1) {
+                std::string name = list.substr(start, comma - start);  // The next name
+                usage = usage || (name != "global" && name != "fixed" && name != "proportional");  // It must be known
+                allocations.push_back(name);            // Run it
+            }                                           // End for loop
+        } else if (std::strcmp(argv[i], "--interleave") == 0 && more) {  // If an interleaving was named
+            usage = !parseInterleave(argv[++i], interleave) || usage;  // Use it, or reject the command line
+        } else if (std::strcmp(argv[i], "--frames") == 0 && more) {  // If the pool size was given
+            frames = std::atoi(argv[++i]);              // Use it
+            usage = usage || frames < 1;                // It must hold something
+        } else if (std::strcmp(argv[i], "--page-size") == 0 && more) {  // If references are addresses
+            pageSize = std::strtoull(argv[++i], nullptr, 0);  // Divide them by this
+            usage = usage || pageSize == 0;             // A page must hold something
+        } else if (std::strcmp(argv[i], "--threads") == 0 && more) {  // If a thread count was given
+            threads = std::atoi(argv[++i]);             // Use it
+        } else {                                        // Else it is a process's trace
+            traces.push_back(SweepTrace{argv[i], TraceHeader{}, {}, {}, {}});  // Queue it for loading
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    if (traces.empty() || usage) {                      // If there is nothing to run
+        std::cerr << "Usage: " << argv[0] << " --shared [--policy lru] [--allocation global,fixed,proportional]\n" <<
+            "       [--interleave rr[:Q] | time] [--frames N] [--page-size <bytes>] [--threads N] <trace>...\n";  // Display the usage message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (policy->make == nullptr || std::strcmp(policy->name, "opt-window") == 0) {  // If faults cannot be charged as they happen
+        std::cerr << policy->label << " cannot run on a shared pool.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if ((int) traces.size() > MAX_PROCESSES) {          // If the owner tags would overflow
+        std::cerr << "At most " << MAX_PROCESSES << " processes are supported.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    WorkStealingPool pool(threads);                     // Workers for loading and partitions
+    for (SweepTrace &trace : traces)                    // For every process
+        pool.submit([&trace, pageSize] {                // Parse its trace once
+            trace.loaded = readTrace(trace.filename, trace.header, trace.refs, trace.pages, pageSize);
+        });
+    pool.wait();                                        // Every trace must be loaded
+
+    for (const SweepTrace &trace : traces)              // Only now, with every worker idle
+        if (!trace.loaded)                              // If a trace could not be read
+            return 1;                                   // Return 1 which indicates error; the reason has been printed
+
+    long long distinct = 0;                             // Pages over every process
+    if (frames == 0) {                                  // If no pool size was given
+        long long total = 0;                            // Sum the frames each trace asks for
+        for (const SweepTrace &trace : traces) {        // For every process
+            if (trace.header.frameCount < 1) {          // If its header asks for no frames
+                std::cerr << "Frame count must be at least 1.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+            total += trace.header.frameCount;           // Add its request
+        }                                               // End for loop
+        if (total > 2147483647LL) {                     // If the pool would not fit an int
+            std::cerr << "Too many frames across the processes.\n";  // Print error message
+            return 1;                                   // Return 1 which indicates error
+        }                                               // End if statement
+        frames = (int) total;                           // Pool of every request
+    }                                                   // End if statement
+    for (const SweepTrace &trace : traces)              // For every process
+        distinct += trace.pages.size();                 // Count its pages
+
+    if (distinct > 2147483647LL) {                      // If global IDs would not fit
+        std::cerr << "Too many distinct pages across the processes.\n";  // Print error message
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    std::cout << "allocation,process,trace,references,frames,faults,fault_ratio\n";  // CSV header
+
+    for (const std::string &allocation : allocations) { // For every allocation
+        int processes = (int) traces.size();            // Number of processes
+        std::vector<long long> faults(processes, 0);    // Faults charged to each process
+        std::vector<int> share(processes, frames);      // Frames each process may use
+
+        if (allocation == "global") {                   // If any frame can go to any process
+            std::vector<int> combined;                  // One stream of global page IDs
+            std::vector<uint16_t> owner;                // Process behind each reference
+            interleaveTraces(traces, interleave, combined, owner);  // Merge the traces
+
+            std::unique_ptr<Engine> engine = policy->make(frames);  // One engine over the whole pool
+            if (policy->wholeTrace)                     // If the policy looks ahead
+                engine->prepare(combined.data(), (int) combined.size());  // Show it the merged stream
+
+            for (size_t i = 0, n = combined.size(); i < n;) {  // Walk the stream a turn at a time
+                size_t end = i;                         // End of this process's turn
+                while (end < n && owner[end] == owner[i])  // While the same process is issuing
+                    end++;                              // Extend the turn
+                long long before = engine->pageFaults();  // Faults before the turn
+                engine->run(combined.data() + i, (int) (end - i));  // Simulate it
+                faults[owner[i]] += engine->pageFaults() - before;  // Charge its faults to the process
+                i = end;                                // Next turn
+            }                                           // End for loop
+        } else if (frames < processes) {                // Else every partition needs a frame
+            std::cerr << "A partitioned pool needs at least one frame per process.\n";  // Print error message
+            return 1;                                   // Return 1 which indicates error
+        } else {                                        // Else each process runs alone in its share
+            share = partitionFrames(traces, frames, allocation == "proportional");  // Split the frames
+            for (int p = 0; p < processes; p++)         // For every process
+                pool.submit([&, p] {                    // Run it on the pool
+                    faults[p] = policy->run(share[p], traces[p].refs.data(), (int) traces[p].refs.size(), nullptr);
+                });
+            pool.wait();                                // Every partition must finish
+        }                                               // End if statement
+
+        long long references = 0, total = 0;            // Totals over every process
+        for (int p = 0; p < processes; p++) {           // For every process
+            long long refs = traces[p].refs.size();     // Its references
+            references += refs;                         // Add them to the totals
+            total += faults[p];
+            std::cout << allocation << "," << p << "," << traces[p].filename << "," << refs << "," <<  // Display its row
+                (allocation == "global" ? std::string("shared") : std::to_string(share[p])) << "," <<
+                faults[p] << "," << (refs > 0 ? (double) faults[p] / refs : 0) << "\n";
+        }                                               // End for loop
+
+        std::cout << allocation << ",total,," << references << "," << frames << "," << total << "," <<  // Display the totals
+            (references > 0 ? (double) total / references : 0) << "\n";
+    }                                                   // End for loop
+
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function runShared
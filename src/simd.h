@@ -0,0 +1,158 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PAGER_X86 1
+#endif
+
+/**
+ * @brief Result of one pass over the frames
+ */
+
+struct FrameScan {
+    int position;                                       // Frame holding the page, or -1
+    int freeIndex;                                      // First empty frame, or -1 (only filled in when position is -1)
+};
+
+typedef FrameScan (*ScanKernel)(const int frames[], int frameCount, int page);
+
+/**
+ * @brief Find page and the first empty frame, one frame at a time
+ *
+ * @param frames     The frames to search (-1 is empty)
+ * @param frameCount Number of frames that can be used
+ * @param page       The page to find
+ *
+ * @return Where the page is, and where the first empty frame is if it is absent
+ */
+
+inline FrameScan scanFramesScalar(const int frames[],
+                                  int frameCount,
+                                  int page)
+{
+    int freeIndex = -1;                                 // First empty frame seen so far
+
+    for (int i = 0; i < frameCount; i++) {              // For every frame
+        if (frames[i] == page)                          // If the page is found
+            return FrameScan{i, freeIndex};             // Return its index
+        if (frames[i] == -1 && freeIndex == -1)         // If this is the first empty frame
+            freeIndex = i;                              // Remember it
+    }                                                   // End for loop
+
+    return FrameScan{-1, freeIndex};                    // The page is not resident
+}                                                       // End of function scanFramesScalar
+
+#ifdef PAGER_X86
+
+/**
+ * @brief scanFramesScalar comparing four frames per step with SSE2
+ *
+ * Compares a block of frames against the page and against -1 at once,
+ * and turns each comparison into a bit mask whose lowest set bit is the
+ * first matching frame.
+ */
+
+inline FrameScan scanFramesSse2(const int frames[],
+                                int frameCount,
+                                int page)
+{
+    const __m128i key = _mm_set1_epi32(page);           // The page in every lane
+    const __m128i empty = _mm_set1_epi32(-1);           // -1 in every lane
+    int freeIndex = -1;                                 // First empty frame seen so far
+    int i = 0;                                          // Start of the current block
+
+    for (; i + 4 <= frameCount; i += 4) {               // For every full block of four
+        __m128i block = _mm_loadu_si128((const __m128i *) (frames + i));  // Load four frames
+        int hit = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, key)));  // Lanes holding the page
+        if (hit)                                        // If the page is in this block
+            return FrameScan{i + __builtin_ctz(hit), freeIndex};  // Return the first such frame
+        if (freeIndex == -1) {                          // If no empty frame has been seen
+            int open = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, empty)));  // Empty lanes
+            if (open)                                   // If there is one
+                freeIndex = i + __builtin_ctz(open);    // Remember the first
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    for (; i < frameCount; i++) {                       // For the frames left over
+        if (frames[i] == page)                          // If the page is found
+            return FrameScan{i, freeIndex};             // Return its index
+        if (frames[i] == -1 && freeIndex == -1)         // If this is the first empty frame
+            freeIndex = i;                              // Remember it
+    }                                                   // End for loop
+
+    return FrameScan{-1, freeIndex};                    // The page is not resident
+}                                                       // End of function scanFramesSse2
+
+/**
+ * @brief scanFramesSse2 widened to eight frames per step with AVX2
+ *
+ * Compiled for AVX2 through a target attribute so the rest of the
+ * program stays baseline x86-64; only call it when the CPU has AVX2.
+ */
+
+__attribute__((target("avx2")))
+inline FrameScan scanFramesAvx2(const int frames[],
+                                int frameCount,
+                                int page)
+{
+    const __m256i key = _mm256_set1_epi32(page);        // The page in every lane
+    const __m256i empty = _mm256_set1_epi32(-1);        // -1 in every lane
+    int freeIndex = -1;                                 // First empty frame seen so far
+    int i = 0;                                          // Start of the current block
+
+    for (; i + 8 <= frameCount; i += 8) {               // For every full block of eight
+        __m256i block = _mm256_loadu_si256((const __m256i *) (frames + i));  // Load eight frames
+        int hit = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(block, key)));  // Lanes holding the page
+        if (hit)                                        // If the page is in this block
+            return FrameScan{i + __builtin_ctz(hit), freeIndex};  // Return the first such frame
+        if (freeIndex == -1) {                          // If no empty frame has been seen
+            int open = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(block, empty)));  // Empty lanes
+            if (open)                                   // If there is one
+                freeIndex = i + __builtin_ctz(open);    // Remember the first
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    for (; i < frameCount; i++) {                       // For the frames left over
+        if (frames[i] == page)                          // If the page is found
+            return FrameScan{i, freeIndex};             // Return its index
+        if (frames[i] == -1 && freeIndex == -1)         // If this is the first empty frame
+            freeIndex = i;                              // Remember it
+    }                                                   // End for loop
+
+    return FrameScan{-1, freeIndex};                    // The page is not resident
+}                                                       // End of function scanFramesAvx2
+
+#endif
+
+/**
+ * @brief Whether the CPU running us supports AVX2
+ */
+
+inline bool cpuHasAvx2()
+{
+#ifdef PAGER_X86
+    return __builtin_cpu_supports("avx2");              // Ask the CPU
+#else
+    return false;                                       // No x86 vector kernels here
+#endif
+}                                                       // End of function cpuHasAvx2
+
+/**
+ * @brief The fastest scan kernel this CPU supports, chosen on first use
+ *
+ * @param name Receives the kernel's name, if not nullptr
+ */
+
+inline ScanKernel scanKernel(const char **name = nullptr)
+{
+#ifdef PAGER_X86
+    static const bool avx2 = cpuHasAvx2();              // Checked once
+    if (name != nullptr)                                // If the caller wants the name
+        *name = avx2 ? "avx2" : "sse2";                 // Report it
+    return avx2 ? scanFramesAvx2 : scanFramesSse2;      // SSE2 is always present on x86-64
+#else
+    if (name != nullptr)                                // If the caller wants the name
+        *name = "scalar";                               // Report it
+    return scanFramesScalar;                            // Portable fallback
+#endif
+}                                                       // End of function scanKernel
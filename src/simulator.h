@@ -0,0 +1,309 @@
+#pragma once
+
+#include <vector>
+
+#include "history.h"
+#include "policy.h"
+
+/**
+ * @brief What a prefetching Simulator's speculative loads came to
+ */
+
+struct PrefetchStats {
+    long long issued;                                   // Pages loaded ahead of demand
+    long long useful;                                   // Referenced while still resident
+    long long wasted;                                   // Evicted before any reference
+    long long evictions;                                // Resident pages the loads displaced
+};
+
+/**
+ * @brief Demand-paging simulation core shared by every replacement policy
+ *
+ * Owns the frames and the page-to-frame index, and runs the loop that
+ * FIFO(), LRU() and OPT() in main.cpp each spell out by hand: look the
+ * page up, fill the first empty frame or ask the policy for a victim,
+ * and record the changed frame on a fault. The policy is a template
+ * parameter, so each one is compiled into its own loop with its hooks
+ * inlined. Pages are dense IDs from a PageInterner, so the index is a
+ * flat array rather than a hash table. Every frame has a dirty bit,
+ * set by a write and cleared when the frame is refilled; replacing a
+ * dirty frame counts as a write-back. Hits only touch it on writes.
+ *
+ * @tparam Policy Replacement policy (see policy.h)
+ * @tparam Record   Whether faults are written to a FaultHistory
+ * @tparam Prefetch Whether prefetch() may load pages ahead of demand;
+ *                  without it the loop carries none of the bookkeeping
+ */
+
+template <class Policy, bool Record, bool Prefetch = false>
+class Simulator {
+public:
+    std::vector<int> frames;                            // frames[i] = page in frame i, or -1 if empty
+    long long pageFaults;                               // Number of page faults so far
+    long long writeBacks;                               // Dirty pages replaced so far
+    long long time;                                     // Index of the next reference in the trace
+    int evicted;                                        // Page the latest fault replaced, or -1
+    bool firstUse;                                      // Whether the latest hit was on a prefetched page (Prefetch only)
+    PrefetchStats prefetched;                           // Speculative loads so far (Prefetch only)
+    Policy policy;                                      // Victim selection
+
+    /**
+     * @brief Reset to frameCount empty frames
+     *
+     * @param frameCount Number of frames that can be used
+     * @param recordTo   History that receives each fault (Record only)
+     */
+
+    void init(int frameCount, FaultHistory *recordTo = nullptr) {
+        frames.assign(frameCount, -1);                  // Set every frame to -1 (empty)
+        slotOf.clear();                                 // No page is resident; grows with the page IDs
+        filled = 0;                                     // Frames fill in index order
+        pageFaults = 0;                                 // No page faults yet
+        writeBacks = 0;                                 // No dirty page replaced yet
+        dirty.assign(frameCount, 0);                    // Every frame is clean
+        time = 0;                                       // Start of the trace
+        evicted = -1;                                   // Nothing replaced yet
+        firstUse = false;                               // No prefetched page used yet
+        prefetched = PrefetchStats{0, 0, 0, 0};         // Nothing prefetched yet
+        if (Prefetch)                                   // If pages can be loaded speculatively
+            speculative.assign(frameCount, 0);          // None is
+        history = recordTo;                             // Where faults are recorded
+        policy.init(frameCount);                        // Reset the policy
+    }                                                   // End of function init
+
+    /**
+     * @brief Let the policy see the whole trace before it runs (OPT)
+     */
+
+    void prepare(const int refs[], int refCount) {
+        policy.prepare(refs, refCount);                 // Forward to the policy
+    }                                                   // End of function prepare
+
+    /**
+     * @brief Reference page at the current time
+     *
+     * @return true if the reference was a page fault
+     */
+
+    bool access(int page) {
+        long long t = time++;                           // Time of this reference
+        if (page >= (int) slotOf.size())                // If the page ID is new
+            slotOf.resize(page + 1, -1);                // Extend the index to cover it
+        int slot = slotOf[page];                        // Find the frame holding the page
+
+        if (slot != -1) {                               // If the page is resident
+            policy.onHit(slot, t);                      // Let the policy note the use
+            if (Prefetch) {                             // If it may have been loaded speculatively
+                firstUse = speculative[slot];           // This is its first use if it was
+                prefetched.useful += firstUse;          // Then the prefetch paid off
+                speculative[slot] = 0;                  // It is an ordinary page from now on
+            }                                           // End if statement
+            return false;                               // This was a hit
+        }                                               // End if statement
+
+        pageFaults++;                                   // Increment page faults
+        evicted = -1;                                   // Nothing replaced yet
+
+        if (filled < (int) frames.size()) {             // If there is an empty frame
+            slot = filled++;                            // Use the first empty frame
+        } else {                                        // Else the policy picks a victim
+            slot = policy.victim(page, t);              // Frame to replace
+            evicted = frames[slot];                     // Remember it for the caller
+            slotOf[evicted] = -1;                       // The victim is no longer resident
+        }                                               // End if statement
+
+        writeBacks += dirty[slot];                      // A dirty victim is written back first
+        dirty[slot] = 0;                                // The new page arrives clean
+
+        if (Prefetch) {                                 // If the victim may have been speculative
+            firstUse = false;                           // A fault is not a prefetched page's use
+            prefetched.wasted += speculative[slot];     // It was never referenced
+            speculative[slot] = 0;                      // The demanded page is not speculative
+        }                                               // End if statement
+
+        frames[slot] = page;                            // Set the frame to the current page
+        slotOf[page] = slot;                            // Remember where the page lives
+        policy.onMiss(slot, page, t);                   // Let the policy note the load
+
+        if (Record)                                     // If faults are being recorded
+            history->record(t, slot, page);             // Note which frame changed
+
+        return true;                                    // This was a page fault
+    }                                                   // End of function access
+
+    /**
+     * @brief Reference page at the current time, as a read or a write
+     *
+     * @return true if the reference was a page fault
+     */
+
+    bool access(int page, bool write) {
+        bool fault = access(page);                      // Find or load the page
+        if (write) {                                    // If the reference writes
+            int slot = slotOf[page];                    // Frame now holding the page
+            dirty[slot] = 1;                            // It must be written back when replaced
+            policy.onWrite(slot);                       // Let the policy note it
+        }                                               // End if statement
+        return fault;                                   // Report the fault
+    }                                                   // End of function access
+
+    /**
+     * @brief Load page ahead of demand, alongside the latest reference (Prefetch only)
+     *
+     * The load takes an empty frame or the policy's victim like a fault
+     * does, but is not counted as one; the page stays speculative until
+     * it is referenced (useful) or evicted first (wasted).
+     *
+     * @return false if the page was already resident
+     */
+
+    bool prefetch(int page) {
+        static_assert(Prefetch, "prefetch needs a Simulator with Prefetch set");
+        long long t = time - 1;                         // Time of the reference that triggered it
+        if (page >= (int) slotOf.size())                // If the page ID is new
+            slotOf.resize(page + 1, -1);                // Extend the index to cover it
+        if (slotOf[page] != -1)                         // If the page is resident
+            return false;                               // There is nothing to load
+
+        int slot;                                       // Frame to load it into
+        if (filled < (int) frames.size()) {             // If there is an empty frame
+            slot = filled++;                            // Use the first empty frame
+        } else {                                        // Else the policy picks a victim
+            slot = policy.victim(page, t);              // Frame to replace
+            slotOf[frames[slot]] = -1;                  // The victim is no longer resident
+            prefetched.evictions++;                     // The prefetch cost a resident page
+            prefetched.wasted += speculative[slot];     // Which may itself have been prefetched in vain
+            writeBacks += dirty[slot];                  // Or dirty
+            dirty[slot] = 0;
+        }                                               // End if statement
+
+        frames[slot] = page;                            // Set the frame to the prefetched page
+        slotOf[page] = slot;                            // Remember where the page lives
+        policy.onMiss(slot, page, t);                   // Let the policy note the load
+        speculative[slot] = 1;                          // Not referenced yet
+        prefetched.issued++;                            // Count the load
+        return true;                                    // The page was loaded
+    }                                                   // End of function prefetch
+
+    /**
+     * @brief Feed the next chunk of references through the simulator
+     */
+
+    void run(const int refs[], int count) {
+        for (int i = 0; i < count; i++)                 // For every reference in the chunk
+            access(refs[i]);                            // Reference the page
+    }                                                   // End of function run
+
+    /**
+     * @brief Checkpoint the frames, counters and policy (see checkpoint.h)
+     */
+
+    template <class Archive>
+    void persist(Archive &ar) {
+        ar(frames, pageFaults, writeBacks, time, slotOf, dirty, filled, policy);  // Everything a plain run needs
+        if constexpr (Prefetch)                         // If pages can be speculative
+            ar(prefetched, speculative);                // Which ones, and the tally
+    }                                                   // End of function persist
+
+private:
+    std::vector<int> slotOf;                            // slotOf[id] = frame holding page id, or -1
+    std::vector<char> dirty;                            // dirty[i] = frame i was written since it was filled
+    std::vector<char> speculative;                      // speculative[i] = frame i was prefetched and not yet used (Prefetch only)
+    int filled;                                         // Frames that hold a page
+    FaultHistory *history;                              // History written on faults
+};
+
+/**
+ * @brief Run a whole trace under Policy
+ *
+ * @param frameCount Number of frames that can be used
+ * @param refs[]     Array of page references from the input
+ * @param refCount   Number of page references in the input
+ * @param history    History that receives each fault, or nullptr to skip it
+ *
+ * @return Number of page faults that occurred
+ */
+
+template <class Policy>
+int simulate(int frameCount,
+             const int refs[],
+             int refCount,
+             FaultHistory *history)
+{
+    if (history != nullptr) {                           // If the history is wanted
+        Simulator<Policy, true> sim;                    // Recording instantiation
+        sim.init(frameCount, history);                  // Start with empty frames
+        sim.prepare(refs, refCount);                    // Let the policy look ahead
+        sim.run(refs, refCount);                        // Run every reference
+        return (int) sim.pageFaults;                    // Return the number of page faults
+    }                                                   // End if statement
+
+    Simulator<Policy, false> sim;                       // Counting-only instantiation
+    sim.init(frameCount);                               // Start with empty frames
+    sim.prepare(refs, refCount);                        // Let the policy look ahead
+    sim.run(refs, refCount);                            // Run every reference
+    return (int) sim.pageFaults;                        // Return the number of page faults
+}                                                       // End of function simulate
+
+/**
+ * @brief Feed references to a windowed OPT simulator as they arrive
+ *
+ * Each reference joins the lookahead window first; the oldest one is
+ * simulated once the window behind it is full, so the simulator lags
+ * the input by the window size until drainLookahead catches it up.
+ * Write flags, if given, wait in the window with their references.
+ */
+
+template <bool Record>
+void runLookahead(Simulator<WindowedOptPolicy, Record> &sim,
+                  const int refs[],
+                  int count,
+                  const char writes[] = nullptr)
+{
+    for (int i = 0; i < count; i++) {                   // For every arriving reference
+        sim.policy.observe(refs[i], writes != nullptr && writes[i]);  // Add it to the window
+        if (sim.policy.full()) {                        // If the oldest reference now sees a full window
+            sim.access(sim.policy.oldest(), sim.policy.oldestWrites());  // Simulate it
+            sim.policy.retire();                        // And drop it from the window
+        }                                               // End if statement
+    }                                                   // End for loop
+}                                                       // End of function runLookahead
+
+/**
+ * @brief The input has ended; simulate every reference still in the window
+ */
+
+template <bool Record>
+void drainLookahead(Simulator<WindowedOptPolicy, Record> &sim)
+{
+    while (sim.policy.pending()) {                      // Until the window is empty
+        sim.access(sim.policy.oldest(), sim.policy.oldestWrites());  // Simulate the oldest reference
+        sim.policy.retire();                            // And drop it from the window
+    }                                                   // End while loop
+}                                                       // End of function drainLookahead
+
+/**
+ * @brief Run a whole trace under OPT limited to WindowedOptPolicy::lookahead
+ *
+ * Same contract as simulate; the trace is fed in as if it were streamed.
+ */
+
+inline int simulateLookahead(int frameCount,
+                             const int refs[],
+                             int refCount,
+                             FaultHistory *history)
+{
+    if (history != nullptr) {                           // If the history is wanted
+        Simulator<WindowedOptPolicy, true> sim;         // Recording instantiation
+        sim.init(frameCount, history);                  // Start with empty frames
+        runLookahead(sim, refs, refCount);              // Stream every reference
+        drainLookahead(sim);                            // Then the ones left in the window
+        return (int) sim.pageFaults;                    // Return the number of page faults
+    }                                                   // End if statement
+
+    Simulator<WindowedOptPolicy, false> sim;            // Counting-only instantiation
+    sim.init(frameCount);                               // Start with empty frames
+    runLookahead(sim, refs, refCount);                  // Stream every reference
+    drainLookahead(sim);                                // Then the ones left in the window
+    return (int) sim.pageFaults;                        // Return the number of page faults
+}                                                       // End of function simulateLookahead
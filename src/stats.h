@@ -0,0 +1,312 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && !defined(PAGER_NO_COUNTERS)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PAGER_COUNTERS 1
+#endif
+
+/*
+ * Instrumentation for --stats.
+ *
+ * Each phase of a run (parse, simulate, render) is timed, and on Linux
+ * also counted with perf_event_open: cycles, instructions, cache misses
+ * and branch misses of the calling thread, in user space. Counters that
+ * the kernel refuses (no PMU in a VM, perf_event_paranoid, seccomp) are
+ * reported as missing and the timers still work. Building with
+ * -DPAGER_NO_COUNTERS, or on another OS, leaves PerfCounters empty, so
+ * every call into it compiles to nothing. Phases are timed per chunk or
+ * per run, never per reference, so a run without --stats pays one
+ * branch per phase.
+ */
+
+const int COUNTER_COUNT = 4;                            // Hardware events counted per phase
+const char *const COUNTER_NAMES[COUNTER_COUNT] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+
+/**
+ * @brief The calling thread's hardware counters, read around a phase
+ */
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        for (int k = 0; k < COUNTER_COUNT; k++)         // No counter is open
+            fds[k] = -1;
+        why = "counters not compiled in";               // Until open says otherwise
+    }                                                   // End constructor
+
+    ~PerfCounters() {
+#ifdef PAGER_COUNTERS
+        for (int k = 0; k < COUNTER_COUNT; k++)         // For every counter
+            if (fds[k] != -1)                           // That opened
+                close(fds[k]);                          // Release it
+#endif
+    }                                                   // End destructor
+
+    PerfCounters(const PerfCounters &) = delete;        // Owns file descriptors
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /**
+     * @brief Open every counter the kernel allows for the calling thread
+     *
+     * @return false if none could be opened; reason() says why
+     */
+
+    bool open() {
+#ifdef PAGER_COUNTERS
+        const uint64_t configs[COUNTER_COUNT] = {       // Events in COUNTER_NAMES order
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        int error = 0;                                  // errno of the last refusal
+
+        for (int k = 0; k < COUNTER_COUNT; k++) {       // For every event
+            perf_event_attr attr;                       // What to count
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;             // A generic hardware event
+            attr.config = configs[k];
+            attr.disabled = 1;                          // Counting starts in start()
+            attr.exclude_kernel = 1;                    // User space only, which paranoid levels allow
+            attr.exclude_hv = 1;
+            fds[k] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);  // This thread, any CPU
+            if (fds[k] == -1)                           // If the kernel refused
+                error = errno;                          // Remember why
+        }                                               // End for loop
+
+        if (available())                                // If anything opened
+            return true;                                // Count with it
+        why = error == EACCES || error == EPERM ? "perf_event_open not permitted" :  // Explain the refusal
+              error == ENOENT || error == EOPNOTSUPP ? "no hardware counters" :
+              error == ENOSYS ? "perf_event_open not supported" : "perf_event_open failed";
+#endif
+        return false;                                   // Only the timers will run
+    }                                                   // End of function open
+
+    /**
+     * @brief Zero and start every open counter
+     */
+
+    void start() {
+#ifdef PAGER_COUNTERS
+        for (int k = 0; k < COUNTER_COUNT; k++)         // For every counter
+            if (fds[k] != -1) {                         // That opened
+                ioctl(fds[k], PERF_EVENT_IOC_RESET, 0); // Zero it
+                ioctl(fds[k], PERF_EVENT_IOC_ENABLE, 0);  // And start it
+            }                                           // End if statement
+#endif
+    }                                                   // End of function start
+
+    /**
+     * @brief Stop every open counter and add what it counted to counts
+     *
+     * @param counted Set for every counter that was read
+     */
+
+    void stop(uint64_t counts[COUNTER_COUNT], bool counted[COUNTER_COUNT]) {
+#ifdef PAGER_COUNTERS
+        for (int k = 0; k < COUNTER_COUNT; k++) {       // For every counter
+            uint64_t value;                             // Events since start
+            if (fds[k] == -1)                           // If it never opened
+                continue;                               // There is nothing to read
+            ioctl(fds[k], PERF_EVENT_IOC_DISABLE, 0);   // Stop it
+            if (read(fds[k], &value, sizeof(value)) == (ssize_t) sizeof(value)) {  // If it can be read
+                counts[k] += value;                     // Accumulate it
+                counted[k] = true;
+            }                                           // End if statement
+        }                                               // End for loop
+#else
+        (void) counts;                                  // Nothing was counted
+        (void) counted;
+#endif
+    }                                                   // End of function stop
+
+    bool available() const {                            // Whether any counter is open
+        for (int k = 0; k < COUNTER_COUNT; k++)
+            if (fds[k] != -1)
+                return true;
+        return false;
+    }                                                   // End of function available
+
+    const char *reason() const { return why; }          // Why no counter is open
+
+private:
+    int fds[COUNTER_COUNT];                             // One descriptor per event, or -1
+    const char *why;                                    // Why no counter is open
+};
+
+/**
+ * @brief Totals for one (engine, phase) pair
+ */
+
+struct PhaseRecord {
+    std::string engine;                                 // Policy label, or empty for phases outside an engine
+    std::string phase;                                  // "parse", "simulate", "render", ...
+    double ns;                                          // Wall time
+    long long references;                               // References the phase handled
+    uint64_t counts[COUNTER_COUNT];                     // Events, in COUNTER_NAMES order
+    bool counted[COUNTER_COUNT];                        // Whether each event was read
+};
+
+/**
+ * @brief Collects phase timings and counters for --stats
+ *
+ * One instance belongs to one thread, since the counters follow the
+ * thread that opened them; a pool task uses its own and its records are
+ * added to the main one afterwards.
+ */
+
+class Instrumentation {
+public:
+    Instrumentation() : enabled(false) {}
+
+    /**
+     * @brief Turn collection on for the calling thread
+     *
+     * @param quiet Whether to skip the note when no counter can be opened
+     */
+
+    void enable(bool quiet = false) {
+        enabled = true;                                 // Phases are recorded from now on
+        if (!counters.open() && !quiet)                 // If only time can be measured
+            std::cerr << "Hardware counters unavailable (" << counters.reason() << "); timing only.\n";  // Say why
+    }                                                   // End of function enable
+
+    bool on() const { return enabled; }                 // Whether phases are recorded
+
+    /**
+     * @brief Start timing and counting a phase
+     */
+
+    void begin() {
+        counters.start();                               // Counters first, so the clock read is not counted twice
+        started = std::chrono::steady_clock::now();     // Then the clock
+    }                                                   // End of function begin
+
+    /**
+     * @brief Finish the phase begun last and add it to (engine, phase)
+     */
+
+    void end(const std::string &engine, const char *phase, long long references) {
+        auto now = std::chrono::steady_clock::now();    // Stop the clock first
+        PhaseRecord &record = find(engine, phase);      // Totals for the pair
+        counters.stop(record.counts, record.counted);   // Add the events
+        record.ns += std::chrono::duration<double, std::nano>(now - started).count();  // And the time
+        record.references += references;
+    }                                                   // End of function end
+
+    /**
+     * @brief Add the records another instance collected
+     */
+
+    void add(const Instrumentation &other) {
+        for (const PhaseRecord &from : other.records) { // For every record
+            PhaseRecord &record = find(from.engine, from.phase.c_str());  // Matching totals here
+            record.ns += from.ns;                       // Merge it
+            record.references += from.references;
+            for (int k = 0; k < COUNTER_COUNT; k++) {
+                record.counts[k] += from.counts[k];
+                record.counted[k] = record.counted[k] || from.counted[k];
+            }                                           // End for loop
+        }                                               // End for loop
+    }                                                   // End of function add
+
+    /**
+     * @brief Print every record, as text lines or as JSON lines
+     *
+     * Ratios are per reference (ns, cache and branch misses) and per
+     * cycle (instructions); a missing counter, or a phase that handled no
+     * references, leaves its ratio out, or null in JSON.
+     */
+
+    void report(std::ostream &os, bool json) const {
+        for (const PhaseRecord &r : records) {          // For every (engine, phase)
+            double n = r.references > 0 ? (double) r.references : 1;  // Divide by at least one
+            bool ipc = r.counted[0] && r.counted[1] && r.counts[0] > 0;  // Whether instructions per cycle is known
+
+            if (json) {                                 // One object per line
+                os << "{\"engine\":\"" << r.engine << "\",\"phase\":\"" << r.phase <<
+                    "\",\"ns\":" << (long long) r.ns << ",\"references\":" << r.references <<
+                    ",\"ns_per_ref\":";
+                if (r.references > 0) os << r.ns / n; else os << "null";
+                for (int k = 0; k < COUNTER_COUNT; k++) {  // Raw counts
+                    os << ",\"" << COUNTER_NAMES[k] << "\":";
+                    if (r.counted[k]) os << r.counts[k]; else os << "null";
+                }                                       // End for loop
+                os << ",\"ipc\":";
+                if (ipc) os << (double) r.counts[1] / r.counts[0]; else os << "null";
+                os << ",\"cache_misses_per_ref\":";
+                if (r.counted[2]) os << r.counts[2] / n; else os << "null";
+                os << ",\"branch_misses_per_ref\":";
+                if (r.counted[3]) os << r.counts[3] / n; else os << "null";
+                os << "}\n";
+                continue;                               // Next record
+            }                                           // End if statement
+
+            os << (r.engine.empty() ? "" : r.engine + " ") << r.phase << ": " <<  // Name the phase
+                r.ns / 1e6 << " ms, " << r.references << " refs";
+            if (r.references > 0)                       // Per-reference figures need references
+                os << ", " << r.ns / n << " ns/ref";
+            if (ipc)                                    // Then whatever the counters measured
+                os << ", IPC " << (double) r.counts[1] / r.counts[0];
+            if (r.counted[2])
+                os << ", " << r.counts[2] / n << " cache misses/ref";
+            if (r.counted[3])
+                os << ", " << r.counts[3] / n << " branch misses/ref";
+            os << "\n";
+        }                                               // End for loop
+    }                                                   // End of function report
+
+private:
+    /**
+     * @brief Totals for (engine, phase), created empty the first time
+     */
+
+    PhaseRecord &find(const std::string &engine, const char *phase) {
+        for (PhaseRecord &record : records)             // Few records, so a scan will do
+            if (record.engine == engine && record.phase == phase)
+                return record;
+        records.push_back(PhaseRecord{engine, phase, 0, 0, {}, {}});  // First time for the pair
+        return records.back();
+    }                                                   // End of function find
+
+    bool enabled;                                       // Whether phases are recorded
+    PerfCounters counters;                              // This thread's hardware counters
+    std::chrono::steady_clock::time_point started;      // Start of the current phase
+    std::vector<PhaseRecord> records;                   // Totals in order of first appearance
+};
+
+/**
+ * @brief Times the enclosing scope as one phase, if stats is on
+ */
+
+class ScopedPhase {
+public:
+    ScopedPhase(Instrumentation &into, const std::string &engineName, const char *phaseName, long long refs = 0)
+        : stats(into), engine(engineName), phase(phaseName), references(refs) {
+        if (stats.on())                                 // If phases are being recorded
+            stats.begin();                              // Start this one
+    }                                                   // End constructor
+
+    ~ScopedPhase() {
+        if (stats.on())                                 // If phases are being recorded
+            stats.end(engine, phase, references);       // Finish this one
+    }                                                   // End destructor
+
+    void setReferences(long long refs) { references = refs; }  // References handled, once known
+
+private:
+    Instrumentation &stats;                             // Where the phase is recorded
+    std::string engine;                                 // Policy label, or empty
+    const char *phase;                                  // Phase name
+    long long references;                               // References handled
+};
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cost.h"
+#include "registry.h"
+#include "stats.h"
+#include "threadpool.h"
+#include "trace.h"
+
+/**
+ * @brief A trace parsed once and shared read-only by every sweep task
+ */
+
+struct SweepTrace {
+    const char *filename;                               // Where the trace came from
+    TraceHeader header;                                 // Algorithm and frame count in the file
+    std::vector<int> refs;                              // Page ID of every reference in the trace
+    std::vector<char> writes;                           // Write flag of every reference, or empty if none writes
+    PageInterner pages;                                 // Page numbers behind the IDs
+    bool loaded = false;                                // Whether readTrace succeeded
+};
+
+/**
+ * @brief Outcome of one (trace, policy, frame count) task
+ */
+
+struct SweepResult {
+    int trace;                                          // Index into the trace list
+    const PolicyEntry *policy;                          // Policy that ran
+    int frames;                                         // Frame count
+    long long pageFaults;                               // Faults that occurred
+    long long writeBacks;                               // Dirty pages replaced
+    double seconds;                                     // Time the simulation took
+};
+
+/**
+ * @brief Parse a frame-count list such as "8,16,32", "1-64" or "1-64:4"
+ *
+ * @param text   The list from the command line
+ * @param frames Receives the frame counts
+ *
+ * @return false if the list is malformed
+ */
+
+inline bool parseFrameList(const char *text,
+                           std::vector<int> &frames)
+{
+    frames.clear();                                     // Start with no frame counts
+
+    while (*text) {                                     // While there are items left
+        char *end;                                      // End of the number just read
+        long first = std::strtol(text, &end, 10);       // First value of the item
+        long last = first;                              // Last value of the item
+        long step = 1;                                  // Stride through the range
+
+        if (end == text || first < 1)                   // If there is no positive number here
+            return false;                               // The list is malformed
+
+        if (*end == '-') {                              // If the item is a range
+            text = end + 1;                             // Step past the dash
+            last = std::strtol(text, &end, 10);         // Read the end of the range
+            if (end == text || last < first)            // If it is missing or backwards
+                return false;                           // The list is malformed
+        }                                               // End if statement
+
+        if (*end == ':') {                              // If the range has a stride
+            text = end + 1;                             // Step past the colon
+            step = std::strtol(text, &end, 10);         // Read the stride
+            if (end == text || step < 1)                // If it is missing or not positive
+                return false;                           // The list is malformed
+        }                                               // End if statement
+
+        for (long f = first; f <= last; f += step)      // For every value in the item
+            frames.push_back((int) f);                  // Add it to the list
+
+        if (*end == ',')                                // If another item follows
+            end++;                                      // Step past the comma
+        else if (*end != '\0')                          // Else anything but the end is an error
+            return false;                               // The list is malformed
+        text = end;                                     // Move to the next item
+    }                                                   // End while loop
+
+    return !frames.empty();                             // At least one frame count is needed
+}                                                       // End of function parseFrameList
+
+/**
+ * @brief Parse a comma-separated list of policy names
+ *
+ * @param text           The list from the command line
+ * @param policies       Receives the registry entries
+ * @param allowReference Whether the scanning reference engines may be named
+ *
+ * @return false if a name is unknown or names a reference engine that is not allowed
+ */
+
+inline bool parsePolicyList(const char *text,
+                            std::vector<const PolicyEntry *> &policies,
+                            bool allowReference = false)
+{
+    policies.clear();                                   // Start with no policies
+    std::string list = text;                            // Copy so the names can be split
+    size_t start = 0;                                   // Start of the current name
+
+    while (start <= list.size()) {                      // While names remain
+        size_t comma = list.find(',', start);           // End of the current name
+        if (comma == std::string::npos)                 // If this is the last name
+            comma = list.size();                        // It runs to the end
+
+        std::string name = list.substr(start, comma - start);  // The name
+        const PolicyEntry *entry = findPolicy(name.c_str());  // Look it up
+
+        if (entry == nullptr || (entry->reference && !allowReference)) {  // If it is unknown or a scanning reference engine
+            std::cerr << "Cannot run policy '" << name << "'.\n";  // Print error message
+            return false;                               // The list is bad
+        }                                               // End if statement
+
+        policies.push_back(entry);                      // Add it to the list
+        start = comma + 1;                              // Move past the comma
+    }                                                   // End while loop
+
+    return true;                                        // Every name was found
+}                                                       // End of function parsePolicyList
+
+/**
+ * @brief Run every (trace, policy, frame count) combination on a thread pool
+ *
+ * Each trace is parsed once into a shared read-only buffer; the
+ * Cartesian product of policies and frame counts then runs as
+ * independent tasks on a work-stealing pool, and the results are printed
+ * as one CSV table in a fixed order. Traces with writes run through
+ * streaming engines so write-backs are counted; every row also gets the
+ * effective access time under the --cost latencies. With --stats each
+ * task measures itself on its own thread, and the phases are reported
+ * per trace and per (policy, frame count) once the pool has finished.
+ *
+ * @param argc  Argument count from main
+ * @param argv  Arguments from main
+ * @param first Index of the first argument after --sweep
+ *
+ * @return Exit status for main
+ */
+
+inline int runSweep(int argc,
+                    char *argv[],
+                    int first)
+{
+    std::vector<const PolicyEntry *> policies;          // Policies to run
+    std::vector<int> frameList;                         // Frame counts to run, or empty for each trace's own
+    std::vector<SweepTrace> traces;                     // Traces to run
+    int threads = 0;                                    // Worker threads; 0 means one per hardware thread
+    CostModel cost;                                     // Latencies for the access time
+    parseCostModel("default", cost);                    // Unless --cost overrides them
+    bool statsText = false;                             // Whether to report per-task timings and counters
+    bool statsJson = false;                             // Whether to report them as JSON lines
+
+    for (int i = first; i < argc; i++) {                // Walk the rest of the command line
+        if (std::strcmp(argv[i], "--policies") == 0 && i + 1 < argc) {  // If policies were listed
+            if (!parsePolicyList(argv[++i], policies))  // Parse them
+                return 1;                               // Return 1 which indicates error
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {  // If frame counts were listed
+            if (!parseFrameList(argv[++i], frameList)) {  // Parse them
+                std::cerr << "Bad frame list '" << argv[i] << "'.\n";  // Print error message
+                return 1;                               // Return 1 which indicates error
+            }                                           // End if statement
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {  // If a thread count was given
+            threads = std::atoi(argv[++i]);             // Use it
+        } else if (std::strcmp(argv[i], "--cost") == 0 && i + 1 < argc) {  // If latencies were given
+            if (!parseCostModel(argv[++i], cost))       // Parse them
+                return 1;                               // Return 1 which indicates error
+        } else if (std::strcmp(argv[i], "--stats") == 0) {  // If the tasks should be measured
+            statsText = true;                           // Report them as text
+        } else if (std::strcmp(argv[i], "--stats-json") == 0) {  // If they should be measured for a script
+            statsJson = true;                           // Report them as JSON lines
+        } else {                                        // Else it is a trace
+            traces.push_back(SweepTrace{argv[i], TraceHeader{}, {}, {}, {}});  // Queue it for loading
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    if (traces.empty()) {                               // If no traces were named
+        std::cerr << "Usage: " << argv[0] <<            // Display the usage message
+            " --sweep [--policies a,b,...] [--frames 1-64:4,128] [--threads N] [--cost ...]\n" <<
+            "       [--stats | --stats-json] <trace>...\n";
+        return 1;                                       // Return 1 which indicates error
+    }                                                   // End if statement
+
+    if (policies.empty())                               // If no policies were listed
+        for (int i = 0; i < POLICY_COUNT; i++)          // Take every registered policy
+            if (!POLICIES[i].reference)                 // Except the reference engines
+                policies.push_back(&POLICIES[i]);       // Add it
+
+    bool measure = statsText || statsJson;              // Whether tasks record their phases
+    Instrumentation stats;                              // Every task's phases, merged
+    if (measure)                                        // If they were asked for
+        stats.enable();                                 // Say once whether counters are available
+
+    auto start = std::chrono::steady_clock::now();      // Time the whole sweep
+    WorkStealingPool pool(threads);                     // Workers for loading and simulating
+    std::vector<Instrumentation> loadStats(traces.size());  // Phases of each load, on its worker
+
+    for (size_t t = 0; t < traces.size(); t++)          // For every trace
+        pool.submit([&traces, &loadStats, t, measure] { // Parse it once
+            SweepTrace &trace = traces[t];              // The trace to load
+            Instrumentation local;                      // Counters follow this worker, so open them here
+            if (measure)                                // If phases are recorded
+                local.enable(true);                     // Count on this worker
+            {
+                ScopedPhase parsing(local, trace.filename, "parse");  // Time the load
+                trace.loaded = readTrace(trace.filename, trace.header, trace.refs, trace.pages, 1, &trace.writes);
+                parsing.setReferences((long long) trace.refs.size());
+            }
+            loadStats[t].add(local);                    // Keep the records; the counters close here
+        });
+    pool.wait();                                        // Every trace must be loaded before simulating
+
+    for (const SweepTrace &trace : traces)              // Only now, with every worker idle
+        if (!trace.loaded)                              // If a trace could not be read
+            return 1;                                   // Return 1 which indicates error; the reason has been printed
+
+    std::vector<SweepResult> results;                   // One slot per task, in print order
+
+    for (int t = 0; t < (int) traces.size(); t++) {     // For every trace
+        std::vector<int> sizes = frameList;             // Frame counts for this trace
+        if (sizes.empty())                              // If none were listed
+            sizes.push_back(traces[t].header.frameCount);  // Use the trace's own
+
+        for (const PolicyEntry *policy : policies)      // For every policy
+            for (int frames : sizes)                    // For every frame count
+                if (frames >= 1)                        // Skip traces that ask for no frames
+                    results.push_back(SweepResult{t, policy, frames, 0, 0, 0});  // Reserve a result slot
+    }                                                   // End for loop
+
+    std::vector<Instrumentation> taskStats(results.size());  // Phases of each task, on its worker
+
+    for (size_t r = 0; r < results.size(); r++) {       // For every task
+        pool.submit([&results, &traces, &taskStats, r, measure] {  // Run it on the pool
+            SweepResult &result = results[r];           // Where the outcome goes
+            const SweepTrace &trace = traces[result.trace];  // Shared read-only trace
+            Instrumentation local;                      // Counters follow this worker, so open them here
+            if (measure)                                // If phases are recorded
+                local.enable(true);                     // Count on this worker
+            {
+                ScopedPhase simulating(local, std::string(result.policy->name) + "@" + std::to_string(result.frames),
+                                       "simulate", (long long) trace.refs.size());  // Named policy@frames
+                auto begin = std::chrono::steady_clock::now();  // Time the simulation
+                if (!trace.writes.empty() && result.policy->make != nullptr) {  // If dirty pages matter and the policy can stream
+                    std::unique_ptr<Engine> engine = result.policy->make(result.frames);  // Engine that tracks them
+                    engine->prepare(trace.refs.data(), (int) trace.refs.size());  // Let the policy look ahead
+                    engine->runWrites(trace.refs.data(), trace.writes.data(), (int) trace.refs.size());  // Run every reference
+                    engine->finish();                   // Settle any lagging references
+                    result.pageFaults = engine->pageFaults();  // Record the outcome
+                    result.writeBacks = engine->writeBacks();
+                } else {                                // Else every reference reads
+                    result.pageFaults = result.policy->run(result.frames,  // Simulate without a history
+                                                           trace.refs.data(),
+                                                           (int) trace.refs.size(),
+                                                           nullptr);
+                }                                       // End if statement
+                result.seconds = std::chrono::duration<double>(  // Record the time taken
+                    std::chrono::steady_clock::now() - begin).count();
+            }
+            taskStats[r].add(local);                    // Keep the records; the counters close here
+        });
+    }                                                   // End for loop
+    pool.wait();                                        // Wait for every task
+
+    std::cout << "trace,policy,frames,references,faults,fault_ratio,seconds,writebacks,eat_ns\n";  // CSV header
+
+    for (const SweepResult &result : results) {         // For every task, in order
+        const SweepTrace &trace = traces[result.trace]; // The trace it ran on
+        double ratio = trace.refs.empty() ? 0 :         // Fraction of references that faulted
+            (double) result.pageFaults / trace.refs.size();
+        std::cout << trace.filename << "," << result.policy->name << "," <<  // Display one row
+            result.frames << "," << trace.refs.size() << "," <<
+            result.pageFaults << "," << ratio << "," << result.seconds << "," << result.writeBacks << "," <<
+            effectiveAccessTime(cost, (long long) trace.refs.size(), result.pageFaults, result.writeBacks) << "\n";
+    }                                                   // End for loop
+
+    double seconds = std::chrono::duration<double>(     // Wall time of the sweep
+        std::chrono::steady_clock::now() - start).count();
+    std::cerr << results.size() << " runs on " << pool.size() <<  // Summarize the sweep
+        " threads in " << seconds << " s\n";
+
+    for (const Instrumentation &task : loadStats)       // Merge the loads' phases
+        stats.add(task);
+    for (const Instrumentation &task : taskStats)       // Then the tasks', in print order
+        stats.add(task);
+    stats.report(std::cerr, statsJson);                 // Show where the time went, if --stats is on
+
+    return 0;                                           // Return 0 which indicates success
+}                                                       // End of function runSweep
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size thread pool with per-worker queues and work stealing
+ *
+ * Tasks are dealt round-robin onto the workers' own deques. A worker
+ * takes from the back of its own deque and, when that runs dry, steals
+ * from the front of the others, so long and short tasks even out
+ * without a single shared queue becoming the bottleneck.
+ */
+
+class WorkStealingPool {
+public:
+    /**
+     * @brief Start threadCount workers (0 means one per hardware thread)
+     */
+
+    explicit WorkStealingPool(int threadCount)
+        : queues(workerCount(threadCount)), pending(0), queued(0), next(0), stopping(false) {
+        for (int i = 0; i < (int) queues.size(); i++)   // For every worker
+            workers.emplace_back([this, i] { work(i); });  // Start its thread
+    }                                                   // End constructor
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);  // Guard the stop flag
+            stopping = true;                            // Tell the workers to exit
+        }
+        wake.notify_all();                              // Wake every sleeping worker
+        for (std::thread &worker : workers)             // For every worker
+            worker.join();                              // Wait for it to exit
+    }                                                   // End destructor
+
+    /**
+     * @brief Queue a task
+     */
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);  // Guard the counts
+            pending++;                                  // One more task outstanding
+            queued++;                                   // And it is about to wait in a deque
+        }
+        Queue &queue = queues[next++ % queues.size()];  // Deal tasks round-robin
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);  // Guard the deque
+            queue.tasks.push_back(std::move(task));     // Add the task
+        }
+        wake.notify_one();                              // Wake a sleeping worker
+    }                                                   // End of function submit
+
+    /**
+     * @brief Block until every submitted task has finished
+     */
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(idleMutex);   // Guard the pending count
+        idle.wait(lock, [this] { return pending == 0; });  // Sleep until the work is done
+    }                                                   // End of function wait
+
+    int size() const { return (int) queues.size(); }    // Number of worker threads
+
+private:
+    struct Queue {
+        std::mutex mutex;                               // Guards tasks
+        std::deque<std::function<void()>> tasks;        // Tasks owned by this worker
+    };
+
+    /**
+     * @brief Resolve a requested thread count
+     */
+
+    static size_t workerCount(int threadCount) {
+        if (threadCount > 0)                            // If a count was given
+            return threadCount;                         // Use it
+        unsigned hardware = std::thread::hardware_concurrency();  // Threads the machine offers
+        return hardware > 0 ? hardware : 1;             // At least one worker
+    }                                                   // End of function workerCount
+
+    /**
+     * @brief Take a task from worker self's deque, or steal one
+     */
+
+    bool take(int self, std::function<void()> &task) {
+        for (int k = 0; k < (int) queues.size(); k++) { // Own deque first, then the others
+            int victim = (self + k) % (int) queues.size();  // Deque to try
+            Queue &queue = queues[victim];              // That deque
+            std::lock_guard<std::mutex> lock(queue.mutex);  // Guard it
+            if (queue.tasks.empty())                    // If it has nothing
+                continue;                               // Try the next one
+            if (k == 0) {                               // Own deque: newest first, it is warmest in cache
+                task = std::move(queue.tasks.back());   // Take the back
+                queue.tasks.pop_back();                 // Remove it
+            } else {                                    // Someone else's deque: oldest first
+                task = std::move(queue.tasks.front());  // Steal the front
+                queue.tasks.pop_front();                // Remove it
+            }                                           // End if statement
+            std::lock_guard<std::mutex> idleLock(idleMutex);  // Guard the queued count
+            queued--;                                   // The task has left its deque
+            return true;                                // A task was found
+        }                                               // End for loop
+        return false;                                   // Every deque is empty
+    }                                                   // End of function take
+
+    /**
+     * @brief Worker loop
+     */
+
+    void work(int self) {
+        std::function<void()> task;                     // Task being run
+
+        while (true) {                                  // Until the pool shuts down
+            if (take(self, task)) {                     // If there is work anywhere
+                task();                                 // Run it
+                std::lock_guard<std::mutex> lock(idleMutex);  // Guard the pending count
+                if (--pending == 0)                     // If that was the last task
+                    idle.notify_all();                  // Release wait()
+                continue;                               // Look for more work
+            }                                           // End if statement
+
+            std::unique_lock<std::mutex> lock(idleMutex);  // Sleep until there is work
+            wake.wait(lock, [this] { return stopping || queued > 0; });  // Wait for a submit or shutdown
+            if (stopping)                               // If the pool is shutting down
+                return;                                 // Exit the thread
+            lock.unlock();                              // Release before scanning the deques
+        }                                               // End while loop
+    }                                                   // End of function work
+
+    std::vector<Queue> queues;                          // One deque per worker
+    std::vector<std::thread> workers;                   // Worker threads
+    std::mutex idleMutex;                               // Guards pending, queued and stopping
+    std::condition_variable wake;                       // Signalled when work arrives or the pool stops
+    std::condition_variable idle;                       // Signalled when pending reaches zero
+    long long pending;                                  // Tasks submitted but not finished
+    long long queued;                                   // Tasks still sitting in a deque
+    std::atomic<size_t> next;                           // Round-robin cursor for submit
+    bool stopping;                                      // Whether the workers should exit
+};
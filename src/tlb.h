@@ -0,0 +1,294 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief How a TLB level picks the entry to replace within a set
+ */
+
+enum TlbReplacement {
+    TLB_LRU,                                            // Least recently used way
+    TLB_FIFO,                                           // Oldest fill
+    TLB_RANDOM                                          // Any way, from a fixed-seed generator
+};
+
+/**
+ * @brief Geometry of one TLB level
+ */
+
+struct TlbGeometry {
+    int entries;                                        // Total entries
+    int ways;                                           // Entries per set
+};
+
+/**
+ * @brief Configuration of the whole translation stage
+ */
+
+struct TlbSpec {
+    TlbGeometry l1;                                     // First level, base pages
+    TlbGeometry l1Huge;                                 // First level, huge pages (used only with hugePages)
+    TlbGeometry l2;                                     // Second level, shared by both page sizes
+    TlbReplacement replacement;                         // Policy within every set
+    uint64_t hugePages;                                 // Base pages per huge page (a power of two), or 0 for none
+};
+
+/**
+ * @brief One set-associative TLB level
+ *
+ * Tags and replacement stamps live in flat arrays, set after set, so a
+ * lookup masks the tag down to a set and compares at most ways tags in
+ * one or two cache lines. Sets are a power of two and are indexed by
+ * the low bits of the tag, as in hardware; there is no hashing. Each
+ * entry also records the page size it maps, so a level can hold both
+ * sizes and every 64-bit page number is a valid tag.
+ */
+
+class TlbLevel {
+public:
+    /**
+     * @brief Empty every entry
+     *
+     * @param geometry Entries and ways; entries / ways must be a power of two
+     */
+
+    void init(const TlbGeometry &geometry,
+              TlbReplacement how) {
+        ways = geometry.ways;                           // Entries per set
+        setMask = geometry.entries / geometry.ways - 1; // Set count minus one
+        replacement = how;                              // Policy within each set
+        tags.assign(geometry.entries, 0);               // No translations
+        sizes.assign(geometry.entries, EMPTY);
+        stamps.assign(geometry.entries, 0);             // No history
+        clock = 0;                                      // Replacement time
+        seed = 0x9E3779B97F4A7C15ull;                   // Fixed seed so runs repeat
+    }                                                   // End of function init
+
+    /**
+     * @brief Look tag up among the entries for huge or base pages; a hit refreshes it under LRU
+     */
+
+    bool lookup(uint64_t tag, bool huge) {
+        size_t base = (tag & setMask) * ways;           // First entry of the set
+        char size = huge ? HUGE : BASE;                 // Page size the entry must map
+        for (int w = 0; w < ways; w++) {                // For every way
+            if (tags[base + w] == tag && sizes[base + w] == size) {  // If it holds the tag
+                if (replacement == TLB_LRU)             // If recency matters
+                    stamps[base + w] = ++clock;         // Now the most recent
+                return true;                            // Hit
+            }                                           // End if statement
+        }                                               // End for loop
+        return false;                                   // Miss
+    }                                                   // End of function lookup
+
+    /**
+     * @brief Install tag, replacing an empty way or the policy's victim
+     */
+
+    void fill(uint64_t tag, bool huge) {
+        size_t base = (tag & setMask) * ways;           // First entry of the set
+        size_t victim = base;                           // Way to overwrite
+        char size = huge ? HUGE : BASE;                 // Page size the entry will map
+
+        if (replacement == TLB_RANDOM) {                // If any way will do
+            seed ^= seed << 13;                         // xorshift64
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            victim = base + seed % ways;                // Pick one
+        }                                               // End if statement
+
+        for (int w = 0; w < ways; w++)                  // For every way
+            if (replacement != TLB_RANDOM && stamps[base + w] < stamps[victim])  // If it is older
+                victim = base + w;                      // It is the better victim
+
+        int empty = -1;                                 // First empty way, if any
+        for (int w = 0; w < ways; w++) {                // For every way
+            if (tags[base + w] == tag && sizes[base + w] == size) {  // If the tag is already here
+                empty = w;                              // Refill it in place
+                break;                                  // Stop looking
+            }                                           // End if statement
+            if (sizes[base + w] == EMPTY && empty == -1)  // If this is the first empty way
+                empty = w;                              // Prefer it to evicting
+        }                                               // End for loop
+        if (empty != -1)                                // If a way needs no eviction
+            victim = base + empty;                      // Use it
+
+        tags[victim] = tag;                             // Install the translation
+        sizes[victim] = size;
+        stamps[victim] = ++clock;                       // Filled now
+    }                                                   // End of function fill
+
+    /**
+     * @brief Drop tag if it is present (a shootdown)
+     */
+
+    void invalidate(uint64_t tag, bool huge) {
+        size_t base = (tag & setMask) * ways;           // First entry of the set
+        char size = huge ? HUGE : BASE;                 // Page size the entry maps
+        for (int w = 0; w < ways; w++)                  // For every way
+            if (tags[base + w] == tag && sizes[base + w] == size)  // If it holds the tag
+                sizes[base + w] = EMPTY;                // Empty it
+    }                                                   // End of function invalidate
+
+private:
+    static constexpr char EMPTY = 0;                    // Size of an entry that maps nothing
+    static constexpr char BASE = 1;                     // Size of a base-page entry
+    static constexpr char HUGE = 2;                     // Size of a huge-page entry
+
+    std::vector<uint64_t> tags;                         // tags[set * ways + way]
+    std::vector<char> sizes;                            // Page size each entry maps, or EMPTY
+    std::vector<uint64_t> stamps;                       // Last use (LRU) or fill (FIFO) of each entry
+    int ways;                                           // Entries per set
+    uint64_t setMask;                                   // Set count minus one
+    TlbReplacement replacement;                         // Policy within each set
+    uint64_t clock;                                     // Replacement time
+    uint64_t seed;                                      // Random replacement state
+};
+
+/**
+ * @brief Two-level TLB in front of the frame engines
+ *
+ * Base-page translations go to the L1 TLB, huge-page translations to
+ * a separate L1 for huge pages, and both share the L2, where each entry
+ * records its page size to keep the sizes apart. A miss in both levels is a page
+ * walk, which fills L2 and L1. When huge pages are on, every page is
+ * mapped through the huge page holding it.
+ */
+
+class Tlb {
+public:
+    long long accesses;                                 // Translations requested
+    long long l1Hits;                                   // Served by L1
+    long long l2Hits;                                   // Missed L1, served by L2
+    long long walks;                                    // Missed both; the page table was walked
+
+    void init(const TlbSpec &spec) {
+        l1.init(spec.l1, spec.replacement);             // Base-page L1
+        l1Huge.init(spec.l1Huge, spec.replacement);     // Huge-page L1
+        l2.init(spec.l2, spec.replacement);             // Shared L2
+        hugeShift = spec.hugePages ? __builtin_ctzll(spec.hugePages) : -1;  // log2 of the huge page size
+        accesses = l1Hits = l2Hits = walks = 0;         // No translations yet
+    }                                                   // End of function init
+
+    /**
+     * @brief Translate page through the TLB levels
+     *
+     * @param walk Whether the page just faulted, so the walk is certain
+     *             and any stale translation must not hit
+     */
+
+    void translate(uint64_t page, bool walk) {
+        uint64_t number = hugeShift >= 0 ? page >> hugeShift : page;  // Page number at the mapping's size
+        bool huge = hugeShift >= 0;                     // Whether the page is mapped huge
+        TlbLevel &first = huge ? l1Huge : l1;           // L1 for that size
+        accesses++;                                     // One more translation
+
+        if (!walk && first.lookup(number, huge)) {      // If L1 has it
+            l1Hits++;                                   // Count the hit
+            return;                                     // Done
+        }                                               // End if statement
+
+        if (!walk && l2.lookup(number, huge)) {         // If L2 has it
+            l2Hits++;                                   // Count the hit
+        } else {                                        // Else walk the page table
+            walks++;                                    // Count the walk
+            l2.fill(number, huge);                      // Cache the result in L2
+        }                                               // End if statement
+        first.fill(number, huge);                       // And in L1
+    }                                                   // End of function translate
+
+    /**
+     * @brief Drop page's translation after it has been evicted from memory
+     */
+
+    void evict(uint64_t page) {
+        uint64_t number = hugeShift >= 0 ? page >> hugeShift : page;  // Page number at the mapping's size
+        bool huge = hugeShift >= 0;                     // Whether the page is mapped huge
+        (huge ? l1Huge : l1).invalidate(number, huge);  // Shoot down L1
+        l2.invalidate(number, huge);                    // And L2
+    }                                                   // End of function evict
+
+private:
+    TlbLevel l1;                                        // Base-page L1
+    TlbLevel l1Huge;                                    // Huge-page L1
+    TlbLevel l2;                                        // Shared L2
+    int hugeShift;                                      // log2(base pages per huge page), or -1
+};
+
+/**
+ * @brief Parse "ENTRIES:WAYS" with a power-of-two number of sets
+ */
+
+inline bool parseTlbGeometry(const std::string &text,
+                             TlbGeometry &geometry)
+{
+    char *end;                                          // End of each number
+    long entries = std::strtol(text.c_str(), &end, 10); // Total entries
+    if (*end != ':')                                    // If the ways are missing
+        return false;                                   // The text is invalid
+    long ways = std::strtol(end + 1, &end, 10);         // Entries per set
+    if (*end != '\0' || ways < 1 || entries < ways || entries % ways != 0 || entries > (1 << 24))  // If it is not a whole number of sets
+        return false;                                   // The text is invalid
+    long sets = entries / ways;                         // Number of sets
+    geometry = TlbGeometry{(int) entries, (int) ways};  // Use it
+    return (sets & (sets - 1)) == 0;                    // Sets are indexed by a mask
+}                                                       // End of function parseTlbGeometry
+
+/**
+ * @brief Parse a TLB description such as "l1=64:4,l2=1536:12,huge=512,replace=lru"
+ *
+ * Keys are l1, l1huge and l2 (ENTRIES:WAYS), huge (base pages per huge
+ * page, a power of two) and replace (lru, fifo or random). Missing keys
+ * keep their defaults, a 64-entry 4-way L1, a 32-entry 4-way huge-page
+ * L1 and a 1536-entry 12-way L2 under LRU; "default" keeps them all.
+ *
+ * @return false, after printing why, if the description is invalid
+ */
+
+inline bool parseTlbSpec(const char *text,
+                         TlbSpec &spec)
+{
+    spec = TlbSpec{{64, 4}, {32, 4}, {1536, 12}, TLB_LRU, 0};  // Defaults
+    std::string list = std::string(text) + ",";         // Every item ends in a comma
+    if (list == "default,")                             // If the defaults were asked for
+        return true;                                    // Keep them
+
+    for (size_t start = 0, comma; (comma = list.find(',', start)) != std::string::npos; start = comma + 1) {
+        std::string item = list.substr(start, comma - start);  // The next key=value
+        size_t equals = item.find('=');                 // Where the value starts
+        std::string key = item.substr(0, equals);       // The key
+        std::string value = equals == std::string::npos ? "" : item.substr(equals + 1);  // The value
+        bool ok;                                        // Whether the item parsed
+
+        if (key == "l1")                                // Base-page L1
+            ok = parseTlbGeometry(value, spec.l1);
+        else if (key == "l1huge")                       // Huge-page L1
+            ok = parseTlbGeometry(value, spec.l1Huge);
+        else if (key == "l2")                           // Shared L2
+            ok = parseTlbGeometry(value, spec.l2);
+        else if (key == "huge") {                       // Huge page size
+            spec.hugePages = std::strtoull(value.c_str(), nullptr, 10);  // In base pages
+            ok = spec.hugePages > 1 && (spec.hugePages & (spec.hugePages - 1)) == 0;  // A power of two above one
+        } else if (key == "replace") {                  // Replacement within sets
+            ok = true;                                  // Unless the name is unknown
+            if (value == "lru") spec.replacement = TLB_LRU;
+            else if (value == "fifo") spec.replacement = TLB_FIFO;
+            else if (value == "random") spec.replacement = TLB_RANDOM;
+            else ok = false;
+        } else {                                        // Else the key is unknown
+            ok = false;                                 // Reject it
+        }                                               // End if statement
+
+        if (!ok) {                                      // If the item is bad
+            std::cerr << "Bad TLB setting '" << item << "'.\n";  // Print error message
+            return false;                               // The description is invalid
+        }                                               // End if statement
+    }                                                   // End for loop
+
+    return true;                                        // Every item parsed
+}                                                       // End of function parseTlbSpec
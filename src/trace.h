@@ -0,0 +1,360 @@
+#pragma once
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "bintrace.h"
+#include "checkpoint.h"
+#include "intern.h"
+
+const int TRACE_BUFFER_SIZE = 1 << 16;                  // Bytes pulled from the input per read
+const int TRACE_CHUNK_SIZE = 1 << 14;                   // References handed to an engine per chunk
+
+/**
+ * @brief The "algo,frames" prefix of a trace
+ */
+
+struct TraceHeader {
+    char algo;                                          // The selected algorithm
+    int frameCount;                                     // Number of frames that can be used
+};
+
+/**
+ * @brief Streaming reader for "algo,frames,ref,ref,..." traces
+ *
+ * Reads the input in fixed-size blocks and parses references into
+ * caller-provided chunks, so a trace never has to fit in memory.
+ * References may span any number of lines; anything that is not a
+ * digit separates two references. Files in the binary format of
+ * bintrace.h are recognized by their magic and decoded from a mapping
+ * instead. References are 64-bit; with a page size set they are byte
+ * addresses and are divided down to page numbers. A reference followed
+ * directly by 'w' (as in "12w") is a write; any other reference, "12r"
+ * included, is a read.
+ */
+
+class TraceReader {
+public:
+    TraceReader() : file(nullptr), ownsFile(false), isBinary(false), pos(0), len(0), consumed(0),
+                    refCount(0), pageSize(1), pageShift(0), overflow(false), frameOverflow(false), chunkWrites(false), checkReserved(true),
+                    buffer(TRACE_BUFFER_SIZE) {}
+
+    ~TraceReader() {
+        if (ownsFile)                                   // Only close files we opened ourselves
+            std::fclose(file);                          // Close the input file
+    }                                                   // End destructor
+
+    /**
+     * @brief Open a trace file, or stdin when the name is "-"
+     *
+     * @param filename The name of the file to read from
+     *
+     * @return true if the input is ready to be read
+     */
+
+    bool open(const char *filename) {
+        if (filename[0] == '-' && filename[1] == '\0') {  // If the name is "-"
+            file = stdin;                               // Read from standard input
+            ownsFile = false;                           // Standard input is not ours to close
+        } else if (isBinaryTrace(filename)) {           // Else if the file is a binary trace
+            isBinary = true;                            // Decode it from a mapping
+            return binary.open(filename);               // Map the file
+        } else {                                        // Else open the named file
+            file = std::fopen(filename, "rb");          // Open file for reading
+            ownsFile = file != nullptr;                 // Close it in the destructor if it opened
+        }                                               // End if statement
+
+        return file != nullptr;                         // Report whether the input is open
+    }                                                   // End of function open
+
+    /**
+     * @brief Parse the algorithm and frame count at the start of the trace
+     *
+     * @param header Receives the algorithm and frame count
+     *
+     * A frame count above INT_MAX is read as 0 and flagged for
+     * framesOverflowed, so it can never wrap into a small one.
+     *
+     * @return false if the input is empty
+     */
+
+    bool readHeader(TraceHeader &header) {
+        header.algo = 0;                                // Set the algorithm to 0
+        header.frameCount = 0;                          // Set the number of frames to 0
+
+        if (isBinary) {                                 // If the trace is binary
+            header.algo = binary.algorithm();           // Take the algorithm from its header
+            header.frameCount = binary.frames();        // And the frame count
+            return true;                                // The header was read; references follow
+        }                                               // End if statement
+
+        int c = nextByte();                             // Current character
+        if (c < 0)                                      // If there is nothing to read
+            return false;                               // The input is empty
+
+        while (c == ' ' || c == '\t')                   // Skip leading spaces and tabs
+            c = nextByte();                             // Read the next character
+
+        if (c < 0 || c == '\n')                         // If the line ends before the algorithm
+            return true;                                // Leave the algorithm as 0
+
+        header.algo = (char) c;                         // Set the algorithm to the character
+
+        while (c >= 0 && c != ',')                      // Skip to the comma after the algorithm
+            c = nextByte();                             // Read the next character
+
+        c = nextByte();                                 // Step past the comma
+
+        while (c >= '0' && c <= '9') {                  // While the character is a digit
+            if (header.frameCount > (INT_MAX - (c - '0')) / 10)  // If one more digit would not fit
+                frameOverflow = true;                   // Note it for the caller
+            else                                        // Else
+                header.frameCount =                     // frameCount is equal to
+                    header.frameCount * 10 +            // frameCount * 10 multi digit numbers
+                    (c - '0');                          // subtract the character from '0' to convert to numeric value
+            c = nextByte();                             // Read the next character
+        }                                               // End of while loop
+
+        if (frameOverflow)                              // If the count did not fit
+            header.frameCount = 0;                      // Leave no frames rather than a wrapped count
+
+        return true;                                    // The header was read; references follow
+    }                                                   // End of function readHeader
+
+    /**
+     * @brief Treat references as byte addresses in pages of size bytes
+     *
+     * @return false if size is 0
+     */
+
+    bool setPageSize(uint64_t size) {
+        if (size == 0)                                  // A page must hold something
+            return false;                               // Report the failure
+        pageSize = size;                                // Divide by this
+        pageShift = (size & (size - 1)) == 0 ? __builtin_ctzll(size) : -1;  // Or shift, for powers of two
+        return true;                                    // The page size is set
+    }                                                   // End of function setPageSize
+
+    /**
+     * @brief Parse up to capacity references into refs
+     *
+     * @param refs     Array receiving the page numbers
+     * @param capacity Size of the refs array
+     *
+     * @return Number of references stored; 0 once the trace is exhausted
+     */
+
+    int nextChunk(uint64_t refs[], int capacity) {
+        if ((int) writeFlags.size() < capacity)         // If the flags would not fit
+            writeFlags.resize(capacity);                // Make room for them
+
+        int count = isBinary ?                          // If the trace is binary
+            binary.nextChunk(refs, capacity, writeFlags.data()) :  // Decode straight into the chunk
+            parseChunk(refs, capacity);                 // Else parse the text
+        chunkWrites = (!isBinary || binary.hasWrites()) &&  // If the chunk has flags
+            std::memchr(writeFlags.data(), 1, count) != nullptr;  // And one is set
+
+        if (pageSize != 1)                              // If references are addresses
+            for (int i = 0; i < count; i++)             // For every reference
+                refs[i] = pageShift >= 0 ? refs[i] >> pageShift : refs[i] / pageSize;  // Turn it into a page number
+
+        bool reserved = false;                          // Whether a page is the all-ones page
+        for (int i = 0; checkReserved && i < count; i++)  // Checked on page numbers, after any division
+            reserved = reserved || refs[i] == PageInterner::RESERVED;
+        if (reserved) {                                 // If one slipped through
+            overflow = true;                            // Note it for the caller
+            for (int i = 0; i < count; i++)             // Saturate below it so the chunk can still be interned
+                if (refs[i] == PageInterner::RESERVED)
+                    refs[i] = PageInterner::RESERVED - 1;
+        }                                               // End if statement
+
+        refCount += count;                              // Track references handed out so far
+        return count;                                   // Return the size of the chunk
+    }                                                   // End of function nextChunk
+
+    long long bytesRead() const { return isBinary ? binary.bytesRead() : consumed; }  // Bytes pulled from the input so far
+    long long refsRead() const { return refCount; }     // References parsed so far
+    void keepReserved() { checkReserved = false; }      // Hand out the all-ones value as is, for callers that do not intern
+    bool overflowed() const { return overflow; }        // Whether a reference did not fit in 64 bits, or was the reserved page
+    bool framesOverflowed() const { return frameOverflow; }  // Whether the header's frame count did not fit in an int
+    bool truncated() const { return isBinary && binary.shortBody(); }  // Whether a binary trace holds fewer references than its header says
+    bool chunkHasWrites() const { return chunkWrites; } // Whether the latest chunk has a write
+    const char *writes() const { return writeFlags.data(); }  // Write flag of each reference in the latest chunk
+
+    /**
+     * @brief Where the next reference starts, for a checkpoint
+     *
+     * A text chunk always ends on the separator after a reference, so the
+     * unread part of the buffer begins at a reference boundary.
+     */
+
+    TracePosition position() const {
+        if (isBinary)                                   // If the trace is binary
+            return TracePosition{binary.bytesRead(), binary.last(), refCount};  // The decoder's cursor
+        return TracePosition{consumed - (len - pos), 0, refCount};  // Bytes read, less those still buffered
+    }                                                   // End of function position
+
+    /**
+     * @brief Continue reading at a position taken from this trace earlier
+     *
+     * @return false if the input cannot seek (stdin) or the position is out of range
+     */
+
+    bool seek(const TracePosition &at) {
+        if (isBinary) {                                 // If the trace is binary
+            if (!binary.seek(at.offset, at.previous, at.refs))  // Reposition the decoder
+                return false;                           // Report the failure
+        } else {                                        // Else the text is read through stdio
+            if (!ownsFile || fseeko(file, at.offset, SEEK_SET) != 0)  // If the input cannot seek there
+                return false;                           // Report the failure
+            pos = len = 0;                              // The buffer is stale
+            consumed = at.offset;                       // Everything before the offset counts as read
+        }                                               // End if statement
+        refCount = at.refs;                             // References already handed out
+        return true;                                    // The reader is positioned
+    }                                                   // End of function seek
+
+private:
+    /**
+     * @brief Parse up to capacity text references into refs
+     */
+
+    int parseChunk(uint64_t refs[], int capacity) {
+        const uint64_t LIMIT = ~0ULL;                   // Largest 64-bit value; the reserved page is caught after division
+        int count = 0;                                  // Number of references parsed into this chunk
+
+        while (count < capacity) {                      // While the chunk has room
+            int c = nextByte();                         // Current character
+
+            while (c >= 0 && (c < '0' || c > '9'))      // Skip separators
+                c = nextByte();                         // Read the next character
+
+            if (c < 0)                                  // If the input is exhausted
+                break;                                  // Stop filling the chunk
+
+            uint64_t val = 0;                           // Initialize val to 0
+
+            while (c >= '0' && c <= '9') {              // While the character is a digit
+                uint64_t digit = c - '0';               // Numeric value of the digit
+                if (val > (LIMIT - digit) / 10) {       // If one more digit would not fit
+                    overflow = true;                    // Note it for the caller
+                    val = LIMIT;                        // Saturate rather than wrap
+                } else {                                // Else
+                    val = val * 10 + digit;             // Accumulate the digit
+                }                                       // End if statement
+                c = nextByte();                         // Read the next character
+            }                                           // End of while loop
+
+            writeFlags[count] = c == 'w' || c == 'W';   // A 'w' right after the number makes it a write
+            refs[count++] = val;                        // Add val to refs and increment count
+        }                                               // End of while loop
+
+        return count;                                   // Return the size of the chunk
+    }                                                   // End of function parseChunk
+
+    /**
+     * @brief Return the next byte of input, or -1 at the end of input
+     */
+
+    int nextByte() {
+        if (pos == len) {                               // If the buffer has been used up
+            len = (int) std::fread(buffer.data(), 1, TRACE_BUFFER_SIZE, file);  // Refill the buffer
+            pos = 0;                                    // Restart at the front of the buffer
+            consumed += len;                            // Count the bytes read
+            if (len == 0)                               // If nothing was read
+                return -1;                              // Signal the end of input
+        }                                               // End if statement
+
+        return (unsigned char) buffer[pos++];           // Return the byte and advance
+    }                                                   // End of function nextByte
+
+    std::FILE *file;                                    // The input being read
+    bool ownsFile;                                      // Whether the destructor closes the input
+    bool isBinary;                                      // Whether the input is a binary trace
+    BinaryTraceReader binary;                           // Decoder for binary traces
+    int pos;                                            // Next unread byte in buffer
+    int len;                                            // Number of valid bytes in buffer
+    long long consumed;                                 // Bytes read from the input
+    long long refCount;                                 // References parsed so far
+    uint64_t pageSize;                                  // Bytes per page, or 1 for page numbers
+    int pageShift;                                      // log2(pageSize), or -1 if it is not a power of two
+    bool overflow;                                      // Whether a reference did not fit in 64 bits
+    bool frameOverflow;                                 // Whether the header's frame count did not fit in an int
+    bool chunkWrites;                                   // Whether the latest chunk has a write
+    bool checkReserved;                                 // Whether the all-ones page counts as an overflow
+    std::vector<char> writeFlags;                       // Write flag of each reference in the latest chunk
+    std::vector<char> buffer;                           // Block of raw input
+};
+
+/**
+ * @brief Read an entire trace into memory as dense page IDs
+ *
+ * @param filename The name of the file to read from, or "-" for stdin
+ * @param header   Receives the algorithm and frame count
+ * @param refs     Receives the page ID of every reference in the trace
+ * @param pages    Assigns the IDs; maps them back to page numbers
+ * @param pageSize Bytes per page if references are addresses, else 1
+ * @param writes   Receives each reference's write flag, or is left empty
+ *                 if the trace has no writes; nullptr to ignore them
+ *
+ * @return false, after printing why, if the trace cannot be read
+ */
+
+inline bool readTrace(const char *filename,
+                      TraceHeader &header,
+                      std::vector<int> &refs,
+                      PageInterner &pages,
+                      uint64_t pageSize = 1,
+                      std::vector<char> *writes = nullptr)
+{
+    TraceReader reader;                                 // Reader over the input
+    reader.setPageSize(pageSize);                       // Divide addresses down to pages
+
+    if (!reader.open(filename)) {                       // Check if file is open
+        std::cerr << "Cannot open input file.\n";       // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    if (!reader.readHeader(header)) {                   // Read the algorithm and frame count
+        std::cerr << "Input file is empty.\n";          // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    if (reader.framesOverflowed()) {                    // If the header's frame count is out of range
+        std::cerr << "Frame count is larger than 2147483647.\n";  // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    refs.clear();                                       // Start with no references
+    if (writes != nullptr)                              // If the flags are wanted
+        writes->clear();                                // None so far
+    std::vector<uint64_t> chunk(TRACE_CHUNK_SIZE);      // Chunk of parsed page numbers
+    int count;                                          // Size of the current chunk
+
+    while ((count = reader.nextChunk(chunk.data(), TRACE_CHUNK_SIZE)) > 0) {  // While references remain
+        size_t start = refs.size();                     // Where this chunk goes
+        refs.resize(start + count);                     // Make room for it
+        pages.intern(chunk.data(), count, refs.data() + start);  // Append the chunk's IDs
+
+        if (writes != nullptr && (reader.chunkHasWrites() || !writes->empty())) {  // If the trace has writes so far
+            writes->resize(start, 0);                   // Earlier chunks were all reads
+            writes->insert(writes->end(), reader.writes(), reader.writes() + count);  // Append the chunk's flags
+        }                                               // End if statement
+    }                                                   // End while loop
+
+    if (reader.overflowed()) {                          // If a reference was too large
+        std::cerr << "Reference does not fit in 64 bits, or is the reserved page 2^64-1.\n";  // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    if (reader.truncated()) {                           // If the binary body ended early
+        std::cerr << "Binary trace is truncated.\n";    // Print error message
+        return false;                                   // Report the failure
+    }                                                   // End if statement
+
+    return true;                                        // Every reference was read
+}                                                       // End of function readTrace
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <vector>
+
+#include "policy.h"
+
+/**
+ * @brief Denning's working set W(t, delta) for several window sizes in one pass
+ *
+ * W(t, delta) is the set of pages referenced in the last delta
+ * references. Each page keeps the time of its latest reference; a page
+ * joins a window when its previous reference is more than delta ago
+ * (which is also a fault under the working-set policy), and leaves when
+ * the reference delta steps back expires without a later reference to
+ * the same page. The references that can still expire sit in a ring of
+ * the largest window, so every window costs O(1) per reference and
+ * nothing is rescanned.
+ */
+
+class WorkingSetTracker {
+public:
+    struct Window {
+        long long delta;                                // Window length in references
+        long long size;                                 // |W(t, delta)|
+        long long faults;                               // References to pages outside W(t - 1, delta)
+        long long sizeSum;                              // Sum of |W| over time, for the mean
+    };
+
+    std::vector<Window> windows;                        // One per delta, in the order given
+
+    /**
+     * @brief Start tracking the given window lengths over an empty history
+     */
+
+    void init(const std::vector<long long> &deltas) {
+        windows.clear();                                // Forget earlier windows
+        long long longest = 1;                          // Largest delta
+        for (long long delta : deltas) {                // For every window
+            windows.push_back(Window{delta, 0, 0, 0});  // Empty so far
+            longest = std::max(longest, delta);         // Track the largest
+        }                                               // End for loop
+        recent.assign(longest + 1, -1);                 // References that may still expire, as a ring
+        lastUse.clear();                                // No page referenced yet
+        time = 0;                                       // Start of the trace
+    }                                                   // End of function init
+
+    /**
+     * @brief Reference page at the current time
+     */
+
+    void access(int page) {
+        if (page >= (int) lastUse.size())               // If the page ID is new
+            lastUse.resize(page + 1, -1);               // Extend the timestamps to cover it
+        long long previous = lastUse[page];             // Its previous reference, or -1
+        lastUse[page] = time;                           // Referenced now
+        recent[time % recent.size()] = page;            // Remember who to expire later
+
+        for (Window &w : windows) {                     // For every window
+            if (previous < 0 || time - previous > w.delta) {  // If the page was outside the window
+                w.size++;                               // It joins
+                w.faults++;                             // And faults under the working-set policy
+            }                                           // End if statement
+
+            long long expired = time - w.delta;         // Reference leaving this window now
+            if (expired >= 0 && lastUse[recent[expired % recent.size()]] == expired)  // If its page has not been used since
+                w.size--;                               // The page leaves the window
+
+            w.sizeSum += w.size;                        // Accumulate for the mean
+        }                                               // End for loop
+
+        time++;                                         // Next reference
+    }                                                   // End of function access
+
+    long long references() const { return time; }       // References seen so far
+
+private:
+    std::vector<int> recent;                            // recent[t % size] = page referenced at time t
+    std::vector<long long> lastUse;                     // lastUse[id] = time of the latest reference, or -1
+    long long time;                                     // Index of the next reference
+};
+
+/**
+ * @brief Page-fault-frequency variable allocation (Chu and Opderbeck)
+ *
+ * The resident set grows by one page on each fault, unless more than
+ * tau references have passed since the previous fault: then the fault
+ * rate is low enough to shrink, and every page not referenced since
+ * that fault is released first. Resident pages sit on a recency list,
+ * so the ones to release are always at its back and each page is
+ * removed in O(1).
+ */
+
+class PffAllocator {
+public:
+    long long tau;                                      // Fault interval above which the set shrinks
+    long long faults;                                   // Page faults so far
+    long long residentSum;                              // Sum of the resident set size over time, for the mean
+
+    /**
+     * @brief Start with no resident pages for a trace of pageCount distinct pages
+     */
+
+    void init(long long interval, int pageCount) {
+        tau = interval;                                 // Threshold
+        faults = 0;                                     // No faults yet
+        residentSum = 0;                                // No history
+        recency.init(pageCount);                        // No page is resident
+        resident.assign(pageCount, 0);
+        lastUse.assign(pageCount, -1);                  // No page referenced yet
+        lastFault = LLONG_MIN / 2;                      // No fault yet; nothing is old enough to release
+        time = 0;                                       // Start of the trace
+    }                                                   // End of function init
+
+    /**
+     * @brief Reference page at the current time
+     *
+     * @return true if the reference was a page fault
+     */
+
+    bool access(int page) {
+        bool fault = !resident[page];                   // Whether the page must be loaded
+
+        if (fault) {                                    // If it must
+            if (time - lastFault > tau)                 // If faults have been rare
+                while (recency.size() > 0 && lastUse[recency.back()] < lastFault) {  // Release what went unused since the last fault
+                    resident[recency.back()] = 0;       // No longer resident
+                    recency.unlink(recency.back());     // Off the list
+                }                                       // End while loop
+            recency.pushFront(page);                    // Load the page
+            resident[page] = 1;
+            lastFault = time;                           // Remember the fault
+            faults++;                                   // Count it
+        } else {                                        // Else it is a hit
+            recency.moveToFront(page);                  // Now the most recently used
+        }                                               // End if statement
+
+        lastUse[page] = time++;                         // Referenced now
+        residentSum += recency.size();                  // Accumulate for the mean
+        return fault;                                   // Report the fault
+    }                                                   // End of function access
+
+    int residentSize() const { return recency.size(); } // Pages resident now
+
+private:
+    FrameList recency;                                  // Resident pages, most recently used first
+    std::vector<char> resident;                         // Whether each page is resident
+    std::vector<long long> lastUse;                     // Time of each page's latest reference
+    long long lastFault;                                // Time of the latest fault
+    long long time;                                     // Index of the next reference
+};
+
+/**
+ * @brief Print the working-set size and faults over time for every delta and tau
+ *
+ * One pass drives a WorkingSetTracker for all deltas and a PffAllocator
+ * per tau. Every interval references (and at the end) a CSV row gives,
+ * for each delta, |W(t, delta)| and the working-set policy's faults so
+ * far, and for each tau the PFF resident set size and faults so far.
+ * The mean sizes and total faults go to stderr.
+ *
+ * @param refs      Page references
+ * @param refCount  Number of references
+ * @param pageCount Number of distinct pages
+ * @param deltas    Working-set windows
+ * @param taus      PFF thresholds
+ * @param interval  References between rows, or 0 for a hundred rows
+ */
+
+inline void printWorkingSetSeries(const int refs[],
+                                  int refCount,
+                                  int pageCount,
+                                  const std::vector<long long> &deltas,
+                                  const std::vector<long long> &taus,
+                                  long long interval)
+{
+    if (interval <= 0)                                  // If no interval was given
+        interval = std::max(1, refCount / 100);         // Aim for a hundred rows
+
+    WorkingSetTracker workingSet;                       // Every delta at once
+    workingSet.init(deltas);
+
+    std::vector<PffAllocator> pff(taus.size());         // One allocator per threshold
+    for (size_t i = 0; i < taus.size(); i++)            // For every threshold
+        pff[i].init(taus[i], pageCount);                // Start empty
+
+    std::cout << "time";                                // CSV header
+    for (long long delta : deltas)                      // For every window
+        std::cout << ",ws_" << delta << ",ws_faults_" << delta;
+    for (long long tau : taus)                          // For every threshold
+        std::cout << ",pff_" << tau << ",pff_faults_" << tau;
+    std::cout << "\n";
+
+    for (int t = 0; t < refCount; t++) {                // For every reference
+        workingSet.access(refs[t]);                     // Update every window
+        for (PffAllocator &allocator : pff)             // And every allocator
+            allocator.access(refs[t]);
+
+        if ((t + 1) % interval != 0 && t + 1 != refCount)  // If no row is due
+            continue;                                   // Keep going
+
+        std::cout << t + 1;                             // Display one row
+        for (const WorkingSetTracker::Window &w : workingSet.windows)
+            std::cout << "," << w.size << "," << w.faults;
+        for (const PffAllocator &allocator : pff)
+            std::cout << "," << allocator.residentSize() << "," << allocator.faults;
+        std::cout << "\n";
+    }                                                   // End for loop
+
+    double n = refCount > 0 ? refCount : 1;             // Divide by at least one
+    for (const WorkingSetTracker::Window &w : workingSet.windows)  // Summarize every window
+        std::cerr << "Working set delta=" << w.delta << ": mean size " << w.sizeSum / n <<
+            ", faults " << w.faults << "\n";
+    for (const PffAllocator &allocator : pff)           // And every allocator
+        std::cerr << "PFF tau=" << allocator.tau << ": mean resident " << allocator.residentSum / n <<
+            ", faults " << allocator.faults << "\n";
+}                                                       // End of function printWorkingSetSeries
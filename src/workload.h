@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A synthetic reference pattern, as named on the command line
+ *
+ * "uniform", "zipf[:skew]", "loop", "phase[:set]" or "stride[:step]".
+ * The optional number tunes the pattern; pages and length are given
+ * separately so one workload can be generated at many sizes.
+ */
+
+struct WorkloadSpec {
+    std::string name;                                   // Text as given, for the output
+    std::string kind;                                   // Pattern before the colon
+    double param;                                       // Number after the colon, or the pattern's default
+};
+
+/**
+ * @brief Parse one workload name
+ *
+ * @return false if the pattern is unknown or its parameter is malformed
+ */
+
+inline bool parseWorkload(const std::string &text,
+                          WorkloadSpec &spec)
+{
+    size_t colon = text.find(':');                      // Start of the parameter, if any
+    spec.name = text;                                   // Keep the full name
+    spec.kind = text.substr(0, colon);                  // The pattern
+
+    if (spec.kind == "uniform" || spec.kind == "loop")  // Patterns without a parameter
+        spec.param = 0;
+    else if (spec.kind == "zipf")                       // Skew of the rank distribution
+        spec.param = 0.99;
+    else if (spec.kind == "phase")                      // Working-set size as a fraction of the pages
+        spec.param = 0.1;
+    else if (spec.kind == "stride")                     // Distance between consecutive pages
+        spec.param = 7;
+    else                                                // Anything else is unknown
+        return false;                                   // Report the failure
+
+    if (colon != std::string::npos) {                   // If a parameter was given
+        char *end;                                      // End of the number
+        spec.param = std::strtod(text.c_str() + colon + 1, &end);  // Read it
+        if (*end != '\0' || spec.param < 0)             // If it is malformed or negative
+            return false;                               // Report the failure
+    }                                                   // End if statement
+
+    return true;                                        // The workload is known
+}                                                       // End of function parseWorkload
+
+/**
+ * @brief Fill refs with refCount references over pages distinct pages
+ *
+ * - uniform: every page equally likely.
+ * - zipf:    page k drawn with probability proportional to 1/(k+1)^skew.
+ * - loop:    0, 1, ..., pages-1, 0, 1, ... -- a cyclic scan.
+ * - phase:   uniform over a working set of param*pages pages that moves
+ *            to a random place every 10*set references.
+ * - stride:  0, step, 2*step, ... modulo pages.
+ *
+ * @param spec     The pattern
+ * @param pages    Number of distinct pages to draw from
+ * @param refCount Number of references to generate
+ * @param seed     Seed for the random patterns
+ * @param refs     Receives the references
+ */
+
+inline void generateWorkload(const WorkloadSpec &spec,
+                             int pages,
+                             long long refCount,
+                             unsigned long long seed,
+                             std::vector<int> &refs)
+{
+    std::mt19937_64 rng(seed);                          // Deterministic for a given seed
+    refs.resize(refCount);                              // Room for every reference
+
+    if (spec.kind == "uniform") {                       // Every page equally likely
+        std::uniform_int_distribution<int> pick(0, pages - 1);  // Any page
+        for (long long i = 0; i < refCount; i++)        // For every reference
+            refs[i] = pick(rng);                        // Draw a page
+    } else if (spec.kind == "zipf") {                   // Skewed toward low ranks
+        std::vector<double> cdf(pages);                 // Cumulative weight of ranks 0..k
+        double total = 0;                               // Running sum of weights
+        for (int k = 0; k < pages; k++) {               // For every rank
+            total += 1.0 / std::pow(k + 1.0, spec.param);  // Its weight
+            cdf[k] = total;                             // Cumulative weight so far
+        }                                               // End for loop
+        std::uniform_real_distribution<double> pick(0, total);  // Point on the cumulative scale
+        for (long long i = 0; i < refCount; i++) {      // For every reference
+            int k = (int) (std::upper_bound(cdf.begin(), cdf.end(), pick(rng)) - cdf.begin());  // Rank it lands in
+            refs[i] = std::min(k, pages - 1);           // Guard against rounding past the end
+        }                                               // End for loop
+    } else if (spec.kind == "loop") {                   // Cyclic scan
+        for (long long i = 0; i < refCount; i++)        // For every reference
+            refs[i] = (int) (i % pages);                // Next page in the cycle
+    } else if (spec.kind == "phase") {                  // Moving working set
+        int set = std::max(1, (int) (spec.param * pages));  // Pages in the working set
+        set = std::min(set, pages);                     // Never more than there are
+        long long phaseLength = 10LL * set;             // References before the set moves
+        std::uniform_int_distribution<int> start(0, pages - set);  // Where a set can begin
+        std::uniform_int_distribution<int> pick(0, set - 1);  // Page within the set
+        int base = 0;                                   // First page of the current set
+        for (long long i = 0; i < refCount; i++) {      // For every reference
+            if (i % phaseLength == 0)                   // If a new phase begins
+                base = start(rng);                      // Move the set
+            refs[i] = base + pick(rng);                 // Draw from the set
+        }                                               // End for loop
+    } else {                                            // Strided scan
+        long long step = std::max(1LL, (long long) spec.param);  // Distance between pages
+        for (long long i = 0; i < refCount; i++)        // For every reference
+            refs[i] = (int) ((i * step) % pages);       // Next page along the stride
+    }                                                   // End if statement
+}                                                       // End of function generateWorkload